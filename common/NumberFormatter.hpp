@@ -0,0 +1,424 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// double を、ロケールやストリームを通さずにバッファへ直接書く
+// - NUMBER_FORMAT_SHORTEST: 読み戻すと同じ値になる最短の桁 (Ryu, Grisu と同じ結果)
+//   読み戻すと同じ値になる区間 (前後の double との中点まで) に入る最短の10進数で、候補が2つあれば近い方を選ぶ
+//   仮数が 0 の値 (2の累乗) は下側の隣との間隔が半分なので、区間が非対称になり、正しく丸めた値より上の候補を選ぶことがある
+// - NUMBER_FORMAT_IOSTREAM: std::ostream << double の既定 (有効数字6桁の %g) と同じ文字列
+// どちらも 2進の値を 128ビット整数で正確に10進へ丸め、範囲外 (極端に大きい・小さい値, inf, nan) のみ snprintf に任せる
+
+typedef enum NumberFormat {
+	NUMBER_FORMAT_SHORTEST,
+	NUMBER_FORMAT_IOSTREAM
+} NumberFormat;
+
+// 符号, 17桁, 小数点, 指数 (e-308) を書いても収まる大きさ
+static const std::size_t NUMBER_FORMATTER_BUFFER_SIZE = 32;
+// std::ostream の既定の精度
+static const int NUMBER_FORMATTER_IOSTREAM_PRECISION = 6;
+// double を区別するのに足りる有効数字の桁数
+static const int NUMBER_FORMATTER_MAX_DIGITS = 17;
+// 最短表記で、整数部がこの桁数以上になる場合は指数表記にする
+static const int NUMBER_FORMATTER_SHORTEST_EXPONENT_MAX = 16;
+
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+#define NUMBER_FORMATTER_INT128
+__extension__ typedef unsigned __int128 NumberFormatterUint128;
+#endif	// __GNUC__ && __SIZEOF_INT128__
+
+static inline unsigned long long _getFormatterPowerOf10(
+	int exponent
+)
+{
+	static const unsigned long long POWERS[20] = {
+		1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+		100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+		10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+		100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+	};
+	return POWERS[exponent];
+}
+
+#ifdef NUMBER_FORMATTER_INT128
+// value = mantissa * 2^exponent を 10^scale 倍し、有効数字 digits 桁の整数部と余りに分けたもの
+// value * 10^scale = (quotient * denominator + remainder) / denominator
+typedef struct NumberFormatterScaled {
+	unsigned long long quotient;
+	// quotient の先頭の桁の10進の指数
+	int decimalExponent;
+	NumberFormatterUint128 remainder;
+	NumberFormatterUint128 denominator;
+	// 仮数の1 (隣の double までの距離) を、余りと同じ単位で表したもの
+	NumberFormatterUint128 ulp;
+} NumberFormatterScaled;
+
+// 丸めた結果 (value ≒ decimal * 10^(decimalExponent - digits + 1))
+typedef struct NumberFormatterRounding {
+	unsigned long long decimal;
+	int decimalExponent;
+	// 丸めの誤差 (余りと同じ単位)
+	NumberFormatterUint128 error;
+	// decimal の1 を、余りと同じ単位で表したもの
+	NumberFormatterUint128 step;
+	bool isRoundedUp;
+} NumberFormatterRounding;
+
+// 10^exponent (exponent <= 38) を返す
+static inline NumberFormatterUint128 _getFormatterWidePowerOf10(
+	int exponent
+)
+{
+	if (exponent < 20)
+		return _getFormatterPowerOf10(exponent);
+	return static_cast<NumberFormatterUint128>(_getFormatterPowerOf10(19)) * _getFormatterPowerOf10(exponent - 19);
+}
+
+// 10^powers のビット数の見積もり (log2(10) < 10/3 で多めに見積もる)
+static inline int _getFormatterPowerBits(
+	int powers
+)
+{
+	return (powers * 10 + 2) / 3;
+}
+
+// 有効数字 digits 桁の整数部と余りに分ける (範囲外の場合は false)
+// 先頭の桁の指数を見積もって割り、桁数が合わなければ見積もりを直してやり直す
+static inline bool _scaleToDigits(
+	unsigned long long mantissa,
+	int exponent,
+	int digits,
+	int decimalExponent,
+	NumberFormatterScaled &scaled
+)
+{
+	const unsigned long long lower = _getFormatterPowerOf10(digits - 1);
+	const unsigned long long upper = _getFormatterPowerOf10(digits);
+	for (int retry = 0; retry < 3; retry++) {
+		int scale = digits - 1 - decimalExponent;
+		// numerator = mantissa * 2^max(exponent, 0) * 10^max(scale, 0), denominator = 2^max(-exponent, 0) * 10^max(-scale, 0)
+		// 後で denominator を 10^16 倍しても 2^128 を超えないよう、それぞれ 2^125 未満に収める
+		int shift = exponent < 0 ? -exponent : 0;
+		int powers = scale < 0 ? -scale : 0;
+		if (125 <= 53 + (exponent < 0 ? 0 : exponent) + _getFormatterPowerBits(scale < 0 ? 0 : scale) || 125 <= shift + _getFormatterPowerBits(powers))
+			return false;
+		NumberFormatterUint128 ulp = static_cast<NumberFormatterUint128>(1) << (exponent < 0 ? 0 : exponent);
+		if (0 < scale)
+			ulp *= _getFormatterWidePowerOf10(scale);
+		NumberFormatterUint128 numerator = ulp * mantissa;
+		NumberFormatterUint128 quotient;
+		NumberFormatterUint128 denominator;
+		if (powers == 0) {
+			// 2の累乗で割るだけなので、シフトで済ませる
+			denominator = static_cast<NumberFormatterUint128>(1) << shift;
+			quotient = numerator >> shift;
+		} else {
+			denominator = _getFormatterWidePowerOf10(powers) << shift;
+			quotient = numerator / denominator;
+		}
+		if (quotient < lower) {
+			--decimalExponent;
+			continue;
+		}
+		if (upper <= quotient) {
+			++decimalExponent;
+			continue;
+		}
+		scaled.quotient = static_cast<unsigned long long>(quotient);
+		scaled.decimalExponent = decimalExponent;
+		scaled.remainder = numerator - quotient * denominator;
+		scaled.denominator = denominator;
+		scaled.ulp = ulp;
+		return true;
+	}
+	return false;
+}
+
+// 下の dropCount 桁を捨てて、最近接偶数丸めする (範囲外の場合は false)
+// 捨てる桁も余りに含めて比べるので、二重に丸めることにはならない
+static inline bool _roundScaled(
+	const NumberFormatterScaled &scaled,
+	int digits,
+	int dropCount,
+	NumberFormatterRounding &rounding
+)
+{
+	unsigned long long divisor = _getFormatterPowerOf10(dropCount);
+	NumberFormatterUint128 denominator = scaled.denominator;
+	NumberFormatterUint128 remainder = scaled.remainder;
+	unsigned long long decimal = scaled.quotient;
+	if (dropCount != 0) {
+		if ((denominator >> (125 - _getFormatterPowerBits(dropCount))) != 0)
+			return false;
+		remainder += static_cast<NumberFormatterUint128>(decimal % divisor) * denominator;
+		denominator *= divisor;
+		decimal /= divisor;
+	}
+	bool isRoundedUp = denominator < remainder * 2 || (remainder * 2 == denominator && (decimal & 1) != 0);
+	int decimalExponent = scaled.decimalExponent;
+	if (isRoundedUp && ++decimal == _getFormatterPowerOf10(digits)) {
+		decimal = _getFormatterPowerOf10(digits - 1);
+		++decimalExponent;
+	}
+	rounding.decimal = decimal;
+	rounding.decimalExponent = decimalExponent;
+	rounding.error = isRoundedUp ? denominator - remainder : remainder;
+	rounding.step = denominator;
+	rounding.isRoundedUp = isRoundedUp;
+	return true;
+}
+
+// 丸めた値の、元の値をはさんで反対側にある digits 桁の10進数 (元の値と一致する場合は false)
+static inline bool _getOtherRounding(
+	const NumberFormatterRounding &rounding,
+	int digits,
+	NumberFormatterRounding &other
+)
+{
+	if (rounding.error == 0)
+		return false;
+	other = rounding;
+	other.error = rounding.step - rounding.error;
+	other.isRoundedUp = !rounding.isRoundedUp;
+	if (rounding.isRoundedUp) {
+		// 繰り上がって桁が増えていた場合は、9 が並ぶ値に戻る
+		if (rounding.decimal == _getFormatterPowerOf10(digits - 1)) {
+			other.decimal = _getFormatterPowerOf10(digits) - 1;
+			--other.decimalExponent;
+		} else {
+			other.decimal = rounding.decimal - 1;
+		}
+	} else if (++other.decimal == _getFormatterPowerOf10(digits)) {
+		other.decimal = _getFormatterPowerOf10(digits - 1);
+		++other.decimalExponent;
+	}
+	return true;
+}
+
+// 丸めた値を読み戻すと、元の値になるか
+// 元の値の前後の double との中点までに収まっていればよい (中点ちょうどは仮数が偶数なら元の値に戻る)
+static inline bool _isRoundTrip(
+	unsigned long long mantissa,
+	bool isLowerGapHalf,
+	const NumberFormatterScaled &scaled,
+	const NumberFormatterRounding &rounding
+)
+{
+	// 隣の double までの距離の半分は ulp / 2、値が下がる方向が2の累乗の境をまたぐ場合はその半分
+	NumberFormatterUint128 doubledError = rounding.error * 2;
+	if (!rounding.isRoundedUp && isLowerGapHalf)
+		doubledError *= 2;
+	if ((mantissa & 1) == 0)
+		return doubledError <= scaled.ulp;
+	return doubledError < scaled.ulp;
+}
+
+// 正しく丸めた値が読み戻せない場合に、元の値をはさんで反対側の値を試す (読み戻せれば rounding を置き換える)
+// 区間が非対称 (下側の間隔が半分) の場合は、遠い方の上の値だけが区間に入ることがある
+static inline bool _selectOtherRoundTrip(
+	unsigned long long mantissa,
+	const NumberFormatterScaled &scaled,
+	int digits,
+	NumberFormatterRounding &rounding
+)
+{
+	NumberFormatterRounding other;
+	if (!_getOtherRounding(rounding, digits, other) || !_isRoundTrip(mantissa, true, scaled, other))
+		return false;
+	rounding = other;
+	return true;
+}
+#endif	// NUMBER_FORMATTER_INT128
+
+// 桁の列を %g と同じ規則で並べる (末尾の 0 は取り除く)
+// 指数が -4 未満、または exponentMax 以上なら指数表記にする
+static inline std::size_t _writeFormattedDigits(
+	char *buffer,
+	bool isNegative,
+	unsigned long long decimal,
+	int digitCount,
+	int decimalExponent,
+	int exponentMax
+)
+{
+	while (1 < digitCount && decimal % 10 == 0) {
+		decimal /= 10;
+		--digitCount;
+	}
+	char digits[NUMBER_FORMATTER_MAX_DIGITS + 3];
+	for (int i = digitCount - 1; 0 <= i; i--) {
+		digits[i] = static_cast<char>('0' + decimal % 10);
+		decimal /= 10;
+	}
+
+	char *p = buffer;
+	if (isNegative)
+		*p++ = '-';
+	if (decimalExponent < -4 || exponentMax <= decimalExponent) {
+		*p++ = digits[0];
+		if (1 < digitCount) {
+			*p++ = '.';
+			std::memcpy(p, digits + 1, digitCount - 1);
+			p += digitCount - 1;
+		}
+		*p++ = 'e';
+		*p++ = decimalExponent < 0 ? '-' : '+';
+		int absExponent = decimalExponent < 0 ? -decimalExponent : decimalExponent;
+		if (100 <= absExponent)
+			*p++ = static_cast<char>('0' + absExponent / 100);
+		*p++ = static_cast<char>('0' + absExponent / 10 % 10);
+		*p++ = static_cast<char>('0' + absExponent % 10);
+	} else if (decimalExponent < 0) {
+		*p++ = '0';
+		*p++ = '.';
+		for (int i = -1; decimalExponent < i; i--) {
+			*p++ = '0';
+		}
+		std::memcpy(p, digits, digitCount);
+		p += digitCount;
+	} else {
+		int integerCount = decimalExponent + 1;
+		for (int i = 0; i < integerCount; i++) {
+			*p++ = i < digitCount ? digits[i] : '0';
+		}
+		if (integerCount < digitCount) {
+			*p++ = '.';
+			std::memcpy(p, digits + integerCount, digitCount - integerCount);
+			p += digitCount - integerCount;
+		}
+	}
+	return p - buffer;
+}
+
+// %.*e で書いた正の値を、桁の列と先頭の桁の指数に分ける
+static inline void _parseScientificText(
+	const char *text,
+	unsigned long long &decimal,
+	int &decimalExponent
+)
+{
+	decimal = 0;
+	const char *p = text;
+	for (; *p != 'e'; ++p) {
+		if (*p != '.')
+			decimal = decimal * 10 + static_cast<unsigned long long>(*p - '0');
+	}
+	decimalExponent = std::atoi(p + 1);
+}
+
+// 速い経路で扱えない値は、snprintf で書く
+static inline std::size_t _formatDecimalSlow(
+	double value,
+	NumberFormat format,
+	char *buffer
+)
+{
+	char text[NUMBER_FORMATTER_BUFFER_SIZE];
+	if (format == NUMBER_FORMAT_IOSTREAM || value != value || value - value != 0) {
+		std::snprintf(text, sizeof(text), "%.*g", NUMBER_FORMATTER_IOSTREAM_PRECISION, value);
+		std::size_t length = std::strlen(text);
+		std::memcpy(buffer, text, length);
+		return length;
+	}
+
+	// 読み戻して同じ値になる、最も少ない桁数を探す
+	// 正しく丸めた値が読み戻せなくても、2の累乗 (下側の隣との間隔が半分) なら1つ上の値は読み戻せることがある
+	unsigned long long bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	bool isNegative = (bits >> 63) != 0;
+	bool isLowerGapHalf = (bits & ((1ULL << 52) - 1)) == 0 && 1 < ((bits >> 52) & 0x7FF);
+	double magnitude = isNegative ? -value : value;
+	unsigned long long decimal = 0;
+	int decimalExponent = 0;
+	int digits = 1;
+	for (; digits <= NUMBER_FORMATTER_MAX_DIGITS; digits++) {
+		std::snprintf(text, sizeof(text), "%.*e", digits - 1, magnitude);
+		double parsed = std::strtod(text, NULL);
+		_parseScientificText(text, decimal, decimalExponent);
+		if (parsed == magnitude)
+			break;
+		if (!isLowerGapHalf || magnitude < parsed)
+			continue;
+		if (++decimal == _getFormatterPowerOf10(digits)) {
+			decimal = _getFormatterPowerOf10(digits - 1);
+			++decimalExponent;
+		}
+		text[_writeFormattedDigits(text, false, decimal, digits, decimalExponent, NUMBER_FORMATTER_SHORTEST_EXPONENT_MAX)] = '\0';
+		if (std::strtod(text, NULL) == magnitude)
+			break;
+	}
+	return _writeFormattedDigits(buffer, isNegative, decimal, digits, decimalExponent, NUMBER_FORMATTER_SHORTEST_EXPONENT_MAX);
+}
+
+// buffer (NUMBER_FORMATTER_BUFFER_SIZE 以上) に書き、書いた長さを返す ('\0' は付けない)
+inline std::size_t formatDecimal(
+	double value,
+	NumberFormat format,
+	char *buffer
+)
+{
+#ifdef NUMBER_FORMATTER_INT128
+	unsigned long long bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	bool isNegative = (bits >> 63) != 0;
+	int biasedExponent = static_cast<int>((bits >> 52) & 0x7FF);
+	unsigned long long fraction = bits & ((1ULL << 52) - 1);
+	if (biasedExponent == 0 && fraction == 0) {
+		char *p = buffer;
+		if (isNegative)
+			*p++ = '-';
+		*p++ = '0';
+		return p - buffer;
+	}
+	// 非正規化数, inf, nan は遅い経路に任せる
+	if (biasedExponent != 0 && biasedExponent != 0x7FF) {
+		unsigned long long mantissa = fraction | (1ULL << 52);
+		int exponent = biasedExponent - 1075;
+		// 先頭の桁の指数の見積もり: floor(log10(2^(exponent + 52)))
+		int decimalExponent = ((exponent + 52) * 78913) >> 18;
+		NumberFormatterScaled scaled;
+		NumberFormatterRounding rounding;
+		if (format == NUMBER_FORMAT_IOSTREAM) {
+			if (_scaleToDigits(mantissa, exponent, NUMBER_FORMATTER_IOSTREAM_PRECISION, decimalExponent, scaled) && _roundScaled(scaled, NUMBER_FORMATTER_IOSTREAM_PRECISION, 0, rounding))
+				return _writeFormattedDigits(buffer, isNegative, rounding.decimal, NUMBER_FORMATTER_IOSTREAM_PRECISION, rounding.decimalExponent, NUMBER_FORMATTER_IOSTREAM_PRECISION);
+		} else if (_scaleToDigits(mantissa, exponent, NUMBER_FORMATTER_MAX_DIGITS, decimalExponent, scaled)) {
+			// 17桁に分けた結果から各桁数の丸めを作り、読み戻せる最少の桁数を二分探索する
+			// (p 桁で読み戻せる値は p + 1 桁でもあるので、読み戻せるかは桁数について単調)
+			bool isLowerGapHalf = fraction == 0 && 1 < biasedExponent;
+			int low = 1;
+			int high = NUMBER_FORMATTER_MAX_DIGITS;
+			NumberFormatterRounding shortest;
+			bool isInRange = _roundScaled(scaled, high, 0, shortest);
+			while (isInRange && low < high) {
+				int middle = (low + high) / 2;
+				if (!_roundScaled(scaled, middle, NUMBER_FORMATTER_MAX_DIGITS - middle, rounding)) {
+					isInRange = false;
+				} else if (_isRoundTrip(mantissa, isLowerGapHalf, scaled, rounding) || (isLowerGapHalf && _selectOtherRoundTrip(mantissa, scaled, middle, rounding))) {
+					high = middle;
+					shortest = rounding;
+				} else {
+					low = middle + 1;
+				}
+			}
+			if (isInRange)
+				return _writeFormattedDigits(buffer, isNegative, shortest.decimal, high, shortest.decimalExponent, NUMBER_FORMATTER_SHORTEST_EXPONENT_MAX);
+		}
+	}
+#endif	// NUMBER_FORMATTER_INT128
+	return _formatDecimalSlow(value, format, buffer);
+}
+
+inline void appendDecimal(
+	std::string &output,
+	double value,
+	NumberFormat format
+)
+{
+	char buffer[NUMBER_FORMATTER_BUFFER_SIZE];
+	output.append(buffer, formatDecimal(value, format, buffer));
+}
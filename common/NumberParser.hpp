@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+// ex00, ex01, ex02 で共通に使う、数値の文字列の変換
+// [begin, end) をそのまま読み (NUL 終端や std::string のコピーを必要としない)、結果は状態で返す
+// (例外や errno を使わないので、呼び出し側がそれぞれのエラーの扱いに変換する)
+
+typedef enum NumberParseStatus {
+	NUMBER_PARSE_OK,
+	// 空、または数字 (と小数点) 以外を含む
+	NUMBER_PARSE_INVALID,
+	// 型の範囲を超える
+	NUMBER_PARSE_OVERFLOW
+} NumberParseStatus;
+
+// 1回で読む桁数 (8バイトを1つの整数として読む: SWAR)
+static const std::size_t NUMBER_PARSER_CHUNK_SIZE = 8;
+// 値がこれ未満なら、8桁を足しても unsigned long long が溢れない (10^11 * 10^8 < 10^19)
+static const unsigned long long NUMBER_PARSER_CHUNK_SAFE_MAX = 100000000000ULL;
+// double で誤差なく表せる整数の最大値 (2^53) と 10 の累乗の最大の指数
+static const unsigned long long NUMBER_PARSER_EXACT_MANTISSA_MAX = 1ULL << 53;
+static const std::size_t NUMBER_PARSER_EXACT_POWER_MAX = 22;
+// 遅い経路で strtod に渡すための、スタック上の領域の大きさ
+static const std::size_t NUMBER_PARSER_BUFFER_SIZE = 128;
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define NUMBER_PARSER_SWAR
+#endif	// __GNUC__ && little endian
+
+// ロケールによらない '0'..'9' の判定
+inline bool isDecimalDigit(
+	char c
+)
+{
+	return static_cast<unsigned char>(c - '0') <= 9;
+}
+
+#ifdef NUMBER_PARSER_SWAR
+static inline unsigned long long _loadChunk(
+	const char *p
+)
+{
+	unsigned long long chunk;
+	std::memcpy(&chunk, p, sizeof(chunk));
+	return chunk;
+}
+
+// 8バイトのうち、先頭から続く数字のバイト数
+// 上位4ビットが 3、かつ 6 を足しても上位4ビットが 3 のままのバイトが数字
+// (6 を足した繰り上がりは後ろのバイトにしか及ばないので、最初の数字以外のバイトは正しく見つかる)
+static inline std::size_t _countChunkDigits(
+	unsigned long long chunk
+)
+{
+	const unsigned long long high = 0xF0F0F0F0F0F0F0F0ULL;
+	const unsigned long long zeros = 0x3030303030303030ULL;
+	unsigned long long nonDigits = ((chunk & high) ^ zeros) | (((chunk + 0x0606060606060606ULL) & high) ^ zeros);
+	if (nonDigits == 0)
+		return NUMBER_PARSER_CHUNK_SIZE;
+	return static_cast<std::size_t>(__builtin_ctzll(nonDigits)) / 8;
+}
+
+// 8桁の数字を値にする (隣り合う桁, 2桁, 4桁の組を順にまとめる)
+static inline unsigned long long _convertChunk(
+	unsigned long long chunk
+)
+{
+	chunk -= 0x3030303030303030ULL;
+	chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+	chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+	chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+	return chunk;
+}
+#endif	// NUMBER_PARSER_SWAR
+
+#ifdef NUMBER_PARSER_SWAR
+static inline unsigned long long _getIntegerPowerOf10(
+	std::size_t exponent
+)
+{
+	static const unsigned long long POWERS[NUMBER_PARSER_CHUNK_SIZE + 1] = {
+		1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+	};
+	return POWERS[exponent];
+}
+#endif	// NUMBER_PARSER_SWAR
+
+// begin から続く数字を value の後ろに続けて読み (value * 10^桁数 + 数字)、数字の終わりの位置を返す
+// unsigned long long が溢れる場合は isOverflow を true にし、数字の終わりまで読み飛ばす
+inline const char *parseDigitPrefix(
+	const char *begin,
+	const char *end,
+	unsigned long long &value,
+	bool &isOverflow
+)
+{
+	const char *p = begin;
+#ifdef NUMBER_PARSER_SWAR
+	// 溢れる心配がない間は8バイトずつ読む (数字が途中で終わる場合は、前を '0' で埋めてまとめて変換する)
+	while (static_cast<std::size_t>(end - p) >= NUMBER_PARSER_CHUNK_SIZE && value < NUMBER_PARSER_CHUNK_SAFE_MAX) {
+		unsigned long long chunk = _loadChunk(p);
+		std::size_t count = _countChunkDigits(chunk);
+		if (count == NUMBER_PARSER_CHUNK_SIZE) {
+			value = value * 100000000ULL + _convertChunk(chunk);
+			p += NUMBER_PARSER_CHUNK_SIZE;
+			continue;
+		}
+		if (count != 0) {
+			std::size_t shift = (NUMBER_PARSER_CHUNK_SIZE - count) * 8;
+			chunk = (chunk << shift) | (0x3030303030303030ULL >> (count * 8));
+			value = value * _getIntegerPowerOf10(count) + _convertChunk(chunk);
+		}
+		return p + count;
+	}
+#endif	// NUMBER_PARSER_SWAR
+	const unsigned long long limit = std::numeric_limits<unsigned long long>::max() / 10;
+	const unsigned int lastDigit = std::numeric_limits<unsigned long long>::max() % 10;
+	for (; p != end; ++p) {
+		unsigned int digit = static_cast<unsigned char>(*p - '0');
+		if (9 < digit)
+			break;
+		if (limit <= value && (limit < value || lastDigit < digit))
+			isOverflow = true;
+		value = value * 10 + digit;
+	}
+	return p;
+}
+
+// 10進数の符号なし整数 (先頭の 0 は許す) を value に変換する
+// OK 以外の場合、value は変更しない
+template <typename T>
+inline NumberParseStatus parseUnsigned(
+	const char *begin,
+	const char *end,
+	T &value
+)
+{
+	unsigned long long result = 0;
+	bool isOverflow = false;
+	if (begin == end)
+		return NUMBER_PARSE_INVALID;
+	if (static_cast<std::size_t>(end - begin) < NUMBER_PARSER_CHUNK_SIZE) {
+		// 8桁に満たない場合は溢れないので、確認せずに足していく
+		for (const char *p = begin; p != end; ++p) {
+			unsigned int digit = static_cast<unsigned char>(*p - '0');
+			if (9 < digit)
+				return NUMBER_PARSE_INVALID;
+			result = result * 10 + digit;
+		}
+	} else if (parseDigitPrefix(begin, end, result, isOverflow) != end)
+		return NUMBER_PARSE_INVALID;
+	if (isOverflow || static_cast<unsigned long long>(std::numeric_limits<T>::max()) < result)
+		return NUMBER_PARSE_OVERFLOW;
+	value = static_cast<T>(result);
+	return NUMBER_PARSE_OK;
+}
+
+static inline double _getPowerOf10(
+	std::size_t exponent
+)
+{
+	static const double POWERS[NUMBER_PARSER_EXACT_POWER_MAX + 1] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+	return POWERS[exponent];
+}
+
+// 仮数が大きい、または小数部の桁が多い場合は strtod で正しく丸める
+static inline NumberParseStatus _parseDecimalSlow(
+	const char *begin,
+	const char *end,
+	double &value
+)
+{
+	std::size_t length = end - begin;
+	char buffer[NUMBER_PARSER_BUFFER_SIZE];
+	std::string longBuffer;
+	const char *str = buffer;
+	if (length < NUMBER_PARSER_BUFFER_SIZE) {
+		std::memcpy(buffer, begin, length);
+		buffer[length] = '\0';
+	} else {
+		longBuffer.assign(begin, end);
+		str = longBuffer.c_str();
+	}
+	value = std::strtod(str, NULL);
+	return value == HUGE_VAL ? NUMBER_PARSE_OVERFLOW : NUMBER_PARSE_OK;
+}
+
+// "123", "1.5", "0.25", "7.", ".5" の形式の符号なしの10進数を value に変換する (指数表記は受け付けない)
+// 結果は strtod と同じく最も近い double に丸める
+// 仮数が 2^53 以下で小数部が 22 桁以下なら、仮数を整数として読み 10^小数部の桁数 で1回だけ割る
+// (どちらも double で正確に表せるので、割り算1回の丸めで正しい結果になる)
+// OVERFLOW の場合、value は HUGE_VAL になる
+inline NumberParseStatus parseDecimal(
+	const char *begin,
+	const char *end,
+	double &value
+)
+{
+	unsigned long long mantissa = 0;
+	bool isOverflow = false;
+	const char *integerEnd = parseDigitPrefix(begin, end, mantissa, isOverflow);
+	const char *fractionBegin = integerEnd;
+	const char *fractionEnd = integerEnd;
+	if (integerEnd != end) {
+		if (*integerEnd != '.')
+			return NUMBER_PARSE_INVALID;
+		fractionBegin = integerEnd + 1;
+		fractionEnd = parseDigitPrefix(fractionBegin, end, mantissa, isOverflow);
+		if (fractionEnd != end)
+			return NUMBER_PARSE_INVALID;
+	}
+	if (begin == integerEnd && fractionBegin == fractionEnd)
+		return NUMBER_PARSE_INVALID;
+
+	std::size_t fractionDigits = fractionEnd - fractionBegin;
+	if (!isOverflow && fractionDigits <= NUMBER_PARSER_EXACT_POWER_MAX && mantissa <= NUMBER_PARSER_EXACT_MANTISSA_MAX) {
+		value = static_cast<double>(mantissa) / _getPowerOf10(fractionDigits);
+		return NUMBER_PARSE_OK;
+	}
+	return _parseDecimalSlow(begin, end, value);
+}
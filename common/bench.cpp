@@ -0,0 +1,438 @@
+#include <time.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "./NumberParser.hpp"
+
+// ex00, ex01, ex02 がそれぞれ数値を読む処理を、NumberParser を使う前 (before) と後 (after) で比べる
+// before は各プログラムで置き換える前の処理をそのまま写したもの
+
+#define DATE_FORMAT "YYYY-MM-DD"
+#define INPUT_FILE_SEPARATOR " | "
+
+typedef enum Workload {
+	WORKLOAD_BTC,
+	WORKLOAD_RPN,
+	WORKLOAD_PMERGEME_SHORT,
+	WORKLOAD_PMERGEME_LONG,
+	WORKLOAD_COUNT
+} Workload;
+
+static const char *const WORKLOAD_NAMES[WORKLOAD_COUNT] = {
+	"ex00 btc (date | value)",
+	"ex01 RPN (tokens)",
+	"ex02 PmergeMe (1-6 digits)",
+	"ex02 PmergeMe (10-20 digits)",
+};
+
+typedef struct BenchOption {
+	std::size_t count;
+	std::size_t repeatCount;
+	unsigned long seed;
+} BenchOption;
+
+// 再現性のため、標準の rand() ではなく自前の xorshift を使う
+static unsigned long _nextRandom(
+	unsigned long &state
+)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static struct timespec _now(
+)
+{
+	struct timespec time;
+	if (clock_gettime(CLOCK_MONOTONIC, &time) != 0) {
+		const char *msg = std::strerror(errno);
+		throw std::runtime_error(msg);
+	}
+	return time;
+}
+
+static double _elapsedNs(
+	const struct timespec &start,
+	const struct timespec &end
+)
+{
+	return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+// btc ===
+static bool _isLeapYear(
+	unsigned int year
+)
+{
+	return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+static bool _isValidDay(
+	unsigned int year,
+	unsigned int month,
+	unsigned int day
+)
+{
+	static const unsigned int DAYS[13] = {31, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	if (12 < month || DAYS[month] < day)
+		return false;
+	return month != 2 || day <= 28 || _isLeapYear(year);
+}
+
+// before: substr で切り出し、atoi / atof で変換する
+static bool _isValidDateStrBefore(
+	const std::string &date
+)
+{
+	if (date.length() != sizeof(DATE_FORMAT) - 1)
+		return false;
+	for (std::size_t i = 0; i < sizeof(DATE_FORMAT) - 1; i++) {
+		if (DATE_FORMAT[i] == '-' ? date[i] != '-' : !std::isdigit(date[i]))
+			return false;
+	}
+	int month = std::atoi(date.substr(5, 2).c_str());
+	int day = std::atoi(date.substr(8, 2).c_str());
+	int year = std::atoi(date.substr(0, 4).c_str());
+	return _isValidDay(year, month, day);
+}
+
+static bool _isValidPositiveNumStrBefore(
+	const std::string &str
+)
+{
+	bool hasDot = false;
+	if (str.empty())
+		return false;
+	for (std::size_t i = 0; i < str.length(); i++) {
+		if (str[i] == '.') {
+			if (hasDot)
+				return false;
+			hasDot = true;
+		} else if (!std::isdigit(str[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool _parseBtcLineBefore(
+	const std::string &line,
+	double &value
+)
+{
+	std::string date = line.substr(0, sizeof(DATE_FORMAT) - 1);
+	std::string separator = line.substr(sizeof(DATE_FORMAT) - 1, sizeof(INPUT_FILE_SEPARATOR) - 1);
+	std::string valueStr = line.substr(sizeof(DATE_FORMAT) + sizeof(INPUT_FILE_SEPARATOR) - 2);
+	if (separator != INPUT_FILE_SEPARATOR || !_isValidDateStrBefore(date) || !_isValidPositiveNumStrBefore(valueStr))
+		return false;
+	value = std::atof(valueStr.c_str());
+	return true;
+}
+
+// after: 行の中をそのまま読む
+static bool _isValidDateStrAfter(
+	const char *begin,
+	const char *end
+)
+{
+	if (static_cast<std::size_t>(end - begin) != sizeof(DATE_FORMAT) - 1)
+		return false;
+	for (std::size_t i = 0; i < sizeof(DATE_FORMAT) - 1; i++) {
+		if (DATE_FORMAT[i] == '-' ? begin[i] != '-' : !isDecimalDigit(begin[i]))
+			return false;
+	}
+	unsigned int year = 0, month = 0, day = 0;
+	parseUnsigned(begin, begin + 4, year);
+	parseUnsigned(begin + 5, begin + 7, month);
+	parseUnsigned(begin + 8, begin + 10, day);
+	return _isValidDay(year, month, day);
+}
+
+static bool _parseBtcLineAfter(
+	const std::string &line,
+	double &value
+)
+{
+	const char *begin = line.data();
+	const char *end = begin + line.length();
+	const char *dateEnd = begin + sizeof(DATE_FORMAT) - 1;
+	if (line.compare(sizeof(DATE_FORMAT) - 1, sizeof(INPUT_FILE_SEPARATOR) - 1, INPUT_FILE_SEPARATOR) != 0 || !_isValidDateStrAfter(begin, dateEnd))
+		return false;
+	return parseDecimal(dateEnd + sizeof(INPUT_FILE_SEPARATOR) - 1, end, value) != NUMBER_PARSE_INVALID;
+}
+
+// RPN ===
+// RPN の値は1桁の数字なので、変わるのは文字の判定 (ロケールを見る std::isdigit か否か) だけ
+static bool _parseRpnTokenBefore(
+	char c,
+	long &value
+)
+{
+	if (!std::isdigit(c))
+		return false;
+	value = c - '0';
+	return true;
+}
+
+static bool _parseRpnTokenAfter(
+	char c,
+	long &value
+)
+{
+	if (!isDecimalDigit(c))
+		return false;
+	value = c - '0';
+	return true;
+}
+
+// PmergeMe ===
+// before: 1桁ずつ溢れを確認しながら足していく
+static bool _parsePmergeMeValueBefore(
+	const char *begin,
+	const char *end,
+	unsigned long long &value
+)
+{
+	const unsigned long long max = std::numeric_limits<unsigned long long>::max();
+	value = 0;
+	for (const char *p = begin; p != end; ++p) {
+		unsigned int digit = static_cast<unsigned char>(*p - '0');
+		if (9 < digit)
+			return false;
+		if (max / 10 <= value && (max / 10 < value || max % 10 < digit))
+			return false;
+		value = value * 10 + digit;
+	}
+	return true;
+}
+
+static bool _parsePmergeMeValueAfter(
+	const char *begin,
+	const char *end,
+	unsigned long long &value
+)
+{
+	return parseUnsigned(begin, end, value) == NUMBER_PARSE_OK;
+}
+
+static std::string _formatNumber(
+	unsigned long long value
+)
+{
+	char buffer[32];
+	std::sprintf(buffer, "%llu", value);
+	return buffer;
+}
+
+static std::vector<std::string> generateInput(
+	Workload workload,
+	const BenchOption &option,
+	unsigned long &state
+)
+{
+	std::vector<std::string> items;
+	items.reserve(option.count);
+	for (std::size_t i = 0; i < option.count; i++) {
+		char buffer[64];
+		switch (workload) {
+			case WORKLOAD_BTC:
+				// 価格の形式 (整数, 小数2桁, 小数多め) を混ぜる
+				switch (_nextRandom(state) % 3) {
+					case 0:
+						std::sprintf(buffer, "20%02lu-%02lu-%02lu | %lu", _nextRandom(state) % 25, _nextRandom(state) % 12 + 1, _nextRandom(state) % 28 + 1, _nextRandom(state) % 1000);
+						break;
+					case 1:
+						std::sprintf(buffer, "20%02lu-%02lu-%02lu | %lu.%02lu", _nextRandom(state) % 25, _nextRandom(state) % 12 + 1, _nextRandom(state) % 28 + 1, _nextRandom(state) % 1000, _nextRandom(state) % 100);
+						break;
+					default:
+						std::sprintf(buffer, "20%02lu-%02lu-%02lu | %lu.%07lu", _nextRandom(state) % 25, _nextRandom(state) % 12 + 1, _nextRandom(state) % 28 + 1, _nextRandom(state) % 1000, _nextRandom(state) % 10000000);
+						break;
+				}
+				items.push_back(buffer);
+				break;
+			case WORKLOAD_RPN:
+				items.push_back(std::string(1, "0123456789+-*/"[_nextRandom(state) % 14]));
+				break;
+			case WORKLOAD_PMERGEME_SHORT: {
+				unsigned long long limit = 1;
+				for (std::size_t digits = _nextRandom(state) % 6 + 1; digits != 0; digits--) {
+					limit *= 10;
+				}
+				items.push_back(_formatNumber(_nextRandom(state) % limit));
+				break;
+			}
+			case WORKLOAD_PMERGEME_LONG: {
+				unsigned long long value = (static_cast<unsigned long long>(_nextRandom(state)) << 32) ^ _nextRandom(state);
+				items.push_back(_formatNumber(value >> (_nextRandom(state) % 31)));
+				break;
+			}
+			case WORKLOAD_COUNT:
+				break;
+		}
+	}
+	return items;
+}
+
+// 全項目を1回読み、値の合計を返す (読めなかった項目は数えて捨てる)
+static double parseAll(
+	Workload workload,
+	bool isAfter,
+	const std::vector<std::string> &items,
+	std::size_t &invalidCount
+)
+{
+	double sum = 0;
+	invalidCount = 0;
+	for (std::size_t i = 0; i < items.size(); i++) {
+		const std::string &item = items[i];
+		bool isValid = false;
+		switch (workload) {
+			case WORKLOAD_BTC: {
+				double value = 0;
+				isValid = isAfter ? _parseBtcLineAfter(item, value) : _parseBtcLineBefore(item, value);
+				sum += value;
+				break;
+			}
+			case WORKLOAD_RPN: {
+				long value = 0;
+				isValid = isAfter ? _parseRpnTokenAfter(item[0], value) : _parseRpnTokenBefore(item[0], value);
+				sum += value;
+				break;
+			}
+			case WORKLOAD_PMERGEME_SHORT:
+			case WORKLOAD_PMERGEME_LONG: {
+				unsigned long long value = 0;
+				const char *begin = item.data();
+				const char *end = begin + item.length();
+				isValid = isAfter ? _parsePmergeMeValueAfter(begin, end, value) : _parsePmergeMeValueBefore(begin, end, value);
+				sum += static_cast<double>(value);
+				break;
+			}
+			case WORKLOAD_COUNT:
+				break;
+		}
+		if (!isValid)
+			++invalidCount;
+	}
+	return sum;
+}
+
+static bool parseOption(
+	const char *arg,
+	BenchOption &option
+)
+{
+	const char *eq = std::strchr(arg, '=');
+	if (std::strncmp(arg, "--", 2) != 0 || eq == NULL)
+		return false;
+	std::string key(arg + 2, eq);
+	const char *value = eq + 1;
+
+	unsigned long number;
+	if (parseUnsigned(value, value + std::strlen(value), number) != NUMBER_PARSE_OK)
+		return false;
+	if (key == "count" && number != 0)
+		option.count = number;
+	else if (key == "repeat" && number != 0)
+		option.repeatCount = number;
+	else if (key == "seed")
+		option.seed = number == 0 ? 1 : number;
+	else
+		return false;
+	return true;
+}
+
+int main(
+	int argc,
+	const char **argv
+)
+{
+	BenchOption option;
+	option.count = 1000000;
+	option.repeatCount = 5;
+	option.seed = 42;
+	for (int i = 1; i < argc; i++) {
+		if (!parseOption(argv[i], option)) {
+			std::cerr
+				<< "Usage: "
+				<< argv[0]
+				<< " [--count=N] [--repeat=N] [--seed=N]"
+				<< std::endl;
+			return 1;
+		}
+	}
+
+	std::cout
+		<< std::left << std::setw(30) << "workload"
+		<< std::right << std::setw(10) << "items"
+		<< std::setw(14) << "before MB/s"
+		<< std::setw(14) << "after MB/s"
+		<< std::setw(9) << "speedup"
+		<< std::endl;
+	bool isFailed = false;
+	try {
+		for (int workload = 0; workload < WORKLOAD_COUNT; workload++) {
+			unsigned long state = option.seed;
+			std::vector<std::string> items = generateInput(static_cast<Workload>(workload), option, state);
+			std::size_t byteCount = 0;
+			for (std::size_t i = 0; i < items.size(); i++) {
+				byteCount += items[i].length();
+			}
+
+			// before と after で同じ値が読めることを確認してから測る
+			std::size_t invalidBefore, invalidAfter;
+			double sumBefore = parseAll(static_cast<Workload>(workload), false, items, invalidBefore);
+			double sumAfter = parseAll(static_cast<Workload>(workload), true, items, invalidAfter);
+			if (sumBefore != sumAfter || invalidBefore != invalidAfter) {
+				std::cerr
+					<< "MISMATCH " << WORKLOAD_NAMES[workload]
+					<< ": before " << sumBefore << " (" << invalidBefore << " invalid)"
+					<< ", after " << sumAfter << " (" << invalidAfter << " invalid)"
+					<< std::endl;
+				isFailed = true;
+			}
+
+			double elapsedNs[2];
+			for (int isAfter = 0; isAfter < 2; isAfter++) {
+				std::size_t invalidCount;
+				volatile double sink = 0;
+				struct timespec start = _now();
+				for (std::size_t r = 0; r < option.repeatCount; r++) {
+					sink = sink + parseAll(static_cast<Workload>(workload), isAfter != 0, items, invalidCount);
+				}
+				struct timespec end = _now();
+				elapsedNs[isAfter] = _elapsedNs(start, end);
+			}
+
+			double megabytes = static_cast<double>(byteCount) * option.repeatCount / 1e6;
+			std::cout
+				<< std::left << std::setw(30) << WORKLOAD_NAMES[workload]
+				<< std::right << std::setw(10) << items.size()
+				<< std::fixed << std::setprecision(1)
+				<< std::setw(14) << megabytes / (elapsedNs[0] / 1e9)
+				<< std::setw(14) << megabytes / (elapsedNs[1] / 1e9)
+				<< std::setprecision(2)
+				<< std::setw(8) << elapsedNs[0] / elapsedNs[1] << "x"
+				<< std::endl;
+		}
+	} catch (const std::exception &e) {
+		std::cerr
+			<< "Error: "
+			<< e.what()
+			<< std::endl;
+		return 1;
+	}
+	return isFailed ? 1 : 0;
+}
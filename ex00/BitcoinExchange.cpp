@@ -1,40 +1,46 @@
 #include "./BitcoinExchange.hpp"
 
-#include <cctype>
 #include <cstddef>
-#include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 
+#include "../common/NumberParser.hpp"
+
 #define COLUMN_NAME_DATE "date"
 #define COLUMN_NAME_PRICE "exchange_rate"
 #define CSV_HEADER COLUMN_NAME_DATE "," COLUMN_NAME_PRICE
 
 bool isValidDateStr(
-	const std::string &date
+	const char *begin,
+	const char *end
 )
 {
-	if (date.length() != sizeof(DATE_FORMAT) - 1) {
+	if (static_cast<std::size_t>(end - begin) != sizeof(DATE_FORMAT) - 1) {
 		return false;
 	}
 
 	for (std::size_t i = 0; i < sizeof(DATE_FORMAT) - 1; i++) {
 		if (DATE_FORMAT[i] == '-') {
-			if (date[i] != '-') {
+			if (begin[i] != '-') {
 				return false;
 			}
 		} else {
-			if (!std::isdigit(date[i])) {
+			if (!isDecimalDigit(begin[i])) {
 				return false;
 			}
 		}
 	}
 
-	int month = std::atoi(date.substr(5, 2).c_str());
-	if (12 < month)
+	// 桁はすべて検査済みなので、変換は失敗しない
+	unsigned int month = 0;
+	parseUnsigned(begin + 5, begin + 7, month);
+	if (month == 0 || 12 < month)
+		return false;
+	unsigned int day = 0;
+	parseUnsigned(begin + 8, begin + 10, day);
+	if (day == 0)
 		return false;
-	int day = std::atoi(date.substr(8, 2).c_str());
 	switch (month) {
 		case 1:
 		case 3:
@@ -59,7 +65,8 @@ bool isValidDateStr(
 			if (29 < day)
 				return false;
 			bool isLeapYear = false;
-			int year = std::atoi(date.substr(0, 4).c_str());
+			unsigned int year = 0;
+			parseUnsigned(begin, begin + 4, year);
 			// 特殊な暦は考慮しない
 			if (year % 4 == 0) {
 				if (year % 100 == 0) {
@@ -76,36 +83,82 @@ bool isValidDateStr(
 
 	return true;
 }
-bool isValidPositiveNumStr(
-	const std::string &str
+bool parsePositiveNum(
+	const char *begin,
+	const char *end,
+	double &value
 )
 {
-	bool hasDot = false;
+	return parseDecimal(begin, end, value) != NUMBER_PARSE_INVALID;
+}
 
-	if (str.empty())
-		return false;
+#define SECONDS_PER_DAY (24 * 60 * 60)
+// 1970-01-01 からの日数 (グレゴリオ暦を過去にも延長して数える)
+static long long _getDaysFromEpoch(
+	unsigned int year,
+	unsigned int month,
+	unsigned int day
+)
+{
+	// 3月始まりの年として数え、閏日を年の最後に置く
+	long long y = static_cast<long long>(year) - (month <= 2 ? 1 : 0);
+	long long era = (0 <= y ? y : y - 399) / 400;
+	long long yearOfEra = y - era * 400;
+	long long dayOfYear = (153 * (month + (2 < month ? -3 : 9)) + 2) / 5 + day - 1;
+	long long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
 
-	for (std::size_t i = 0; i < str.length(); i++) {
-		if (str[i] == '.') {
-			if (hasDot)
+bool parseTimestampStr(
+	const char *begin,
+	const char *end,
+	TickStore::TIMESTAMP_TYPE &timestamp
+)
+{
+	const std::size_t dateLength = sizeof(DATE_FORMAT) - 1;
+	std::size_t length = end - begin;
+	if (length != dateLength && length != sizeof(TIMESTAMP_FORMAT) - 1)
+		return false;
+	if (!isValidDateStr(begin, begin + dateLength))
+		return false;
+	unsigned int year = 0;
+	unsigned int month = 0;
+	unsigned int day = 0;
+	parseUnsigned(begin, begin + 4, year);
+	parseUnsigned(begin + 5, begin + 7, month);
+	parseUnsigned(begin + 8, begin + 10, day);
+
+	unsigned int hour = 0;
+	unsigned int minute = 0;
+	unsigned int second = 0;
+	if (length != dateLength) {
+		for (std::size_t i = dateLength; i < length; i++) {
+			char format = TIMESTAMP_FORMAT[i];
+			if (format == ' ' || format == ':' ? begin[i] != format : !isDecimalDigit(begin[i]))
 				return false;
-			hasDot = true;
-		} else if (!std::isdigit(str[i])) {
-			return false;
 		}
+		parseUnsigned(begin + 11, begin + 13, hour);
+		parseUnsigned(begin + 14, begin + 16, minute);
+		parseUnsigned(begin + 17, begin + 19, second);
+		// 閏秒は考慮しない
+		if (23 < hour || 59 < minute || 59 < second)
+			return false;
 	}
 
+	timestamp = _getDaysFromEpoch(year, month, day) * SECONDS_PER_DAY + hour * 60 * 60 + minute * 60 + second;
 	return true;
 }
 
 BitcoinExchange::BitcoinExchange(
-) : _priceHistory()
+) : _priceHistory(),
+		_tickStore()
 {
 }
 
 BitcoinExchange::BitcoinExchange(
 	const BitcoinExchange &src
-) : _priceHistory(src._priceHistory)
+) : _priceHistory(src._priceHistory),
+		_tickStore(src._tickStore)
 {
 }
 
@@ -122,21 +175,32 @@ BitcoinExchange &BitcoinExchange::operator=(
 		return *this;
 
 	this->_priceHistory = src._priceHistory;
+	this->_tickStore = src._tickStore;
 
 	return *this;
 }
 
 double BitcoinExchange::getLatestPriceAt(const std::string &date) const
 {
+	if (this->_tickStore.isOpen()) {
+		TickStore::TIMESTAMP_TYPE timestamp;
+		if (!parseTimestampStr(date.data(), date.data() + date.length(), timestamp))
+			return 0;
+		if (date.length() == sizeof(DATE_FORMAT) - 1)
+			timestamp += SECONDS_PER_DAY - 1;
+		return this->_tickStore.getLatestPriceAt(timestamp);
+	}
+
 	double latestPrice = 0.0f;
 	for (
 		std::vector<PriceHistory>::const_iterator it = _priceHistory.begin();
 		it != _priceHistory.end();
 		++it
 	) {
-		if (it->date == date)
+		int order = it->date.compare(0, std::string::npos, date, 0, sizeof(DATE_FORMAT) - 1);
+		if (order == 0)
 			return it->price;
-		else if (date < it->date)
+		else if (0 < order)
 			break;
 		else
 			latestPrice = it->price;
@@ -225,7 +289,15 @@ BitcoinExchange BitcoinExchange::loadFromFile(
 	return db;
 }
 
-#pragma region PriceHistory
+BitcoinExchange BitcoinExchange::loadFromTickStore(
+	const std::string &storePath
+)
+{
+	BitcoinExchange db;
+	db._tickStore = TickStore(storePath);
+	return db;
+}
+
 BitcoinExchange::PriceHistory::PriceHistory(
 	const std::string &date,
 	double price
@@ -265,14 +337,13 @@ BitcoinExchange::PriceHistory BitcoinExchange::PriceHistory::fromCsvLine(
 	if (line[COMMA_POS] != ',')
 		throw std::invalid_argument("Invalid line format");
 
-	std::string date = line.substr(0, sizeof(DATE_FORMAT) - 1);
-	std::string priceStr = line.substr(COMMA_POS + 1);
-	if (!isValidDateStr(date))
+	const char *begin = line.data();
+	const char *end = begin + line.length();
+	if (!isValidDateStr(begin, begin + COMMA_POS))
 		throw std::invalid_argument("Invalid date format");
-	if (!isValidPositiveNumStr(priceStr))
+	double price;
+	if (!parsePositiveNum(begin + COMMA_POS + 1, end, price))
 		throw std::invalid_argument("Invalid price format");
 
-	double price = std::atof(priceStr.c_str());
-	return PriceHistory(date, price);
+	return PriceHistory(line.substr(0, COMMA_POS), price);
 }
-#pragma endregion PriceHistory
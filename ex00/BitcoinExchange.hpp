@@ -3,10 +3,18 @@
 #include <string>
 #include <vector>
 
+#include "./TickStore.hpp"
+
 #define DATE_FORMAT "YYYY-MM-DD"
+#define TIME_FORMAT "HH:MM:SS"
+#define TIMESTAMP_FORMAT DATE_FORMAT " " TIME_FORMAT
 
-bool isValidDateStr(const std::string &str);
-bool isValidPositiveNumStr(const std::string &str);
+// [begin, end) を検査する (std::string にコピーせずに行の一部を渡せる)
+bool isValidDateStr(const char *begin, const char *end);
+// 符号なしの10進数 (指数表記なし) を value に変換する (溢れる場合は inf)
+bool parsePositiveNum(const char *begin, const char *end, double &value);
+// DATE_FORMAT (その日の 00:00:00) または TIMESTAMP_FORMAT を、UTC の秒数に変換する
+bool parseTimestampStr(const char *begin, const char *end, TickStore::TIMESTAMP_TYPE &timestamp);
 
 class BitcoinExchange
 {
@@ -24,6 +32,8 @@ class BitcoinExchange
 	} PriceHistory;
 
 	std::vector<PriceHistory> _priceHistory;
+	// 開いている場合は、_priceHistory の代わりにこちらを引く
+	TickStore _tickStore;
 
  public:
 	BitcoinExchange();
@@ -31,7 +41,10 @@ class BitcoinExchange
 	virtual ~BitcoinExchange();
 	BitcoinExchange &operator=(const BitcoinExchange &src);
 
+	// date は DATE_FORMAT または TIMESTAMP_FORMAT (日単位の履歴では、日付の部分だけを見る)
+	// DATE_FORMAT で秒単位の履歴を引く場合は、その日の終わり時点の価格を返す
 	double getLatestPriceAt(const std::string &date) const;
 
 	static BitcoinExchange loadFromFile(const std::string &filePath);
+	static BitcoinExchange loadFromTickStore(const std::string &storePath);
 };
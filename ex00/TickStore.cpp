@@ -0,0 +1,400 @@
+#include "./TickStore.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "./BitcoinExchange.hpp"
+
+#define TICK_CSV_HEADER "timestamp,exchange_rate"
+#define DAILY_CSV_HEADER "date,exchange_rate"
+
+const std::size_t TickStore::DEFAULT_BLOCK_TICK_COUNT = 4096 / sizeof(TickStore::TIMESTAMP_TYPE);
+const std::size_t TickStore::HEADER_SIZE = 4096;
+
+static const char MAGIC[8] = {'B', 'T', 'C', 'T', 'I', 'C', 'K', 'S'};
+// 書いたホストと読むホストのバイト順が同じかを確かめる
+static const unsigned long long BYTE_ORDER_MARK = 0x0102030405060708ULL;
+static const unsigned long long VERSION = 1;
+
+// ヘッダの各欄 (先頭から unsigned long long ずつ)
+enum HeaderField {
+	HEADER_MAGIC,
+	HEADER_BYTE_ORDER_MARK,
+	HEADER_VERSION,
+	HEADER_BLOCK_TICK_COUNT,
+	HEADER_TICK_COUNT,
+	HEADER_BLOCK_COUNT,
+	HEADER_FENCE_OFFSET,
+	HEADER_FIELD_COUNT
+};
+
+static std::size_t _getBlockSize(
+	std::size_t blockTickCount
+)
+{
+	return blockTickCount * (sizeof(TickStore::TIMESTAMP_TYPE) + sizeof(double));
+}
+
+static void _writeAll(
+	int fd,
+	const char *data,
+	std::size_t length
+)
+{
+	while (length != 0) {
+		ssize_t ret = write(fd, data, length);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			throw std::runtime_error(std::strerror(errno));
+		}
+		data += ret;
+		length -= static_cast<std::size_t>(ret);
+	}
+}
+
+// 1ブロック分を貯めて書き出し、最後にフェンスとヘッダを書く
+class TickWriter
+{
+ private:
+	int _fd;
+	std::size_t _blockTickCount;
+	std::vector<TickStore::TIMESTAMP_TYPE> _timestamps;
+	std::vector<double> _prices;
+	std::size_t _length;
+	std::size_t _tickCount;
+	std::vector<TickStore::TIMESTAMP_TYPE> _fences;
+
+	TickWriter(const TickWriter &src);
+	TickWriter &operator=(const TickWriter &src);
+
+	void _flushBlock()
+	{
+		if (this->_length == 0)
+			return;
+		// 埋め草は最後の時刻で埋めて、ブロック内を昇順のままにしておく
+		for (std::size_t i = this->_length; i < this->_blockTickCount; i++) {
+			this->_timestamps[i] = this->_timestamps[this->_length - 1];
+			this->_prices[i] = 0;
+		}
+		this->_fences.push_back(this->_timestamps[0]);
+		_writeAll(this->_fd, reinterpret_cast<const char *>(&this->_timestamps[0]), this->_blockTickCount * sizeof(TickStore::TIMESTAMP_TYPE));
+		_writeAll(this->_fd, reinterpret_cast<const char *>(&this->_prices[0]), this->_blockTickCount * sizeof(double));
+		this->_tickCount += this->_length;
+		this->_length = 0;
+	}
+
+ public:
+	TickWriter(int fd, std::size_t blockTickCount)
+		: _fd(fd), _blockTickCount(blockTickCount), _timestamps(blockTickCount), _prices(blockTickCount), _length(0), _tickCount(0), _fences()
+	{
+		// ヘッダは最後に書くので、場所だけ空けておく
+		std::vector<char> header(TickStore::HEADER_SIZE, 0);
+		_writeAll(this->_fd, &header[0], header.size());
+	}
+	virtual ~TickWriter() {}
+
+	void append(TickStore::TIMESTAMP_TYPE timestamp, double price)
+	{
+		this->_timestamps[this->_length] = timestamp;
+		this->_prices[this->_length] = price;
+		if (++this->_length == this->_blockTickCount)
+			this->_flushBlock();
+	}
+
+	std::size_t finish()
+	{
+		this->_flushBlock();
+		if (!this->_fences.empty())
+			_writeAll(this->_fd, reinterpret_cast<const char *>(&this->_fences[0]), this->_fences.size() * sizeof(TickStore::TIMESTAMP_TYPE));
+
+		unsigned long long header[HEADER_FIELD_COUNT];
+		std::memcpy(&header[HEADER_MAGIC], MAGIC, sizeof(MAGIC));
+		header[HEADER_BYTE_ORDER_MARK] = BYTE_ORDER_MARK;
+		header[HEADER_VERSION] = VERSION;
+		header[HEADER_BLOCK_TICK_COUNT] = this->_blockTickCount;
+		header[HEADER_TICK_COUNT] = this->_tickCount;
+		header[HEADER_BLOCK_COUNT] = this->_fences.size();
+		header[HEADER_FENCE_OFFSET] = TickStore::HEADER_SIZE + this->_fences.size() * _getBlockSize(this->_blockTickCount);
+		if (lseek(this->_fd, 0, SEEK_SET) != 0)
+			throw std::runtime_error(std::strerror(errno));
+		_writeAll(this->_fd, reinterpret_cast<const char *>(header), sizeof(header));
+		return this->_tickCount;
+	}
+};
+
+TickStore::TickStore(
+) : _path(),
+		_data(NULL),
+		_length(0),
+		_blockTickCount(0),
+		_tickCount(0),
+		_fences()
+{
+}
+
+TickStore::TickStore(
+	const std::string &path
+) : _path(path),
+		_data(NULL),
+		_length(0),
+		_blockTickCount(0),
+		_tickCount(0),
+		_fences()
+{
+	this->_open();
+}
+
+TickStore::TickStore(
+	const TickStore &src
+) : _path(src._path),
+		_data(NULL),
+		_length(0),
+		_blockTickCount(0),
+		_tickCount(0),
+		_fences()
+{
+	if (src.isOpen())
+		this->_open();
+}
+
+TickStore::~TickStore(
+)
+{
+	this->_close();
+}
+
+TickStore &TickStore::operator=(
+	const TickStore &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_close();
+	this->_path = src._path;
+	if (src.isOpen())
+		this->_open();
+
+	return *this;
+}
+
+void TickStore::_open(
+)
+{
+	int fd = open(this->_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open file: " + this->_path);
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int savedErrno = errno;
+		close(fd);
+		throw std::runtime_error(std::strerror(savedErrno));
+	}
+	std::size_t length = static_cast<std::size_t>(st.st_size);
+	if (length < HEADER_SIZE) {
+		close(fd);
+		throw std::runtime_error("Invalid tick store (too short): " + this->_path);
+	}
+	void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		throw std::runtime_error(std::strerror(errno));
+	this->_data = static_cast<const char *>(data);
+	this->_length = length;
+
+	unsigned long long header[HEADER_FIELD_COUNT];
+	std::memcpy(header, this->_data, sizeof(header));
+	const char *error = NULL;
+	if (std::memcmp(&header[HEADER_MAGIC], MAGIC, sizeof(MAGIC)) != 0)
+		error = "Invalid tick store (not a tick store): ";
+	else if (header[HEADER_BYTE_ORDER_MARK] != BYTE_ORDER_MARK)
+		error = "Invalid tick store (written with another byte order): ";
+	else if (header[HEADER_VERSION] != VERSION)
+		error = "Invalid tick store (unsupported version): ";
+	if (error == NULL) {
+		std::size_t blockTickCount = header[HEADER_BLOCK_TICK_COUNT];
+		std::size_t tickCount = header[HEADER_TICK_COUNT];
+		std::size_t blockCount = header[HEADER_BLOCK_COUNT];
+		std::size_t fenceOffset = header[HEADER_FENCE_OFFSET];
+		// 最後のブロック以外は埋まっていて、フェンスまでがファイルに収まっていること
+		if (
+			blockTickCount == 0
+			|| tickCount > blockCount * blockTickCount
+			|| (blockCount != 0 && tickCount <= (blockCount - 1) * blockTickCount)
+			|| fenceOffset != HEADER_SIZE + blockCount * _getBlockSize(blockTickCount)
+			|| length < fenceOffset + blockCount * sizeof(TIMESTAMP_TYPE)
+		) {
+			error = "Invalid tick store (broken header): ";
+		} else {
+			this->_blockTickCount = blockTickCount;
+			this->_tickCount = tickCount;
+			const TIMESTAMP_TYPE *fences = reinterpret_cast<const TIMESTAMP_TYPE *>(this->_data + fenceOffset);
+			this->_fences.assign(fences, fences + blockCount);
+		}
+	}
+	if (error != NULL) {
+		std::string path = this->_path;
+		this->_close();
+		throw std::runtime_error(error + path);
+	}
+	// 引くたびに別のブロックを読むので、先読みさせない
+	madvise(data, length, MADV_RANDOM);
+}
+
+void TickStore::_close(
+)
+{
+	if (this->_data != NULL)
+		munmap(const_cast<char *>(this->_data), this->_length);
+	this->_data = NULL;
+	this->_length = 0;
+	this->_blockTickCount = 0;
+	this->_tickCount = 0;
+	this->_fences.clear();
+}
+
+const TickStore::TIMESTAMP_TYPE *TickStore::_getTimestamps(
+	std::size_t block
+) const
+{
+	return reinterpret_cast<const TIMESTAMP_TYPE *>(this->_data + HEADER_SIZE + block * _getBlockSize(this->_blockTickCount));
+}
+
+const double *TickStore::_getPrices(
+	std::size_t block
+) const
+{
+	return reinterpret_cast<const double *>(this->_getTimestamps(block) + this->_blockTickCount);
+}
+
+bool TickStore::isOpen(
+) const
+{
+	return this->_data != NULL;
+}
+
+const std::string &TickStore::getPath(
+) const
+{
+	return this->_path;
+}
+
+std::size_t TickStore::getTickCount(
+) const
+{
+	return this->_tickCount;
+}
+
+std::size_t TickStore::getBlockCount(
+) const
+{
+	return this->_fences.size();
+}
+
+double TickStore::getLatestPriceAt(
+	TIMESTAMP_TYPE timestamp
+) const
+{
+	// 先頭が timestamp 以前である最後のブロックに、求める価格がある
+	std::vector<TIMESTAMP_TYPE>::const_iterator fence = std::upper_bound(this->_fences.begin(), this->_fences.end(), timestamp);
+	if (fence == this->_fences.begin())
+		return 0;
+	std::size_t block = (fence - this->_fences.begin()) - 1;
+	std::size_t count = this->_blockTickCount;
+	if (block + 1 == this->_fences.size())
+		count = this->_tickCount - block * this->_blockTickCount;
+	const TIMESTAMP_TYPE *timestamps = this->_getTimestamps(block);
+	std::size_t index = std::upper_bound(timestamps, timestamps + count, timestamp) - timestamps;
+	return this->_getPrices(block)[index - 1];
+}
+
+std::size_t TickStore::build(
+	const std::string &csvPath,
+	const std::string &storePath,
+	std::size_t blockTickCount
+)
+{
+	if (blockTickCount == 0)
+		throw std::invalid_argument("Block tick count must be positive");
+	std::ifstream csvFile(csvPath.c_str());
+	if (!csvFile)
+		throw std::invalid_argument("Failed to open file: " + csvPath);
+	int fd = open(storePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open file: " + storePath);
+
+	// 行数が多いので、全行の検査はせず最初のエラーで止める
+	std::string error;
+	std::size_t tickCount = 0;
+	try {
+		TickWriter writer(fd, blockTickCount);
+		std::string line;
+		std::size_t lineNum = 0;
+		bool isPreviousLineEmpty = false;
+		TIMESTAMP_TYPE previousTimestamp = 0;
+		std::size_t rowCount = 0;
+		while (error.empty() && std::getline(csvFile, line)) {
+			++lineNum;
+			if (lineNum == 1) {
+				if (line != TICK_CSV_HEADER && line != DAILY_CSV_HEADER)
+					error = "Invalid header: " + line;
+				continue;
+			}
+			if (line.empty()) {
+				isPreviousLineEmpty = true;
+				continue;
+			}
+			if (isPreviousLineEmpty) {
+				--lineNum;
+				error = "Empty line appeared other than the last line";
+				break;
+			}
+
+			const char *begin = line.data();
+			const char *end = begin + line.length();
+			const char *comma = static_cast<const char *>(std::memchr(begin, ',', line.length()));
+			TIMESTAMP_TYPE timestamp;
+			double price;
+			if (comma == NULL)
+				error = "Invalid line format";
+			else if (!parseTimestampStr(begin, comma, timestamp))
+				error = "Invalid timestamp format";
+			else if (!parsePositiveNum(comma + 1, end, price))
+				error = "Invalid price format";
+			else if (rowCount != 0 && timestamp < previousTimestamp)
+				error = "Invalid timestamp order: " + std::string(begin, comma);
+			else {
+				writer.append(timestamp, price);
+				previousTimestamp = timestamp;
+				++rowCount;
+			}
+		}
+		if (lineNum == 0) {
+			error = "Empty file";
+		} else if (!error.empty()) {
+			std::stringstream errorStr;
+			errorStr << "line[" << lineNum << "]: " << error;
+			error = errorStr.str();
+		} else {
+			tickCount = writer.finish();
+		}
+	} catch (const std::exception &e) {
+		error = e.what();
+	}
+	close(fd);
+	if (!error.empty()) {
+		unlink(storePath.c_str());
+		throw std::invalid_argument(error);
+	}
+	return tickCount;
+}
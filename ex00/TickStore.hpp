@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 秒単位の価格履歴を、タイムスタンプ順に固定長のブロックに分けて持つファイル
+// - ブロックごとの先頭のタイムスタンプ (フェンス) だけをメモリに読み込む
+// - ブロック本体は mmap したままにして、引いたブロックのページだけを読ませる
+// ある時点の価格は、フェンスの二分探索 + 1ブロック内の二分探索で引ける
+//
+// ファイルの構成 (書いたホストのバイト順、読む側で一致を確認する)
+// - ヘッダ (HEADER_SIZE バイト)
+// - ブロック: タイムスタンプ blockTickCount 個, 価格 blockTickCount 個 (最後のブロックは埋め草で揃える)
+// - フェンス: ブロックごとの先頭のタイムスタンプ
+class TickStore
+{
+ public:
+	// 1970-01-01 00:00:00 UTC からの秒数
+	typedef long long TIMESTAMP_TYPE;
+
+	// ブロックのタイムスタンプ部分がちょうど1ページ (4KiB) になる数
+	static const std::size_t DEFAULT_BLOCK_TICK_COUNT;
+	// ブロックはページ境界から並べる
+	static const std::size_t HEADER_SIZE;
+
+ private:
+	std::string _path;
+	const char *_data;
+	std::size_t _length;
+	std::size_t _blockTickCount;
+	std::size_t _tickCount;
+	std::vector<TIMESTAMP_TYPE> _fences;
+
+	void _open();
+	void _close();
+	const TIMESTAMP_TYPE *_getTimestamps(std::size_t block) const;
+	const double *_getPrices(std::size_t block) const;
+
+ public:
+	TickStore();
+	explicit TickStore(const std::string &path);
+	// 同じファイルを別に mmap し直す
+	TickStore(const TickStore &src);
+	virtual ~TickStore();
+	TickStore &operator=(const TickStore &src);
+
+	bool isOpen() const;
+	const std::string &getPath() const;
+	std::size_t getTickCount() const;
+	std::size_t getBlockCount() const;
+
+	// timestamp 以前で最新の価格 (同じ時刻が複数ある場合は後のもの、存在しない場合は 0)
+	double getLatestPriceAt(TIMESTAMP_TYPE timestamp) const;
+
+	// csv (ヘッダ "timestamp,exchange_rate" または "date,exchange_rate") を読んで storePath に書き出す
+	// 行はタイムスタンプの昇順 (同じ時刻の連続は可) でなければならない
+	static std::size_t build(const std::string &csvPath, const std::string &storePath, std::size_t blockTickCount);
+};
@@ -1,12 +1,21 @@
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <list>
 #include <vector>
 
+#include "../common/NumberFormatter.hpp"
 #include "./BitcoinExchange.hpp"
 
 #define DB_FILE_PATH "data.csv"
+#define OPTION_TICKS "--ticks="
+#define OPTION_BUILD_TICKS "--build-ticks"
+#define OPTION_FORMAT "--format="
+#define FORMAT_NAME_SHORTEST "shortest"
+#define FORMAT_NAME_IOSTREAM "iostream"
+// 出力はこの大きさまで貯めてから書き出す
+#define OUTPUT_FLUSH_SIZE (64 * 1024)
 #define INPUT_FILE_SEPARATOR " | "
 #define INPUT_FILE_HEADER "date | value"
 
@@ -15,61 +24,101 @@
 #define INPUT_VALUE_MAX 1000
 #define INPUT_VALUE_STR_MAX_LEN 4
 
+static void print_usage(
+	const char *programName
+)
+{
+	std::cerr
+		<< "Usage: "
+		<< programName
+		<< " [" OPTION_TICKS "<tick store path>] [" OPTION_FORMAT FORMAT_NAME_IOSTREAM "|" FORMAT_NAME_SHORTEST "] <input file path>"
+		<< std::endl
+		<< "       "
+		<< programName
+		<< " " OPTION_BUILD_TICKS " <csv file path> <tick store path>"
+		<< std::endl;
+}
+
 #define MINIMUM_LINE_FORMAT DATE_FORMAT INPUT_FILE_SEPARATOR "0"
+// 結果・エラーを output に1行ずつ足す
+// isIntraday の場合は、日付の代わりに TIMESTAMP_FORMAT も受け付ける
 static void processOneLine(
 	const BitcoinExchange &db,
-	const std::string &line
+	const std::string &line,
+	bool isIntraday,
+	NumberFormat format,
+	std::string &output
 )
 {
 	if (line.length() < (sizeof(MINIMUM_LINE_FORMAT) - 1)) {
-		std::cout << "Error: Invalid line format (line too short)" << std::endl;
+		output += "Error: Invalid line format (line too short)\n";
 		return;
 	}
 
-	std::string date = line.substr(0, sizeof(DATE_FORMAT) - 1);
-	std::string separator = line.substr(sizeof(DATE_FORMAT) - 1, sizeof(INPUT_FILE_SEPARATOR) - 1);
-	std::string valueStr = line.substr(sizeof(DATE_FORMAT) + sizeof(INPUT_FILE_SEPARATOR) - 2);
-	if (separator != INPUT_FILE_SEPARATOR) {
-		std::cout
-			<< "Error: Invalid line format: " << line
-			<< std::endl;
+	std::size_t dateLength = sizeof(DATE_FORMAT) - 1;
+	if (
+		isIntraday
+		&& sizeof(TIMESTAMP_FORMAT INPUT_FILE_SEPARATOR) - 1 <= line.length()
+		&& line.compare(dateLength, sizeof(INPUT_FILE_SEPARATOR) - 1, INPUT_FILE_SEPARATOR) != 0
+		&& line.compare(sizeof(TIMESTAMP_FORMAT) - 1, sizeof(INPUT_FILE_SEPARATOR) - 1, INPUT_FILE_SEPARATOR) == 0
+	) {
+		dateLength = sizeof(TIMESTAMP_FORMAT) - 1;
+	}
+	const char *begin = line.data();
+	const char *end = begin + line.length();
+	const char *dateEnd = begin + dateLength;
+	const char *valueBegin = dateEnd + sizeof(INPUT_FILE_SEPARATOR) - 1;
+	if (line.compare(dateLength, sizeof(INPUT_FILE_SEPARATOR) - 1, INPUT_FILE_SEPARATOR) != 0) {
+		output += "Error: Invalid line format: ";
+		output += line;
+		output += '\n';
 		return;
 	}
-	if (!isValidDateStr(date)) {
-		std::cout
-			<< "Error: Invalid date format: " << date
-			<< std::endl;
+	TickStore::TIMESTAMP_TYPE timestamp;
+	if (isIntraday ? !parseTimestampStr(begin, dateEnd, timestamp) : !isValidDateStr(begin, dateEnd)) {
+		output += "Error: Invalid date format: ";
+		output.append(begin, dateEnd);
+		output += '\n';
 		return;
 	}
-	if (!isValidPositiveNumStr(valueStr)) {
-		std::cout
-			<< "Error: Invalid value format: " << valueStr
-			<< std::endl;
+	double value;
+	if (!parsePositiveNum(valueBegin, end, value)) {
+		output += "Error: Invalid value format: ";
+		output.append(valueBegin, end);
+		output += '\n';
 		return;
 	}
 
-	double value = std::atof(valueStr.c_str());
 	if (value <= INPUT_VALUE_MIN || INPUT_VALUE_MAX <= value) {
-		std::cout
-			<< "Error: Invalid value: " << value
-			<< std::endl;
+		output += "Error: Invalid value: ";
+		appendDecimal(output, value, format);
+		output += '\n';
 		return;
 	}
 
+	std::string date(begin, dateEnd);
 	double latestPrice = db.getLatestPriceAt(date);
 	if (latestPrice == 0) {
 		// 最新価格が0の場合は、データが存在しないとみなす (価値0のものを取引することはできないため)
-		std::cout
-			<< "Error: No price data for the date: " << date
-			<< std::endl;
+		output += "Error: No price data for the date: ";
+		output += date;
+		output += '\n';
 		return;
 	}
-	std::cout
-		<< date
-		<< " => "
-		<< value
-		<< " = " << latestPrice * value
-		<< std::endl;
+	output += date;
+	output += " => ";
+	appendDecimal(output, value, format);
+	output += " = ";
+	appendDecimal(output, latestPrice * value, format);
+	output += '\n';
+}
+
+static void flushOutput(
+	std::string &output
+)
+{
+	std::cout.write(output.data(), output.length());
+	output.clear();
 }
 
 int main(
@@ -77,30 +126,56 @@ int main(
 	const char **argv
 )
 {
-	if (argc != 2) {
-		std::cerr
-			<< "Usage: "
-			<< argv[0]
-			<< " <input file path>"
-			<< std::endl;
+	if (argc == 4 && std::strcmp(argv[1], OPTION_BUILD_TICKS) == 0) {
+		try {
+			std::size_t tickCount = TickStore::build(argv[2], argv[3], TickStore::DEFAULT_BLOCK_TICK_COUNT);
+			std::cout << tickCount << " ticks written to " << argv[3] << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << "Error: " << e.what() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+	const char *tickStorePath = NULL;
+	// 既定は変更前 (std::ostream の既定) と同じ出力にする
+	NumberFormat format = NUMBER_FORMAT_IOSTREAM;
+	if (argc < 2) {
+		print_usage(argv[0]);
 		return 1;
 	}
+	for (int i = 1; i < argc - 1; i++) {
+		if (std::strncmp(argv[i], OPTION_TICKS, sizeof(OPTION_TICKS) - 1) == 0 && argv[i][sizeof(OPTION_TICKS) - 1] != '\0') {
+			tickStorePath = argv[i] + sizeof(OPTION_TICKS) - 1;
+		} else if (std::strcmp(argv[i], OPTION_FORMAT FORMAT_NAME_SHORTEST) == 0) {
+			format = NUMBER_FORMAT_SHORTEST;
+		} else if (std::strcmp(argv[i], OPTION_FORMAT FORMAT_NAME_IOSTREAM) == 0) {
+			format = NUMBER_FORMAT_IOSTREAM;
+		} else {
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+	const char *inputPath = argv[argc - 1];
 
 	BitcoinExchange db;
 	try {
-		db = BitcoinExchange::loadFromFile(DB_FILE_PATH);
+		if (tickStorePath != NULL)
+			db = BitcoinExchange::loadFromTickStore(tickStorePath);
+		else
+			db = BitcoinExchange::loadFromFile(DB_FILE_PATH);
 	} catch (std::exception &e) {
 		std::cerr << "Error: " << e.what() << std::endl;
 		return 1;
 	}
 
 	try {
-		std::ifstream inputFile(argv[1]);
+		std::ifstream inputFile(inputPath);
 		if (!inputFile) {
-			throw std::runtime_error("Failed to open file: " + std::string(argv[1]));
+			throw std::runtime_error("Failed to open file: " + std::string(inputPath));
 		}
 
 		std::string line;
+		std::string output;
 		bool isHeader = true;
 		bool isPreviousLineEmpty = false;
 		while (std::getline(inputFile, line)) {
@@ -113,17 +188,18 @@ int main(
 			}
 			if (isPreviousLineEmpty) {
 				// ヘッダ以外のエラーは、ログのためstdoutに出力
-				std::cout
-					<< "Error: Empty line appeared other than the last line"
-					<< std::endl;
+				output += "Error: Empty line appeared other than the last line\n";
 			}
 			if (line.empty()) {
 				isPreviousLineEmpty = true;
 				continue;
 			}
 			isPreviousLineEmpty = false;
-			processOneLine(db, line);
+			processOneLine(db, line, tickStorePath != NULL, format, output);
+			if (OUTPUT_FLUSH_SIZE <= output.length())
+				flushOutput(output);
 		}
+		flushOutput(output);
 
 		if (isHeader) {
 			throw std::invalid_argument("Empty file");
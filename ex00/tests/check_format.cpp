@@ -0,0 +1,232 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../../common/NumberFormatter.hpp"
+#include "../../common/NumberParser.hpp"
+
+// formatDecimal を、std::ostream と snprintf, strtod の結果と乱数で比べる
+// - NUMBER_FORMAT_IOSTREAM: std::ostringstream << double と文字列が一致する
+// - NUMBER_FORMAT_SHORTEST: 有効数字 p 桁で書いた値について、総当たりで次を確かめる
+//   - 読み戻すと同じ値になる
+//   - p - 1 桁の10進数で、読み戻すと同じ値になるものはない (値をはさむ2つとその外側を strtod で読む)
+//   - p 桁で正しく丸めた値が読み戻せるなら、それと同じ数字の列になる (読み戻せる中で最も近い)
+
+#define DEFAULT_COUNT 1000000
+
+// 再現性のため、標準の rand() ではなく自前の xorshift を使う
+static unsigned long long _nextRandom(
+	unsigned long long &state
+)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+// 全ビットを乱数にした値, btc の入力のような値と積, 10進の境界付近の値を混ぜる
+static double _generateValue(
+	unsigned long long &state
+)
+{
+	switch (_nextRandom(state) % 4) {
+		case 0: {
+			unsigned long long bits = _nextRandom(state);
+			double value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+		case 1: {
+			double price = static_cast<double>(_nextRandom(state) % 10000000) / 100;
+			double amount = static_cast<double>(_nextRandom(state) % 100000) / 100;
+			return price * amount;
+		}
+		case 2: {
+			// x.xxxxx5 のような、6桁目で丸めが分かれる値
+			double value = static_cast<double>(_nextRandom(state) % 10000000 * 10 + 5);
+			int exponent = static_cast<int>(_nextRandom(state) % 30) - 15;
+			for (; exponent < 0; exponent++) {
+				value /= 10;
+			}
+			for (; 0 < exponent; exponent--) {
+				value *= 10;
+			}
+			return value;
+		}
+		default:
+			return static_cast<double>(_nextRandom(state) % 1000000000) / static_cast<double>(_nextRandom(state) % 1000000 + 1);
+	}
+}
+
+// 正の値の、offset 個隣の double
+static double _getNeighbour(
+	double value,
+	int offset
+)
+{
+	unsigned long long bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	bits += offset;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// 有効数字 digits 桁で正しく丸めた |value| を、桁の列 (整数) と末尾の桁の10進の指数に分ける
+static void _roundToDigits(
+	double value,
+	int digits,
+	unsigned long long &decimal,
+	int &exponent
+)
+{
+	char text[NUMBER_FORMATTER_BUFFER_SIZE];
+	std::snprintf(text, sizeof(text), "%.*e", digits - 1, value < 0 ? -value : value);
+	decimal = 0;
+	const char *p = text;
+	for (; *p != 'e'; ++p) {
+		if (*p != '.')
+			decimal = decimal * 10 + (*p - '0');
+	}
+	exponent = std::atoi(p + 1) - (digits - 1);
+}
+
+// decimal * 10^exponent を読んだ値が |value| と一致するか
+static bool _isReadBack(
+	double value,
+	unsigned long long decimal,
+	int exponent
+)
+{
+	char text[NUMBER_FORMATTER_BUFFER_SIZE * 2];
+	std::snprintf(text, sizeof(text), "%llue%d", decimal, exponent);
+	return std::strtod(text, NULL) == (value < 0 ? -value : value);
+}
+
+// 符号, 小数点, 指数を除き、前後の 0 を取り除いた数字の列
+static std::string _getSignificantDigits(
+	const std::string &text
+)
+{
+	std::string digits;
+	for (std::size_t i = 0; i < text.length() && text[i] != 'e'; i++) {
+		if (isDecimalDigit(text[i]) && (!digits.empty() || text[i] != '0'))
+			digits += text[i];
+	}
+	while (!digits.empty() && digits[digits.length() - 1] == '0') {
+		digits.erase(digits.length() - 1);
+	}
+	return digits;
+}
+
+static bool _checkValue(
+	double value
+)
+{
+	char buffer[NUMBER_FORMATTER_BUFFER_SIZE];
+	std::ostringstream expected;
+	expected << value;
+	std::string actual(buffer, formatDecimal(value, NUMBER_FORMAT_IOSTREAM, buffer));
+	if (actual != expected.str()) {
+		std::cerr << "MISMATCH iostream: expected " << expected.str() << ", got " << actual << std::endl;
+		return false;
+	}
+
+	std::string shortest(buffer, formatDecimal(value, NUMBER_FORMAT_SHORTEST, buffer));
+	if (value != value)
+		return true;
+	double parsed = std::strtod(shortest.c_str(), NULL);
+	if (parsed != value) {
+		std::cerr.precision(17);
+		std::cerr << "MISMATCH shortest: " << shortest << " does not read back as " << value << std::endl;
+		return false;
+	}
+	if (value - value != 0 || value == 0)
+		return true;
+	std::string digits = _getSignificantDigits(shortest);
+	int digitCount = static_cast<int>(digits.length());
+	unsigned long long decimal;
+	int exponent;
+	if (1 < digitCount) {
+		_roundToDigits(value, digitCount - 1, decimal, exponent);
+		for (unsigned long long candidate = decimal - 1; candidate <= decimal + 1; candidate++) {
+			if (_isReadBack(value, candidate, exponent)) {
+				std::cerr << "MISMATCH shortest: " << shortest << ", " << candidate << "e" << exponent << " is shorter" << std::endl;
+				return false;
+			}
+		}
+	}
+	_roundToDigits(value, digitCount, decimal, exponent);
+	std::ostringstream nearest;
+	nearest << decimal;
+	if (_isReadBack(value, decimal, exponent) && _getSignificantDigits(nearest.str()) != digits) {
+		std::cerr << "MISMATCH shortest: " << shortest << ", " << decimal << "e" << exponent << " is nearer" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(
+	int argc,
+	const char **argv
+)
+{
+	std::size_t count = DEFAULT_COUNT;
+	if (argc == 2 && parseUnsigned(argv[1], argv[1] + std::strlen(argv[1]), count) != NUMBER_PARSE_OK) {
+		std::cerr << "Usage: " << argv[0] << " [count]" << std::endl;
+		return 1;
+	}
+
+	static const double SPECIAL_VALUES[] = {
+		0.0, -0.0, 1.0, 0.1, 0.3, 2.5, 1e-5, 1e-4, 0.0001234565, 999999.5, 9999995, 1e16, 1e17, 1e22, 1e23,
+		5e-324, 2.2250738585072014e-308, 1.7976931348623157e308, 1.0 / 0.0, -1.0 / 0.0, 0.0 / 0.0,
+		9007199254740993.0, 0.30000000000000004, 123456789012345678.0,
+	};
+	// Ryu, Python の repr と同じ結果 (2の累乗は、正しく丸めた値より上の候補が最短になることがある)
+	static const struct {
+		double value;
+		const char *text;
+	} EXPECTED_SHORTEST[] = {
+		{0.000000059604644775390625, "5.960464477539063e-08"},
+		{0.1, "0.1"},
+		{1e23, "1e+23"},
+		{9007199254740992.0, "9007199254740992"},
+		{5e-324, "5e-324"},
+		{1.7976931348623157e308, "1.7976931348623157e+308"},
+	};
+	std::size_t failureCount = 0;
+	for (std::size_t i = 0; i < sizeof(EXPECTED_SHORTEST) / sizeof(EXPECTED_SHORTEST[0]); i++) {
+		char buffer[NUMBER_FORMATTER_BUFFER_SIZE];
+		std::string actual(buffer, formatDecimal(EXPECTED_SHORTEST[i].value, NUMBER_FORMAT_SHORTEST, buffer));
+		if (actual != EXPECTED_SHORTEST[i].text) {
+			std::cerr << "MISMATCH shortest: expected " << EXPECTED_SHORTEST[i].text << ", got " << actual << std::endl;
+			++failureCount;
+		}
+	}
+	for (std::size_t i = 0; i < sizeof(SPECIAL_VALUES) / sizeof(SPECIAL_VALUES[0]); i++) {
+		if (!_checkValue(SPECIAL_VALUES[i]))
+			++failureCount;
+	}
+	// 2の累乗 (下側の隣との間隔が半分になる境) と、その前後の値
+	for (int exponent = -1074; exponent <= 1023; exponent++) {
+		double power = std::ldexp(1.0, exponent);
+		if (!_checkValue(_getNeighbour(power, -1)) || !_checkValue(power) || !_checkValue(_getNeighbour(power, 1)))
+			++failureCount;
+	}
+	unsigned long long state = 88172645463325252ULL;
+	for (std::size_t i = 0; i < count && failureCount < 20; i++) {
+		if (!_checkValue(_generateValue(state)))
+			++failureCount;
+	}
+
+	if (failureCount != 0) {
+		std::cerr << "NG: " << failureCount << " mismatch(es)" << std::endl;
+		return 1;
+	}
+	std::cout << "OK: " << count << " random values" << std::endl;
+	return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+# 0000年・0001年の1月, 2月を含む入力で、tick store の検索結果を期待値と比べる
+# (年の前後の日付が、遠い未来のタイムスタンプにならないこと)
+# usage: check_ticks.sh <btc>
+
+BIN=$1
+DIR=$(dirname "$0")
+
+if [ ! -x "$BIN" ]; then
+	echo "usage: $0 <btc>" >&2
+	exit 2
+fi
+
+STORE=$(mktemp)
+trap 'rm -f "$STORE"' EXIT
+
+failed=0
+for csv in "$DIR"/ticks.*.csv; do
+	name=$(basename "$csv" .csv)
+	expected="$DIR/$name.expected.txt"
+	"$BIN" --build-ticks "$csv" "$STORE" > /dev/null || exit 1
+	if "$BIN" --ticks="$STORE" "$DIR/input.early-years.txt" | diff -u "$expected" -; then
+		echo "OK: $name"
+	else
+		echo "NG: $name"
+		failed=1
+	fi
+done
+exit $failed
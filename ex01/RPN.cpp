@@ -4,6 +4,8 @@
 #include <limits>
 #include <stdexcept>
 
+#include "../common/NumberParser.hpp"
+
 RPN::VALUE_TYPE RPN::MAX = std::numeric_limits<RPN::VALUE_TYPE>::max();
 RPN::VALUE_TYPE RPN::MIN = std::numeric_limits<RPN::VALUE_TYPE>::min();
 RPN::VALUE_TYPE RPN::getMAX()
@@ -45,98 +47,236 @@ RPN &RPN::operator=(
 
 RPN::VALUE_TYPE RPN::getResult(
 ) const
+{
+	RPN::VALUE_TYPE result = 0;
+	Status status = this->tryGetResult(result);
+	if (status != STATUS_OK)
+		RPN::raise(status);
+	return result;
+}
+
+RPN::Status RPN::tryGetResult(
+	RPN::VALUE_TYPE &result
+) const
 {
 	if (_valueStack.size() != 1)
-		throw std::invalid_argument("stack size is not 1");
+		return STATUS_STACK_SIZE;
 
-	return _valueStack.top();
+	result = _valueStack.top();
+	return STATUS_OK;
 }
 
-#define OP(op, validator) \
-	{ \
-		if (_valueStack.size() < 2) \
-			throw std::invalid_argument("value stack is empty"); \
-		VALUE_TYPE right = _valueStack.top(); \
-		_valueStack.pop(); \
-		VALUE_TYPE left = _valueStack.top(); \
-		_valueStack.pop(); \
-		validator(left, right); \
-		_valueStack.push(left op right); \
+void RPN::clear(
+)
+{
+	// 確保済みの領域を次の式で使い回すため、作り直さずに pop する
+	while (!_valueStack.empty())
+		_valueStack.pop();
+}
+
+const char *RPN::getStatusMessage(
+	Status status
+)
+{
+	switch (status) {
+		case STATUS_OK:
+			return "ok";
+		case STATUS_INVALID_INPUT:
+			return "invalid input";
+		case STATUS_STACK_EMPTY:
+			return "value stack is empty";
+		case STATUS_STACK_SIZE:
+			return "stack size is not 1";
+		case STATUS_DIVISION_BY_ZERO:
+			return "division by zero";
+		case STATUS_UNBOUND_VARIABLE:
+			return "unbound variable";
+		case STATUS_OVERFLOW:
+			return "overflow";
+		case STATUS_UNDERFLOW:
+		case STATUS_PRODUCT_UNDERFLOW:
+			return "underflow";
 	}
-#define OP_CASE(op, validator) \
-	case #op[0]: \
-		OP(op, validator); \
-		break;
+	return "unknown error";
+}
 
-static void _validate_plus(
+void RPN::raise(
+	Status status
+)
+{
+	switch (status) {
+		case STATUS_OK:
+			return;
+		case STATUS_OVERFLOW:
+		case STATUS_PRODUCT_UNDERFLOW:
+			throw std::overflow_error(RPN::getStatusMessage(status));
+		case STATUS_UNDERFLOW:
+			throw std::underflow_error(RPN::getStatusMessage(status));
+		default:
+			throw std::invalid_argument(RPN::getStatusMessage(status));
+	}
+}
+
+#define OP_CASE(opChar, op, validator) \
+	case opChar: { \
+		Status status = validator(left, right); \
+		if (status == STATUS_OK) \
+			result = left op right; \
+		return status; \
+	}
+
+static RPN::Status _validate_plus(
 	RPN::VALUE_TYPE left,
 	RPN::VALUE_TYPE right
 )
 {
 	if (0 < left && 0 < right && RPN::getMAX() - right < left)
-		throw std::overflow_error("overflow");
-	if (left < 0 && right < 0 && left < RPN::getMAX() - right)
-		throw std::underflow_error("underflow");
+		return RPN::STATUS_OVERFLOW;
+	if (left < 0 && right < 0 && left < RPN::getMIN() - right)
+		return RPN::STATUS_UNDERFLOW;
+	return RPN::STATUS_OK;
 }
-static void _validate_minus(
+static RPN::Status _validate_minus(
 	RPN::VALUE_TYPE left,
 	RPN::VALUE_TYPE right
 )
 {
-	if (0 < left && right < 0 && RPN::getMAX() + right < left)
-		throw std::overflow_error("overflow");
+	if (0 <= left && right < 0 && RPN::getMAX() + right < left)
+		return RPN::STATUS_OVERFLOW;
 	if (left < 0 && 0 < right && left < RPN::getMIN() + right)
-		throw std::underflow_error("underflow");
+		return RPN::STATUS_UNDERFLOW;
+	return RPN::STATUS_OK;
 }
-static void _validate_multiply(
+static RPN::Status _validate_multiply(
 	RPN::VALUE_TYPE left,
 	RPN::VALUE_TYPE right
 )
 {
 	if (left == 0 || right == 0)
-		return;
+		return RPN::STATUS_OK;
 	if ((0 < left && 0 < right) || (left < 0 && right < 0)) {
 		if (left == RPN::getMIN() || right == RPN::getMIN())
-			throw std::overflow_error("overflow");
-		else if (RPN::getMAX() / left < right)
-			throw std::overflow_error("overflow");
+			return RPN::STATUS_OVERFLOW;
+		else if (0 < left && RPN::getMAX() / left < right)
+			return RPN::STATUS_OVERFLOW;
+		else if (left < 0 && RPN::getMAX() / -left < -right)
+			return RPN::STATUS_OVERFLOW;
 	} else if (left < 0) {
 		if (left == RPN::getMIN())
-			throw std::overflow_error("overflow");
+			return RPN::STATUS_OVERFLOW;
 		else if (left < RPN::getMIN() / right)
-			throw std::overflow_error("underflow");
+			return RPN::STATUS_PRODUCT_UNDERFLOW;
 	} else {
 		if (right == RPN::getMIN())
-			throw std::overflow_error("overflow");
+			return RPN::STATUS_OVERFLOW;
 		else if (right < RPN::getMIN() / left)
-			throw std::overflow_error("underflow");
+			return RPN::STATUS_PRODUCT_UNDERFLOW;
 	}
+	return RPN::STATUS_OK;
 }
-static void _validate_divide(
+static RPN::Status _validate_divide(
 	RPN::VALUE_TYPE left,
 	RPN::VALUE_TYPE right
 )
 {
 	if (right == 0)
-		throw std::invalid_argument("division by zero");
+		return RPN::STATUS_DIVISION_BY_ZERO;
 	if (left == RPN::getMIN() && right == -1)
-		throw std::overflow_error("overflow");
+		return RPN::STATUS_OVERFLOW;
+	return RPN::STATUS_OK;
 }
-void RPN::processInput(
+bool RPN::isOperator(
 	char input
 )
 {
-	switch (input) {
-		OP_CASE(+, _validate_plus);
-		OP_CASE(-, _validate_minus);
-		OP_CASE(*, _validate_multiply);
-		OP_CASE(/, _validate_divide);
+	return input == '+' || input == '-' || input == '*' || input == '/';
+}
+
+RPN::VALUE_TYPE RPN::calculate(
+	char op,
+	RPN::VALUE_TYPE left,
+	RPN::VALUE_TYPE right
+)
+{
+	RPN::VALUE_TYPE result = 0;
+	Status status = RPN::tryCalculate(op, left, right, result);
+	if (status != STATUS_OK)
+		RPN::raise(status);
+	return result;
+}
+
+RPN::Status RPN::tryCalculate(
+	char op,
+	RPN::VALUE_TYPE left,
+	RPN::VALUE_TYPE right,
+	RPN::VALUE_TYPE &result
+)
+{
+	switch (op) {
+		OP_CASE('+', +, _validate_plus);
+		OP_CASE('-', -, _validate_minus);
+		OP_CASE('*', *, _validate_multiply);
+		OP_CASE('/', /, _validate_divide);
 
 		default:
-			if (std::isdigit(input))
-				_valueStack.push(input - '0');
-			else
-				throw std::invalid_argument("invalid input");
-			break;
+			return STATUS_INVALID_INPUT;
+	}
+}
+
+void RPN::processInput(
+	char input
+)
+{
+	Status status = this->tryProcessInput(input);
+	if (status != STATUS_OK)
+		RPN::raise(status);
+}
+
+RPN::Status RPN::tryProcessInput(
+	char input
+)
+{
+	if (RPN::isOperator(input)) {
+		if (_valueStack.size() < 2)
+			return STATUS_STACK_EMPTY;
+		VALUE_TYPE right = _valueStack.top();
+		_valueStack.pop();
+		// 失敗した場合も、従来通り2つの値は取り除いたままにする
+		VALUE_TYPE left = _valueStack.top();
+		_valueStack.pop();
+		VALUE_TYPE result = 0;
+		Status status = RPN::tryCalculate(input, left, right, result);
+		if (status != STATUS_OK)
+			return status;
+		_valueStack.push(result);
+	} else if (isDecimalDigit(input)) {
+		_valueStack.push(input - '0');
+	} else {
+		return STATUS_INVALID_INPUT;
+	}
+	return STATUS_OK;
+}
+
+RPN::Status RPN::tryEvaluate(
+	const char *begin,
+	const char *end,
+	RPN::VALUE_TYPE &result,
+	std::size_t &position
+)
+{
+	this->clear();
+	for (const char *p = begin; p != end; ++p) {
+		// スペースは必ず無視する仕様とする
+		if (std::isspace(static_cast<unsigned char>(*p)))
+			continue;
+		Status status = this->tryProcessInput(*p);
+		if (status != STATUS_OK) {
+			position = p - begin;
+			return status;
+		}
 	}
+	Status status = this->tryGetResult(result);
+	if (status != STATUS_OK)
+		position = end - begin;
+	return status;
 }
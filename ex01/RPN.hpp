@@ -1,19 +1,48 @@
 #pragma once
 
+#include <cstddef>
 #include <stack>
 #include <string>
+#include <vector>
 
 class RPN
 {
  public:
 	typedef long VALUE_TYPE;
+
+	// 例外を投げない API の結果
+	// 例外を投げる API は、同じ処理の結果を raise で対応する例外に変換する
+	typedef enum Status {
+		STATUS_OK,
+		// 以下は std::invalid_argument
+		STATUS_INVALID_INPUT,
+		STATUS_STACK_EMPTY,
+		STATUS_STACK_SIZE,
+		STATUS_DIVISION_BY_ZERO,
+		// 変数を含む式 (RPNExpression, RPNProgram) のみ
+		STATUS_UNBOUND_VARIABLE,
+		// std::overflow_error
+		STATUS_OVERFLOW,
+		// std::underflow_error
+		STATUS_UNDERFLOW,
+		// 乗算で MIN を下回る場合 (従来通り std::overflow_error("underflow") とする)
+		STATUS_PRODUCT_UNDERFLOW
+	} Status;
+
 	static RPN::VALUE_TYPE getMAX();
 	static RPN::VALUE_TYPE getMIN();
+	static bool isOperator(char input);
+	static RPN::VALUE_TYPE calculate(char op, RPN::VALUE_TYPE left, RPN::VALUE_TYPE right);
+	static Status tryCalculate(char op, RPN::VALUE_TYPE left, RPN::VALUE_TYPE right, RPN::VALUE_TYPE &result);
+	static const char *getStatusMessage(Status status);
+	// STATUS_OK 以外を、対応する例外として投げる
+	static void raise(Status status);
 
  private:
 	static VALUE_TYPE MAX;
 	static VALUE_TYPE MIN;
-	std::stack<RPN::VALUE_TYPE> _valueStack;
+	// std::deque と違い、pop しても確保済みの領域を手放さない
+	std::stack<RPN::VALUE_TYPE, std::vector<RPN::VALUE_TYPE> > _valueStack;
 
  public:
 	RPN();
@@ -23,4 +52,11 @@ class RPN
 
 	RPN::VALUE_TYPE getResult() const;
 	void processInput(char input);
+	void clear();
+
+	Status tryGetResult(RPN::VALUE_TYPE &result) const;
+	Status tryProcessInput(char input);
+	// [begin, end) をスペースを無視して評価する (前回の状態は捨てる)
+	// 失敗した場合は position に失敗した文字の位置 (スタックに値が残った場合は end - begin) を入れる
+	Status tryEvaluate(const char *begin, const char *end, RPN::VALUE_TYPE &result, std::size_t &position);
 };
@@ -0,0 +1,262 @@
+#include "./RPNBatch.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+const std::size_t RPNBatch::DEFAULT_CHUNK_SIZE = 1 << 20;
+const std::size_t RPNBatch::IN_FLIGHT_CHUNKS_PER_THREAD = 4;
+
+RPNBatch::RPNBatch(
+) : _threadCount(1),
+		_chunkSize(DEFAULT_CHUNK_SIZE),
+		_chunks(),
+		_nextChunk(0),
+		_writtenChunk(0)
+{
+}
+
+RPNBatch::RPNBatch(
+	std::size_t threadCount,
+	std::size_t chunkSize
+) : _threadCount(threadCount == 0 ? 1 : threadCount),
+		_chunkSize(chunkSize == 0 ? 1 : chunkSize),
+		_chunks(),
+		_nextChunk(0),
+		_writtenChunk(0)
+{
+}
+
+RPNBatch::RPNBatch(
+	const RPNBatch &src
+) : _threadCount(src._threadCount),
+		_chunkSize(src._chunkSize),
+		_chunks(),
+		_nextChunk(0),
+		_writtenChunk(0)
+{
+}
+
+RPNBatch::~RPNBatch(
+)
+{
+}
+
+RPNBatch &RPNBatch::operator=(
+	const RPNBatch &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_threadCount = src._threadCount;
+	this->_chunkSize = src._chunkSize;
+
+	return *this;
+}
+
+static void _appendValue(
+	std::string &output,
+	RPN::VALUE_TYPE value
+)
+{
+	char buf[32];
+	char *p = buf + sizeof(buf);
+	// MIN でも溢れないよう、負の値のまま桁を取り出す
+	bool isNegative = value < 0;
+	do {
+		RPN::VALUE_TYPE digit = value % 10;
+		*--p = static_cast<char>('0' + (isNegative ? -digit : digit));
+		value /= 10;
+	} while (value != 0);
+	if (isNegative)
+		*--p = '-';
+	output.append(p, buf + sizeof(buf) - p);
+}
+
+void RPNBatch::evaluateLine(
+	RPN &rpn,
+	const char *begin,
+	const char *end,
+	std::string &output
+)
+{
+	// 不正な行が多い入力でも遅くならないよう、例外を使わずに評価する
+	RPN::VALUE_TYPE result = 0;
+	std::size_t position = 0;
+	RPN::Status status = rpn.tryEvaluate(begin, end, result, position);
+	if (status == RPN::STATUS_OK) {
+		_appendValue(output, result);
+	} else {
+		output += "Error: ";
+		output += RPN::getStatusMessage(status);
+	}
+	output += '\n';
+}
+
+void RPNBatch::_splitChunks(
+	const char *data,
+	std::size_t length
+)
+{
+	const char *end = data + length;
+	const char *begin = data;
+	while (begin != end) {
+		const char *chunkEnd = end;
+		if (this->_chunkSize < static_cast<std::size_t>(end - begin)) {
+			// 行の途中では切らない
+			const char *newline = static_cast<const char *>(std::memchr(begin + this->_chunkSize, '\n', end - (begin + this->_chunkSize)));
+			chunkEnd = newline == NULL ? end : newline + 1;
+		}
+		Chunk chunk;
+		chunk.begin = begin;
+		chunk.end = chunkEnd;
+		chunk.isDone = false;
+		this->_chunks.push_back(chunk);
+		begin = chunkEnd;
+	}
+}
+
+void *RPNBatch::_workerMain(
+	void *arg
+)
+{
+	static_cast<RPNBatch *>(arg)->_runWorker();
+	return NULL;
+}
+
+void RPNBatch::_runWorker(
+)
+{
+	RPN rpn;
+	std::size_t inFlightLimit = this->_threadCount * IN_FLIGHT_CHUNKS_PER_THREAD;
+	std::string output;
+	while (true) {
+		pthread_mutex_lock(&this->_mutex);
+		// 書き出しが追いつくまで先に進みすぎない (メモリ使用量を抑えるため)
+		while (this->_nextChunk < this->_chunks.size() && this->_writtenChunk + inFlightLimit <= this->_nextChunk)
+			pthread_cond_wait(&this->_cond, &this->_mutex);
+		if (this->_nextChunk == this->_chunks.size()) {
+			pthread_mutex_unlock(&this->_mutex);
+			return;
+		}
+		Chunk &chunk = this->_chunks[this->_nextChunk++];
+		pthread_mutex_unlock(&this->_mutex);
+
+		output.clear();
+		output.reserve(chunk.end - chunk.begin);
+		const char *lineBegin = chunk.begin;
+		while (lineBegin != chunk.end) {
+			const char *newline = static_cast<const char *>(std::memchr(lineBegin, '\n', chunk.end - lineBegin));
+			const char *lineEnd = newline == NULL ? chunk.end : newline;
+			RPNBatch::evaluateLine(rpn, lineBegin, lineEnd, output);
+			lineBegin = newline == NULL ? chunk.end : newline + 1;
+		}
+
+		pthread_mutex_lock(&this->_mutex);
+		chunk.output.swap(output);
+		chunk.isDone = true;
+		pthread_cond_broadcast(&this->_cond);
+		pthread_mutex_unlock(&this->_mutex);
+	}
+}
+
+void RPNBatch::_writeOutputs(
+	int outputFd
+)
+{
+	int writeErrno = 0;
+	std::string output;
+	for (std::size_t i = 0; i < this->_chunks.size(); i++) {
+		pthread_mutex_lock(&this->_mutex);
+		while (!this->_chunks[i].isDone)
+			pthread_cond_wait(&this->_cond, &this->_mutex);
+		output.clear();
+		output.swap(this->_chunks[i].output);
+		++this->_writtenChunk;
+		pthread_cond_broadcast(&this->_cond);
+		pthread_mutex_unlock(&this->_mutex);
+
+		// 書き込みに失敗しても、ワーカーを止めないよう最後まで受け取る
+		std::size_t written = 0;
+		while (writeErrno == 0 && written < output.length()) {
+			ssize_t ret = write(outputFd, output.data() + written, output.length() - written);
+			if (ret < 0) {
+				if (errno != EINTR)
+					writeErrno = errno;
+				continue;
+			}
+			written += ret;
+		}
+	}
+	if (writeErrno != 0)
+		throw std::runtime_error(std::strerror(writeErrno));
+}
+
+void RPNBatch::run(
+	const std::string &inputPath,
+	int outputFd
+)
+{
+	int fd = open(inputPath.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open file: " + inputPath);
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int savedErrno = errno;
+		close(fd);
+		throw std::runtime_error(std::strerror(savedErrno));
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return;
+	}
+	std::size_t length = static_cast<std::size_t>(st.st_size);
+	void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		throw std::runtime_error(std::strerror(errno));
+	madvise(data, length, MADV_SEQUENTIAL);
+
+	this->_chunks.clear();
+	this->_nextChunk = 0;
+	this->_writtenChunk = 0;
+	this->_splitChunks(static_cast<const char *>(data), length);
+	pthread_mutex_init(&this->_mutex, NULL);
+	pthread_cond_init(&this->_cond, NULL);
+
+	std::vector<pthread_t> threads(this->_threadCount);
+	std::size_t startedCount = 0;
+	while (startedCount < this->_threadCount) {
+		if (pthread_create(&threads[startedCount], NULL, RPNBatch::_workerMain, this) != 0)
+			break;
+		++startedCount;
+	}
+
+	std::string errorMessage;
+	if (startedCount == 0) {
+		errorMessage = "Failed to create thread";
+	} else {
+		try {
+			this->_writeOutputs(outputFd);
+		} catch (const std::exception &e) {
+			errorMessage = e.what();
+		}
+	}
+	for (std::size_t i = 0; i < startedCount; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&this->_cond);
+	pthread_mutex_destroy(&this->_mutex);
+	this->_chunks.clear();
+	munmap(data, length);
+
+	if (!errorMessage.empty())
+		throw std::runtime_error(errorMessage);
+}
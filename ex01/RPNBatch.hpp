@@ -0,0 +1,53 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "./RPN.hpp"
+
+// 1行1式のファイルを複数スレッドで評価し、入力と同じ順序で結果を出力する
+// 入力はメモリマップし、一定サイズのチャンク (行の途中では切らない) 単位でスレッドに割り当てる
+class RPNBatch
+{
+ public:
+	static const std::size_t DEFAULT_CHUNK_SIZE;
+	// 書き出し待ちにしてよいチャンク数 (スレッド数に対する倍率)
+	static const std::size_t IN_FLIGHT_CHUNKS_PER_THREAD;
+
+ private:
+	typedef struct Chunk {
+		const char *begin;
+		const char *end;
+		bool isDone;
+		std::string output;
+	} Chunk;
+
+	std::size_t _threadCount;
+	std::size_t _chunkSize;
+
+	// 実行中のみ有効
+	std::vector<Chunk> _chunks;
+	std::size_t _nextChunk;
+	std::size_t _writtenChunk;
+	pthread_mutex_t _mutex;
+	pthread_cond_t _cond;
+
+	static void *_workerMain(void *arg);
+	void _runWorker();
+	void _splitChunks(const char *data, std::size_t length);
+	void _writeOutputs(int outputFd);
+
+ public:
+	RPNBatch();
+	RPNBatch(std::size_t threadCount, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+	RPNBatch(const RPNBatch &src);
+	virtual ~RPNBatch();
+	RPNBatch &operator=(const RPNBatch &src);
+
+	void run(const std::string &inputPath, int outputFd);
+
+	static void evaluateLine(RPN &rpn, const char *begin, const char *end, std::string &output);
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+// ビルド時に値が決まる式を、実行時の解析やスタックなしで評価するためのヘッダ
+// RPN.cpp と同じ規則で検査し、エラーは throw に到達することでコンパイルエラーになる
+// constexpr 関数内でループを使うため C++14 以上が必要 (make constexpr でビルドする)
+#if __cplusplus < 201402L
+#error "RPNConstexpr.hpp requires C++14 or later"
+#endif
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace RPNConstexpr
+{
+// RPN::VALUE_TYPE と同じ型
+typedef long VALUE_TYPE;
+
+constexpr VALUE_TYPE MAX = std::numeric_limits<VALUE_TYPE>::max();
+constexpr VALUE_TYPE MIN = std::numeric_limits<VALUE_TYPE>::min();
+
+constexpr bool isSpace(
+	char c
+)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+constexpr bool isDigit(
+	char c
+)
+{
+	return '0' <= c && c <= '9';
+}
+
+constexpr bool isOperator(
+	char c
+)
+{
+	return c == '+' || c == '-' || c == '*' || c == '/';
+}
+
+constexpr void validatePlus(
+	VALUE_TYPE left,
+	VALUE_TYPE right
+)
+{
+	if (0 < left && 0 < right && MAX - right < left)
+		throw std::overflow_error("overflow");
+	if (left < 0 && right < 0 && left < MIN - right)
+		throw std::underflow_error("underflow");
+}
+
+constexpr void validateMinus(
+	VALUE_TYPE left,
+	VALUE_TYPE right
+)
+{
+	if (0 <= left && right < 0 && MAX + right < left)
+		throw std::overflow_error("overflow");
+	if (left < 0 && 0 < right && left < MIN + right)
+		throw std::underflow_error("underflow");
+}
+
+constexpr void validateMultiply(
+	VALUE_TYPE left,
+	VALUE_TYPE right
+)
+{
+	if (left == 0 || right == 0)
+		return;
+	if ((0 < left && 0 < right) || (left < 0 && right < 0)) {
+		if (left == MIN || right == MIN)
+			throw std::overflow_error("overflow");
+		else if (0 < left && MAX / left < right)
+			throw std::overflow_error("overflow");
+		else if (left < 0 && MAX / -left < -right)
+			throw std::overflow_error("overflow");
+	} else if (left < 0) {
+		if (left == MIN)
+			throw std::overflow_error("overflow");
+		else if (left < MIN / right)
+			throw std::overflow_error("underflow");
+	} else {
+		if (right == MIN)
+			throw std::overflow_error("overflow");
+		else if (right < MIN / left)
+			throw std::overflow_error("underflow");
+	}
+}
+
+constexpr void validateDivide(
+	VALUE_TYPE left,
+	VALUE_TYPE right
+)
+{
+	if (right == 0)
+		throw std::invalid_argument("division by zero");
+	if (left == MIN && right == -1)
+		throw std::overflow_error("overflow");
+}
+
+constexpr VALUE_TYPE calculate(
+	char op,
+	VALUE_TYPE left,
+	VALUE_TYPE right
+)
+{
+	switch (op) {
+		case '+':
+			validatePlus(left, right);
+			return left + right;
+		case '-':
+			validateMinus(left, right);
+			return left - right;
+		case '*':
+			validateMultiply(left, right);
+			return left * right;
+		case '/':
+			validateDivide(left, right);
+			return left / right;
+		default:
+			throw std::invalid_argument("invalid input");
+	}
+}
+
+// スタックの深さは式の長さを超えないので、長さ N の配列で足りる
+template <std::size_t N>
+constexpr VALUE_TYPE evaluate(
+	const char (&expression)[N]
+)
+{
+	VALUE_TYPE valueStack[N] = {};
+	std::size_t stackSize = 0;
+	for (std::size_t i = 0; i < N && expression[i] != '\0'; i++) {
+		char c = expression[i];
+		if (isSpace(c))
+			continue;
+		if (isOperator(c)) {
+			if (stackSize < 2)
+				throw std::invalid_argument("value stack is empty");
+			VALUE_TYPE right = valueStack[--stackSize];
+			VALUE_TYPE left = valueStack[stackSize - 1];
+			valueStack[stackSize - 1] = calculate(c, left, right);
+		} else if (isDigit(c)) {
+			valueStack[stackSize++] = c - '0';
+		} else {
+			throw std::invalid_argument("invalid input");
+		}
+	}
+	if (stackSize != 1)
+		throw std::invalid_argument("stack size is not 1");
+	return valueStack[0];
+}
+
+// テンプレート引数の文字列として式を受け取る版
+// Expression<'1', ' ', '2', '+'>::value
+template <char... Input>
+struct Expression {
+	static constexpr char input[sizeof...(Input) + 1] = {Input..., '\0'};
+	static constexpr VALUE_TYPE value = evaluate(input);
+
+	constexpr VALUE_TYPE operator()() const
+	{
+		return value;
+	}
+};
+
+template <char... Input>
+constexpr char Expression<Input...>::input[sizeof...(Input) + 1];
+template <char... Input>
+constexpr VALUE_TYPE Expression<Input...>::value;
+}	 // namespace RPNConstexpr
+
+// 文字列リテラルの式を必ずコンパイル時に評価し、定数にする
+#define RPN_CONSTANT(expression) (std::integral_constant<RPNConstexpr::VALUE_TYPE, RPNConstexpr::evaluate(expression)>::value)
@@ -0,0 +1,330 @@
+#include "./RPNExpression.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include "../common/NumberParser.hpp"
+#include "./WorkStealingPool.hpp"
+
+const std::size_t RPNExpression::DEFAULT_GRAIN_SIZE = 1 << 14;
+
+RPNExpression::Error::Error(
+) : status(RPN::STATUS_OK),
+		position(0)
+{
+}
+RPNExpression::Error::Error(
+	RPN::Status status,
+	std::size_t position
+) : status(status),
+		position(position)
+{
+}
+RPNExpression::Error::Error(
+	const Error &src
+) : status(src.status),
+		position(src.position)
+{
+}
+RPNExpression::Error &RPNExpression::Error::operator=(
+	const Error &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->status = src.status;
+	this->position = src.position;
+
+	return *this;
+}
+
+bool RPNExpression::Error::isError(
+) const
+{
+	return this->status != RPN::STATUS_OK;
+}
+
+const char *RPNExpression::Error::getMessage(
+) const
+{
+	return RPN::getStatusMessage(this->status);
+}
+
+void RPNExpression::Error::raise(
+) const
+{
+	if (this->isError())
+		RPN::raise(this->status);
+}
+
+RPNExpression::RPNExpression(
+) : _length(0),
+		_nodes(),
+		_roots(),
+		_parseError()
+{
+}
+
+RPNExpression::RPNExpression(
+	const std::string &expression,
+	bool allowVariables
+) : _length(expression.length()),
+		_nodes(),
+		_roots(),
+		_parseError()
+{
+	this->_nodes.reserve(expression.length());
+	for (std::size_t i = 0; i < expression.length(); i++) {
+		char c = expression[i];
+		// スペースは必ず無視する仕様とする
+		if (std::isspace(static_cast<unsigned char>(c)))
+			continue;
+
+		Node node;
+		node.op = '\0';
+		node.value = 0;
+		node.begin = this->_nodes.size();
+		node.position = i;
+		if (RPN::isOperator(c)) {
+			if (this->_roots.size() < 2) {
+				this->_parseError = Error(RPN::STATUS_STACK_EMPTY, i);
+				break;
+			}
+			this->_roots.pop_back();
+			std::size_t left = this->_roots.back();
+			this->_roots.pop_back();
+			node.op = c;
+			node.begin = this->_nodes[left].begin;
+		} else if (isDecimalDigit(c)) {
+			node.value = c - '0';
+		} else if (allowVariables && RPNExpression::isVariable(c)) {
+			node.op = c;
+		} else {
+			this->_parseError = Error(RPN::STATUS_INVALID_INPUT, i);
+			break;
+		}
+		this->_roots.push_back(this->_nodes.size());
+		this->_nodes.push_back(node);
+	}
+}
+
+RPNExpression::RPNExpression(
+	const RPNExpression &src
+) : _length(src._length),
+		_nodes(src._nodes),
+		_roots(src._roots),
+		_parseError(src._parseError)
+{
+}
+
+RPNExpression::~RPNExpression(
+)
+{
+}
+
+RPNExpression &RPNExpression::operator=(
+	const RPNExpression &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_length = src._length;
+	this->_nodes = src._nodes;
+	this->_roots = src._roots;
+	this->_parseError = src._parseError;
+
+	return *this;
+}
+
+std::size_t RPNExpression::getLength(
+) const
+{
+	return this->_length;
+}
+const std::vector<RPNExpression::Node> &RPNExpression::getNodes(
+) const
+{
+	return this->_nodes;
+}
+const std::vector<std::size_t> &RPNExpression::getRoots(
+) const
+{
+	return this->_roots;
+}
+const RPNExpression::Error &RPNExpression::getParseError(
+) const
+{
+	return this->_parseError;
+}
+
+bool RPNExpression::isVariable(
+	char input
+)
+{
+	return 'a' <= input && input <= 'z';
+}
+
+RPNExpression::Error RPNExpression::calculate(
+	char op,
+	std::size_t position,
+	RPN::VALUE_TYPE left,
+	RPN::VALUE_TYPE right,
+	RPN::VALUE_TYPE &result
+)
+{
+	RPN::Status status = RPN::tryCalculate(op, left, right, result);
+	if (status != RPN::STATUS_OK)
+		return Error(status, position);
+	return Error();
+}
+
+RPNExpression::Error RPNExpression::evaluateRange(
+	const std::vector<Node> &nodes,
+	std::size_t begin,
+	std::size_t end,
+	RPN::VALUE_TYPE &result
+)
+{
+	std::vector<RPN::VALUE_TYPE> valueStack;
+	for (std::size_t i = begin; i < end; i++) {
+		const Node &node = nodes[i];
+		if (node.op == '\0') {
+			valueStack.push_back(node.value);
+			continue;
+		}
+		if (RPNExpression::isVariable(node.op))
+			return Error(RPN::STATUS_UNBOUND_VARIABLE, node.position);
+		RPN::VALUE_TYPE right = valueStack.back();
+		valueStack.pop_back();
+		Error error = RPNExpression::calculate(node.op, node.position, valueStack.back(), right, valueStack.back());
+		if (error.isError())
+			return error;
+	}
+	result = valueStack.back();
+	return Error();
+}
+
+class SubtreeTask : public WorkStealingPool::Task
+{
+ public:
+	const std::vector<RPNExpression::Node> *nodes;
+	std::size_t begin;
+	std::size_t end;
+	RPN::VALUE_TYPE result;
+	RPNExpression::Error error;
+
+	SubtreeTask(
+		const std::vector<RPNExpression::Node> *nodes,
+		std::size_t begin,
+		std::size_t end
+	) : nodes(nodes),
+			begin(begin),
+			end(end),
+			result(0),
+			error()
+	{
+	}
+
+	void run()
+	{
+		this->error = RPNExpression::evaluateRange(*this->nodes, this->begin, this->end, this->result);
+	}
+
+	bool operator<(const SubtreeTask &rhs) const
+	{
+		return this->begin < rhs.begin;
+	}
+};
+
+RPNExpression::Error RPNExpression::_evaluate(
+	std::size_t threadCount,
+	std::size_t grainSize,
+	RPN::VALUE_TYPE &result
+) const
+{
+	std::vector<SubtreeTask> tasks;
+	if (1 < threadCount) {
+		// grainSize 以下の部分木をタスクとして切り出す
+		// 小さすぎる部分木は、切り出すより呼び出し元でそのまま評価した方が速い
+		std::size_t minTaskSize = std::max<std::size_t>(grainSize / 16, 1);
+		std::vector<std::size_t> planStack(this->_roots);
+		while (!planStack.empty()) {
+			std::size_t root = planStack.back();
+			planStack.pop_back();
+			const Node &node = this->_nodes[root];
+			std::size_t size = root - node.begin + 1;
+			if (size <= grainSize) {
+				if (minTaskSize <= size)
+					tasks.push_back(SubtreeTask(&this->_nodes, node.begin, root + 1));
+				continue;
+			}
+			std::size_t right = root - 1;
+			planStack.push_back(right);
+			planStack.push_back(this->_nodes[right].begin - 1);
+		}
+		std::sort(tasks.begin(), tasks.end());
+
+		std::vector<WorkStealingPool::Task *> taskPtrs;
+		for (std::size_t i = 0; i < tasks.size(); i++) {
+			taskPtrs.push_back(&tasks[i]);
+		}
+		WorkStealingPool(threadCount).execute(taskPtrs);
+	}
+
+	// タスク化されなかった部分を後置順に評価し、タスクの結果を埋め込む
+	// 後置順に走査するため、最初に見つかったエラーが逐次評価で最初に発生するエラーと一致する
+	std::vector<RPN::VALUE_TYPE> valueStack;
+	std::vector<SubtreeTask>::const_iterator taskIt = tasks.begin();
+	for (std::size_t i = 0; i < this->_nodes.size();) {
+		if (taskIt != tasks.end() && taskIt->begin == i) {
+			if (taskIt->error.isError())
+				return taskIt->error;
+			valueStack.push_back(taskIt->result);
+			i = taskIt->end;
+			++taskIt;
+			continue;
+		}
+
+		const Node &node = this->_nodes[i++];
+		if (node.op == '\0') {
+			valueStack.push_back(node.value);
+			continue;
+		}
+		if (RPNExpression::isVariable(node.op))
+			return Error(RPN::STATUS_UNBOUND_VARIABLE, node.position);
+		RPN::VALUE_TYPE right = valueStack.back();
+		valueStack.pop_back();
+		Error error = RPNExpression::calculate(node.op, node.position, valueStack.back(), right, valueStack.back());
+		if (error.isError())
+			return error;
+	}
+
+	if (this->_parseError.isError())
+		return this->_parseError;
+	if (valueStack.size() != 1)
+		return Error(RPN::STATUS_STACK_SIZE, this->_length);
+
+	result = valueStack.back();
+	return Error();
+}
+
+RPN::VALUE_TYPE RPNExpression::evaluate(
+) const
+{
+	RPN::VALUE_TYPE result = 0;
+	this->_evaluate(1, 0, result).raise();
+	return result;
+}
+
+RPN::VALUE_TYPE RPNExpression::evaluateParallel(
+	std::size_t threadCount,
+	std::size_t grainSize
+) const
+{
+	RPN::VALUE_TYPE result = 0;
+	// 0 だと葉まで分割しようとするので、1ノードの部分木を最小とする
+	this->_evaluate(threadCount, std::max<std::size_t>(grainSize, 1), result).raise();
+	return result;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "./RPN.hpp"
+
+// 式を後置記法のままフラットな配列に展開したもの
+// 各ノードは自身を根とする部分木の先頭位置を持つので、独立した部分木を切り出して並列に評価できる
+class RPNExpression
+{
+ public:
+	// 失敗した演算の位置と RPN::Status (例外を投げずに持ち回れるよう、文字列は持たない)
+	typedef struct Error {
+		RPN::Status status;
+		// 入力文字列上の位置
+		std::size_t position;
+
+		Error();
+		Error(RPN::Status status, std::size_t position);
+		Error(const Error &src);
+		Error &operator=(const Error &src);
+
+		bool isError() const;
+		const char *getMessage() const;
+		void raise() const;
+	} Error;
+
+	typedef struct Node {
+		// 値ノードなら '\0'、変数ノードなら変数名 ('a' - 'z')
+		char op;
+		RPN::VALUE_TYPE value;
+		// この部分木の先頭ノードのindex
+		std::size_t begin;
+		std::size_t position;
+	} Node;
+
+	static const std::size_t DEFAULT_GRAIN_SIZE;
+
+ private:
+	std::size_t _length;
+	std::vector<Node> _nodes;
+	// 解析終了時点のスタックに残っている部分木の根
+	std::vector<std::size_t> _roots;
+	// 解析を打ち切った箇所のエラー (それ以前の演算のエラーが優先される)
+	Error _parseError;
+
+	Error _evaluate(std::size_t threadCount, std::size_t grainSize, RPN::VALUE_TYPE &result) const;
+
+ public:
+	RPNExpression();
+	RPNExpression(const std::string &expression, bool allowVariables = false);
+	RPNExpression(const RPNExpression &src);
+	virtual ~RPNExpression();
+	RPNExpression &operator=(const RPNExpression &src);
+
+	std::size_t getLength() const;
+	const std::vector<Node> &getNodes() const;
+	const std::vector<std::size_t> &getRoots() const;
+	const Error &getParseError() const;
+
+	RPN::VALUE_TYPE evaluate() const;
+	RPN::VALUE_TYPE evaluateParallel(std::size_t threadCount, std::size_t grainSize = DEFAULT_GRAIN_SIZE) const;
+
+	static bool isVariable(char input);
+	static Error calculate(char op, std::size_t position, RPN::VALUE_TYPE left, RPN::VALUE_TYPE right, RPN::VALUE_TYPE &result);
+	static Error evaluateRange(const std::vector<Node> &nodes, std::size_t begin, std::size_t end, RPN::VALUE_TYPE &result);
+};
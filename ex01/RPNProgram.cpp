@@ -0,0 +1,254 @@
+#include "./RPNProgram.hpp"
+
+bool RPNProgram::InstructionKey::operator<(
+	const InstructionKey &rhs
+) const
+{
+	if (this->op != rhs.op)
+		return this->op < rhs.op;
+	if (this->value != rhs.value)
+		return this->value < rhs.value;
+	if (this->left != rhs.left)
+		return this->left < rhs.left;
+	return this->right < rhs.right;
+}
+
+static RPNProgram::Instruction _makeInstruction(
+	char op,
+	RPN::VALUE_TYPE value,
+	std::size_t position
+)
+{
+	RPNProgram::Instruction instruction;
+	instruction.op = op;
+	instruction.value = value;
+	instruction.left = 0;
+	instruction.right = 0;
+	instruction.position = position;
+	return instruction;
+}
+
+static bool _isConstant(
+	const RPNProgram::Instruction &instruction,
+	RPN::VALUE_TYPE value
+)
+{
+	return instruction.op == '\0' && instruction.value == value;
+}
+
+RPNProgram::RPNProgram(
+) : _instructions(),
+		_roots(),
+		_structureError()
+{
+}
+
+RPNProgram::RPNProgram(
+	const RPNExpression &expression
+) : _instructions(),
+		_roots(),
+		_structureError(expression.getParseError())
+{
+	const std::vector<RPNExpression::Node> &nodes = expression.getNodes();
+	std::map<InstructionKey, std::size_t> table;
+	for (std::size_t i = 0; i < nodes.size(); i++) {
+		const RPNExpression::Node &node = nodes[i];
+		if (node.op == '\0' || RPNExpression::isVariable(node.op)) {
+			this->_roots.push_back(this->_intern(table, _makeInstruction(node.op, node.value, node.position)));
+			continue;
+		}
+		std::size_t right = this->_roots.back();
+		this->_roots.pop_back();
+		std::size_t left = this->_roots.back();
+		this->_roots.pop_back();
+		this->_roots.push_back(this->_fold(table, node, left, right));
+	}
+	if (!this->_structureError.isError() && this->_roots.size() != 1)
+		this->_structureError = RPNExpression::Error(RPN::STATUS_STACK_SIZE, expression.getLength());
+
+	this->_eliminateDeadInstructions();
+}
+
+RPNProgram::RPNProgram(
+	const RPNProgram &src
+) : _instructions(src._instructions),
+		_roots(src._roots),
+		_structureError(src._structureError)
+{
+}
+
+RPNProgram::~RPNProgram(
+)
+{
+}
+
+RPNProgram &RPNProgram::operator=(
+	const RPNProgram &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_instructions = src._instructions;
+	this->_roots = src._roots;
+	this->_structureError = src._structureError;
+
+	return *this;
+}
+
+std::size_t RPNProgram::_intern(
+	std::map<InstructionKey, std::size_t> &table,
+	const Instruction &instruction
+)
+{
+	InstructionKey key;
+	key.op = instruction.op;
+	key.value = instruction.value;
+	key.left = instruction.left;
+	key.right = instruction.right;
+
+	std::map<InstructionKey, std::size_t>::const_iterator it = table.find(key);
+	if (it != table.end())
+		return it->second;
+
+	std::size_t index = this->_instructions.size();
+	this->_instructions.push_back(instruction);
+	table.insert(std::make_pair(key, index));
+	return index;
+}
+
+std::size_t RPNProgram::_fold(
+	std::map<InstructionKey, std::size_t> &table,
+	const RPNExpression::Node &node,
+	std::size_t left,
+	std::size_t right
+)
+{
+	const Instruction &leftInstruction = this->_instructions[left];
+	const Instruction &rightInstruction = this->_instructions[right];
+
+	if (leftInstruction.op == '\0' && rightInstruction.op == '\0') {
+		RPN::VALUE_TYPE value;
+		// エラーになる演算は畳み込まず、評価時に同じエラーを報告させる
+		if (!RPNExpression::calculate(node.op, node.position, leftInstruction.value, rightInstruction.value, value).isError())
+			return this->_intern(table, _makeInstruction('\0', value, node.position));
+	}
+
+	// エラーになり得ない恒等演算は、取り除いても結果は変わらない
+	switch (node.op) {
+		case '+':
+			if (_isConstant(rightInstruction, 0))
+				return left;
+			if (_isConstant(leftInstruction, 0))
+				return right;
+			break;
+		case '-':
+			if (_isConstant(rightInstruction, 0))
+				return left;
+			break;
+		case '*':
+			// x*1 は x が MIN のとき _validate_multiply でエラーになるので取り除けない
+			// x*0 も、x の変数の読み込みを消すと未束縛のエラーにならなくなるので 0 に置き換えない
+			break;
+		case '/':
+			if (_isConstant(rightInstruction, 1))
+				return left;
+			break;
+	}
+
+	Instruction instruction = _makeInstruction(node.op, 0, node.position);
+	instruction.left = left;
+	instruction.right = right;
+	return this->_intern(table, instruction);
+}
+
+void RPNProgram::_eliminateDeadInstructions(
+)
+{
+	std::vector<bool> isAlive(this->_instructions.size(), false);
+	for (std::size_t i = 0; i < this->_roots.size(); i++) {
+		isAlive[this->_roots[i]] = true;
+	}
+	// 子は必ず親より前にあるので、後ろから1回走査すれば足りる
+	for (std::size_t i = this->_instructions.size(); 0 < i--;) {
+		const Instruction &instruction = this->_instructions[i];
+		if (!isAlive[i] || !RPN::isOperator(instruction.op))
+			continue;
+		isAlive[instruction.left] = true;
+		isAlive[instruction.right] = true;
+	}
+
+	std::vector<std::size_t> newIndex(this->_instructions.size(), 0);
+	std::size_t aliveCount = 0;
+	for (std::size_t i = 0; i < this->_instructions.size(); i++) {
+		if (!isAlive[i])
+			continue;
+		Instruction instruction = this->_instructions[i];
+		if (RPN::isOperator(instruction.op)) {
+			instruction.left = newIndex[instruction.left];
+			instruction.right = newIndex[instruction.right];
+		}
+		newIndex[i] = aliveCount;
+		this->_instructions[aliveCount++] = instruction;
+	}
+	this->_instructions.resize(aliveCount);
+	for (std::size_t i = 0; i < this->_roots.size(); i++) {
+		this->_roots[i] = newIndex[this->_roots[i]];
+	}
+}
+
+const std::vector<RPNProgram::Instruction> &RPNProgram::getInstructions(
+) const
+{
+	return this->_instructions;
+}
+
+std::size_t RPNProgram::getOperationCount(
+) const
+{
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < this->_instructions.size(); i++) {
+		if (RPN::isOperator(this->_instructions[i].op))
+			++count;
+	}
+	return count;
+}
+
+RPNExpression::Error RPNProgram::evaluate(
+	const RPN::VALUE_TYPE *variables,
+	std::vector<RPN::VALUE_TYPE> &workspace,
+	RPN::VALUE_TYPE &result
+) const
+{
+	workspace.resize(this->_instructions.size());
+	for (std::size_t i = 0; i < this->_instructions.size(); i++) {
+		const Instruction &instruction = this->_instructions[i];
+		if (instruction.op == '\0') {
+			workspace[i] = instruction.value;
+		} else if (RPNExpression::isVariable(instruction.op)) {
+			if (variables == NULL)
+				return RPNExpression::Error(RPN::STATUS_UNBOUND_VARIABLE, instruction.position);
+			workspace[i] = variables[instruction.op - 'a'];
+		} else {
+			RPNExpression::Error error = RPNExpression::calculate(instruction.op, instruction.position, workspace[instruction.left], workspace[instruction.right], workspace[i]);
+			if (error.isError())
+				return error;
+		}
+	}
+
+	if (this->_structureError.isError())
+		return this->_structureError;
+
+	result = workspace[this->_roots.back()];
+	return RPNExpression::Error();
+}
+
+RPN::VALUE_TYPE RPNProgram::evaluate(
+	const RPN::VALUE_TYPE *variables
+) const
+{
+	std::vector<RPN::VALUE_TYPE> workspace;
+	RPN::VALUE_TYPE result = 0;
+	this->evaluate(variables, workspace, result).raise();
+	return result;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "./RPN.hpp"
+#include "./RPNExpression.hpp"
+
+// RPNExpression を最適化した、繰り返し評価するための形式
+// - 定数の部分木は事前に畳み込む (エラーになるものは畳み込まず、評価時にエラーとする)
+// - 同一の部分木は1つの命令にまとめる
+// - x+0 や x/1 のようなエラーになり得ない恒等演算は取り除く
+// 命令は後置順で最初に現れた順に並ぶので、評価時に最初に見つかるエラーは逐次評価と一致する
+class RPNProgram
+{
+ public:
+	static const std::size_t VARIABLE_COUNT = 'z' - 'a' + 1;
+
+	typedef struct Instruction {
+		// 定数なら '\0'、変数なら変数名 ('a' - 'z')
+		char op;
+		RPN::VALUE_TYPE value;
+		std::size_t left;
+		std::size_t right;
+		std::size_t position;
+	} Instruction;
+
+ private:
+	typedef struct InstructionKey {
+		char op;
+		RPN::VALUE_TYPE value;
+		std::size_t left;
+		std::size_t right;
+
+		bool operator<(const InstructionKey &rhs) const;
+	} InstructionKey;
+
+	std::vector<Instruction> _instructions;
+	std::vector<std::size_t> _roots;
+	// 式の構造に関するエラー (全ての演算を評価した後に報告する)
+	RPNExpression::Error _structureError;
+
+	std::size_t _intern(std::map<InstructionKey, std::size_t> &table, const Instruction &instruction);
+	std::size_t _fold(std::map<InstructionKey, std::size_t> &table, const RPNExpression::Node &node, std::size_t left, std::size_t right);
+	void _eliminateDeadInstructions();
+
+ public:
+	RPNProgram();
+	RPNProgram(const RPNExpression &expression);
+	RPNProgram(const RPNProgram &src);
+	virtual ~RPNProgram();
+	RPNProgram &operator=(const RPNProgram &src);
+
+	const std::vector<Instruction> &getInstructions() const;
+	std::size_t getOperationCount() const;
+
+	RPNExpression::Error evaluate(const RPN::VALUE_TYPE *variables, std::vector<RPN::VALUE_TYPE> &workspace, RPN::VALUE_TYPE &result) const;
+	RPN::VALUE_TYPE evaluate(const RPN::VALUE_TYPE *variables) const;
+};
@@ -0,0 +1,155 @@
+#include "./WorkStealingPool.hpp"
+
+#include <unistd.h>
+
+WorkStealingPool::Task::~Task()
+{
+}
+
+WorkStealingPool::WorkStealingPool(
+) : _threadCount(WorkStealingPool::getDefaultThreadCount()),
+		_workers(NULL)
+{
+}
+
+WorkStealingPool::WorkStealingPool(
+	std::size_t threadCount
+) : _threadCount(threadCount == 0 ? 1 : threadCount),
+		_workers(NULL)
+{
+}
+
+WorkStealingPool::WorkStealingPool(
+	const WorkStealingPool &src
+) : _threadCount(src._threadCount),
+		_workers(NULL)
+{
+}
+
+WorkStealingPool::~WorkStealingPool(
+)
+{
+}
+
+WorkStealingPool &WorkStealingPool::operator=(
+	const WorkStealingPool &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_threadCount = src._threadCount;
+
+	return *this;
+}
+
+std::size_t WorkStealingPool::getThreadCount(
+) const
+{
+	return this->_threadCount;
+}
+
+std::size_t WorkStealingPool::getDefaultThreadCount(
+)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (count < 1)
+		return 1;
+	return static_cast<std::size_t>(count);
+}
+
+WorkStealingPool::Task *WorkStealingPool::_popOwn(
+	Worker &worker
+)
+{
+	Task *task = NULL;
+	pthread_mutex_lock(&worker.mutex);
+	if (!worker.queue.empty()) {
+		task = worker.queue.back();
+		worker.queue.pop_back();
+	}
+	pthread_mutex_unlock(&worker.mutex);
+	return task;
+}
+
+WorkStealingPool::Task *WorkStealingPool::_steal(
+	std::size_t thiefId
+)
+{
+	for (std::size_t i = 1; i < this->_threadCount; i++) {
+		Worker &victim = this->_workers[(thiefId + i) % this->_threadCount];
+		Task *task = NULL;
+		pthread_mutex_lock(&victim.mutex);
+		if (!victim.queue.empty()) {
+			// 所有者とは逆側から奪う
+			task = victim.queue.front();
+			victim.queue.pop_front();
+		}
+		pthread_mutex_unlock(&victim.mutex);
+		if (task != NULL)
+			return task;
+	}
+	return NULL;
+}
+
+void WorkStealingPool::_runWorker(
+	Worker &worker
+)
+{
+	// タスクが新たなタスクを生むことはないので、全キューが空になれば終了してよい
+	while (true) {
+		Task *task = this->_popOwn(worker);
+		if (task == NULL)
+			task = this->_steal(worker.id);
+		if (task == NULL)
+			return;
+		task->run();
+	}
+}
+
+void *WorkStealingPool::_workerMain(
+	void *arg
+)
+{
+	Worker *worker = static_cast<Worker *>(arg);
+	worker->pool->_runWorker(*worker);
+	return NULL;
+}
+
+void WorkStealingPool::execute(
+	const std::vector<Task *> &tasks
+)
+{
+	if (tasks.empty())
+		return;
+
+	this->_workers = new Worker[this->_threadCount];
+	for (std::size_t i = 0; i < this->_threadCount; i++) {
+		this->_workers[i].pool = this;
+		this->_workers[i].id = i;
+		pthread_mutex_init(&this->_workers[i].mutex, NULL);
+	}
+	for (std::size_t i = 0; i < tasks.size(); i++) {
+		this->_workers[i % this->_threadCount].queue.push_back(tasks[i]);
+	}
+
+	// 呼び出し元スレッドも worker[0] として働く
+	// スレッドが作れなかった分のキューは、他の worker が奪って処理する
+	std::size_t startedCount = 1;
+	while (startedCount < this->_threadCount) {
+		Worker &worker = this->_workers[startedCount];
+		if (pthread_create(&worker.thread, NULL, WorkStealingPool::_workerMain, &worker) != 0)
+			break;
+		++startedCount;
+	}
+	this->_runWorker(this->_workers[0]);
+	for (std::size_t i = 1; i < startedCount; i++) {
+		pthread_join(this->_workers[i].thread, NULL);
+	}
+
+	for (std::size_t i = 0; i < this->_threadCount; i++) {
+		pthread_mutex_destroy(&this->_workers[i].mutex);
+	}
+	delete[] this->_workers;
+	this->_workers = NULL;
+}
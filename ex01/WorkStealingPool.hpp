@@ -0,0 +1,47 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+class WorkStealingPool
+{
+ public:
+	class Task
+	{
+	 public:
+		virtual ~Task();
+		virtual void run() = 0;
+	};
+
+ private:
+	typedef struct Worker {
+		WorkStealingPool *pool;
+		std::size_t id;
+		pthread_t thread;
+		pthread_mutex_t mutex;
+		std::deque<Task *> queue;
+	} Worker;
+
+	std::size_t _threadCount;
+	Worker *_workers;
+
+	static void *_workerMain(void *arg);
+	Task *_popOwn(Worker &worker);
+	Task *_steal(std::size_t thiefId);
+	void _runWorker(Worker &worker);
+
+ public:
+	WorkStealingPool();
+	WorkStealingPool(std::size_t threadCount);
+	WorkStealingPool(const WorkStealingPool &src);
+	virtual ~WorkStealingPool();
+	WorkStealingPool &operator=(const WorkStealingPool &src);
+
+	std::size_t getThreadCount() const;
+	void execute(const std::vector<Task *> &tasks);
+
+	static std::size_t getDefaultThreadCount();
+};
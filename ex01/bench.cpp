@@ -0,0 +1,478 @@
+#include <time.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common/NumberParser.hpp"
+#include "./RPN.hpp"
+#include "./RPNExpression.hpp"
+#include "./RPNProgram.hpp"
+#include "./WorkStealingPool.hpp"
+
+// 9^19 は long に収まり、9^20 は溢れる
+#define NEAR_OVERFLOW_MIN_FACTOR_COUNT 16
+#define NEAR_OVERFLOW_MAX_FACTOR_COUNT 19
+
+static std::size_t g_allocationCount = 0;
+
+void *operator new(
+	std::size_t size
+) throw(std::bad_alloc)
+{
+	__sync_fetch_and_add(&g_allocationCount, 1);
+	void *ptr = std::malloc(size == 0 ? 1 : size);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(
+	void *ptr
+) throw()
+{
+	std::free(ptr);
+}
+
+typedef struct BenchOption {
+	std::size_t tokenCount;
+	std::size_t maxDepth;
+	// + - * / の出現比
+	unsigned int opWeights[4];
+	// 値を置く位置のうち、オーバーフロー寸前の値 (9の累乗) にする割合 (%)
+	unsigned int nearOverflowRate;
+	// エラーになる演算をそのまま残す割合 (%)
+	unsigned int errorRate;
+	// 式のうち、1文字を不正な文字に置き換えるものの割合 (%)
+	unsigned int invalidRate;
+	std::size_t expressionCount;
+	std::size_t repeatCount;
+	std::size_t threadCount;
+	unsigned long seed;
+} BenchOption;
+
+typedef struct Outcome {
+	bool isError;
+	RPN::VALUE_TYPE value;
+	std::string error;
+} Outcome;
+
+// 再現性のため、標準の rand() ではなく自前の xorshift を使う
+static unsigned long _nextRandom(
+	unsigned long &state
+)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static char _pickOperator(
+	const BenchOption &option,
+	unsigned long &state
+)
+{
+	static const char operators[] = "+-*/";
+	unsigned int total = 0;
+	for (std::size_t i = 0; i < 4; i++) {
+		total += option.opWeights[i];
+	}
+	unsigned long r = _nextRandom(state) % total;
+	for (std::size_t i = 0; i < 4; i++) {
+		if (r < option.opWeights[i])
+			return operators[i];
+		r -= option.opWeights[i];
+	}
+	return operators[3];
+}
+
+// 演算がエラーになるなら true
+static bool _isErrorOperation(
+	char op,
+	RPN::VALUE_TYPE left,
+	RPN::VALUE_TYPE right,
+	RPN::VALUE_TYPE &result
+)
+{
+	try {
+		result = RPN::calculate(op, left, right);
+	} catch (const std::exception &) {
+		return true;
+	}
+	return false;
+}
+
+// スタックの深さが maxDepth を超えない、長さ約 tokenCount の正しい形の式を生成する
+// 値を追跡し、エラーになる演算は errorRate の確率でしか残さない
+static std::string generateExpression(
+	const BenchOption &option,
+	unsigned long &state
+)
+{
+	std::string expression;
+	expression.reserve(option.tokenCount * 2 + NEAR_OVERFLOW_MAX_FACTOR_COUNT * 4);
+	std::vector<RPN::VALUE_TYPE> valueStack;
+	std::size_t emitted = 0;
+	while (emitted < option.tokenCount || valueStack.size() != 1) {
+		std::size_t stackSize = valueStack.size();
+		std::size_t remaining = emitted < option.tokenCount ? option.tokenCount - emitted : 0;
+		bool canPush = stackSize < option.maxDepth && stackSize < remaining;
+		bool mustPush = stackSize < 2;
+		if (!mustPush && !(canPush && _nextRandom(state) % 2 == 0)) {
+			RPN::VALUE_TYPE right = valueStack[stackSize - 1];
+			RPN::VALUE_TYPE left = valueStack[stackSize - 2];
+			RPN::VALUE_TYPE result = 0;
+			char op = _pickOperator(option, state);
+			bool allowError = _nextRandom(state) % 100 < option.errorRate;
+			// エラーにならない演算子を探す (どれもエラーになるなら、値を積んで先送りする)
+			for (std::size_t i = 0; !allowError && i < 8 && _isErrorOperation(op, left, right, result); i++) {
+				op = _pickOperator(option, state);
+			}
+			if (allowError || !_isErrorOperation(op, left, right, result) || !canPush) {
+				expression += op;
+				expression += ' ';
+				++emitted;
+				valueStack.pop_back();
+				valueStack.back() = result;
+				continue;
+			}
+		}
+
+		if (_nextRandom(state) % 100 < option.nearOverflowRate) {
+			std::size_t factorCount = NEAR_OVERFLOW_MIN_FACTOR_COUNT + _nextRandom(state) % (NEAR_OVERFLOW_MAX_FACTOR_COUNT - NEAR_OVERFLOW_MIN_FACTOR_COUNT + 1);
+			RPN::VALUE_TYPE value = 9;
+			expression += "9 ";
+			for (std::size_t i = 1; i < factorCount; i++) {
+				expression += "9 * ";
+				value *= 9;
+			}
+			emitted += factorCount * 2 - 1;
+			valueStack.push_back(value);
+		} else {
+			RPN::VALUE_TYPE value = _nextRandom(state) % 10;
+			expression += static_cast<char>('0' + value);
+			expression += ' ';
+			++emitted;
+			valueStack.push_back(value);
+		}
+	}
+	return expression;
+}
+
+static std::string _describeError(
+	const std::exception &e
+)
+{
+	if (dynamic_cast<const std::overflow_error *>(&e) != NULL)
+		return std::string("overflow_error: ") + e.what();
+	if (dynamic_cast<const std::underflow_error *>(&e) != NULL)
+		return std::string("underflow_error: ") + e.what();
+	if (dynamic_cast<const std::invalid_argument *>(&e) != NULL)
+		return std::string("invalid_argument: ") + e.what();
+	return std::string("exception: ") + e.what();
+}
+
+static RPN::VALUE_TYPE evaluateByInterpreter(
+	const std::string &expression
+)
+{
+	RPN rpn;
+	for (std::size_t i = 0; i < expression.length(); i++) {
+		if (!std::isspace(static_cast<unsigned char>(expression[i])))
+			rpn.processInput(expression[i]);
+	}
+	return rpn.getResult();
+}
+
+static std::string _describeStatus(
+	RPN::Status status
+)
+{
+	switch (status) {
+		case RPN::STATUS_OVERFLOW:
+		case RPN::STATUS_PRODUCT_UNDERFLOW:
+			return std::string("overflow_error: ") + RPN::getStatusMessage(status);
+		case RPN::STATUS_UNDERFLOW:
+			return std::string("underflow_error: ") + RPN::getStatusMessage(status);
+		default:
+			return std::string("invalid_argument: ") + RPN::getStatusMessage(status);
+	}
+}
+
+typedef enum PathType {
+	// 式ごとに RPN を作り、例外で失敗を受け取る
+	PATH_INTERPRETER,
+	// 1つの RPN を全ての式で使い回す (確保済みのスタックを使うので、allocs/expr はほぼ 0 になる)
+	PATH_INTERPRETER_STATUS,
+	PATH_EXPRESSION,
+	PATH_PARALLEL,
+	PATH_PROGRAM,
+	PATH_COUNT
+} PathType;
+
+static const char *PATH_NAMES[PATH_COUNT] = {
+	"RPN::processInput",
+	"RPN::tryEvaluate",
+	"RPNExpression::evaluate",
+	"RPNExpression::evaluateParallel",
+	"RPNProgram::evaluate",
+};
+
+// 解析・コンパイルの結果を使い回す経路のための前処理済みデータ
+typedef struct Prepared {
+	std::vector<RPNExpression> expressions;
+	std::vector<RPNProgram> programs;
+} Prepared;
+
+static Outcome runPath(
+	PathType path,
+	const BenchOption &option,
+	const std::vector<std::string> &expressions,
+	const Prepared &prepared,
+	std::vector<RPN::VALUE_TYPE> &workspace,
+	RPN &rpn,
+	std::size_t index,
+	bool isDescribing
+)
+{
+	Outcome outcome;
+	outcome.isError = false;
+	outcome.value = 0;
+	if (path == PATH_INTERPRETER_STATUS) {
+		const std::string &expression = expressions[index];
+		std::size_t position = 0;
+		RPN::Status status = rpn.tryEvaluate(expression.data(), expression.data() + expression.length(), outcome.value, position);
+		outcome.isError = status != RPN::STATUS_OK;
+		if (outcome.isError && isDescribing)
+			outcome.error = _describeStatus(status);
+		return outcome;
+	}
+	try {
+		switch (path) {
+			case PATH_INTERPRETER:
+				outcome.value = evaluateByInterpreter(expressions[index]);
+				break;
+			case PATH_INTERPRETER_STATUS:
+				break;
+			case PATH_EXPRESSION:
+				outcome.value = prepared.expressions[index].evaluate();
+				break;
+			case PATH_PARALLEL:
+				outcome.value = prepared.expressions[index].evaluateParallel(option.threadCount);
+				break;
+			case PATH_PROGRAM: {
+				RPNExpression::Error error = prepared.programs[index].evaluate(NULL, workspace, outcome.value);
+				error.raise();
+				break;
+			}
+			case PATH_COUNT:
+				break;
+		}
+	} catch (const std::exception &e) {
+		outcome.isError = true;
+		if (isDescribing)
+			outcome.error = _describeError(e);
+	}
+	return outcome;
+}
+
+static struct timespec _now(
+)
+{
+	struct timespec time;
+	if (clock_gettime(CLOCK_MONOTONIC, &time) != 0) {
+		const char *msg = std::strerror(errno);
+		throw std::runtime_error(msg);
+	}
+	return time;
+}
+
+static double _elapsedNs(
+	const struct timespec &start,
+	const struct timespec &end
+)
+{
+	return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+static bool parseOption(
+	const char *arg,
+	BenchOption &option
+)
+{
+	const char *eq = std::strchr(arg, '=');
+	if (std::strncmp(arg, "--", 2) != 0 || eq == NULL)
+		return false;
+	std::string key(arg + 2, eq);
+	const char *value = eq + 1;
+
+	if (key == "ops") {
+		// 例: --ops=1,1,4,1 (+ - * / の比)
+		std::istringstream iss(value);
+		char comma;
+		if (!(iss >> option.opWeights[0] >> comma >> option.opWeights[1] >> comma >> option.opWeights[2] >> comma >> option.opWeights[3]))
+			return false;
+		return 0 < option.opWeights[0] + option.opWeights[1] + option.opWeights[2] + option.opWeights[3];
+	}
+
+	unsigned long number;
+	if (parseUnsigned(value, value + std::strlen(value), number) != NUMBER_PARSE_OK)
+		return false;
+	if (key == "tokens")
+		option.tokenCount = number;
+	else if (key == "depth")
+		option.maxDepth = number < 2 ? 2 : number;
+	else if (key == "near-overflow")
+		option.nearOverflowRate = number;
+	else if (key == "error-rate")
+		option.errorRate = number;
+	else if (key == "invalid-rate")
+		option.invalidRate = number;
+	else if (key == "count")
+		option.expressionCount = number;
+	else if (key == "repeat")
+		option.repeatCount = number;
+	else if (key == "threads")
+		option.threadCount = number;
+	else if (key == "seed")
+		option.seed = number == 0 ? 1 : number;
+	else
+		return false;
+	return true;
+}
+
+int main(
+	int argc,
+	const char **argv
+)
+{
+	BenchOption option;
+	option.tokenCount = 1000;
+	option.maxDepth = 64;
+	option.opWeights[0] = 1;
+	option.opWeights[1] = 1;
+	option.opWeights[2] = 1;
+	option.opWeights[3] = 1;
+	option.nearOverflowRate = 0;
+	option.errorRate = 0;
+	option.invalidRate = 0;
+	option.expressionCount = 100;
+	option.repeatCount = 10;
+	option.threadCount = WorkStealingPool::getDefaultThreadCount();
+	option.seed = 42;
+	for (int i = 1; i < argc; i++) {
+		if (!parseOption(argv[i], option)) {
+			std::cerr
+				<< "Usage: "
+				<< argv[0]
+				<< " [--tokens=N] [--depth=N] [--ops=+,-,*,/] [--near-overflow=PERCENT] [--error-rate=PERCENT] [--invalid-rate=PERCENT]"
+				<< " [--count=N] [--repeat=N] [--threads=N] [--seed=N]"
+				<< std::endl;
+			return 1;
+		}
+	}
+
+	unsigned long state = option.seed;
+	std::vector<std::string> expressions;
+	std::size_t totalTokenCount = 0;
+	for (std::size_t i = 0; i < option.expressionCount; i++) {
+		expressions.push_back(generateExpression(option, state));
+		totalTokenCount += expressions.back().length() / 2;
+		if (_nextRandom(state) % 100 < option.invalidRate) {
+			std::string &expression = expressions.back();
+			expression[_nextRandom(state) % (expression.length() / 2) * 2] = 'x';
+		}
+	}
+
+	Prepared prepared;
+	std::size_t nodeCount = 0;
+	std::size_t instructionCount = 0;
+	for (std::size_t i = 0; i < expressions.size(); i++) {
+		prepared.expressions.push_back(RPNExpression(expressions[i]));
+		prepared.programs.push_back(RPNProgram(prepared.expressions.back()));
+		nodeCount += prepared.expressions.back().getNodes().size();
+		instructionCount += prepared.programs.back().getInstructions().size();
+	}
+
+	// 全経路の結果が一致することを確認する
+	std::vector<RPN::VALUE_TYPE> workspace;
+	RPN rpn;
+	std::size_t errorCount = 0;
+	std::size_t mismatchCount = 0;
+	for (std::size_t i = 0; i < expressions.size(); i++) {
+		Outcome expected = runPath(PATH_INTERPRETER, option, expressions, prepared, workspace, rpn, i, true);
+		if (expected.isError)
+			++errorCount;
+		for (int path = PATH_INTERPRETER + 1; path < PATH_COUNT; path++) {
+			Outcome actual = runPath(static_cast<PathType>(path), option, expressions, prepared, workspace, rpn, i, true);
+			if (actual.isError != expected.isError || actual.value != expected.value || actual.error != expected.error) {
+				++mismatchCount;
+				std::cerr
+					<< "MISMATCH ["
+					<< PATH_NAMES[path]
+					<< "] expression #" << i << ": expected "
+					<< (expected.isError ? expected.error : "value")
+					<< " (" << expected.value << "), got "
+					<< (actual.isError ? actual.error : "value")
+					<< " (" << actual.value << ")"
+					<< std::endl;
+			}
+		}
+	}
+
+	std::cout
+		<< "expressions: " << expressions.size()
+		<< ", tokens: " << totalTokenCount
+		<< ", errors: " << errorCount
+		<< ", threads: " << option.threadCount
+		<< std::endl
+		<< "instructions after optimization: " << instructionCount
+		<< " / " << nodeCount << " nodes"
+		<< std::endl;
+
+	std::cout
+		<< std::left << std::setw(34) << "path"
+		<< std::right << std::setw(12) << "ns/token"
+		<< std::setw(12) << "ns/expr"
+		<< std::setw(16) << "allocs/expr"
+		<< std::endl;
+	for (int path = PATH_INTERPRETER; path < PATH_COUNT; path++) {
+		std::size_t allocationCountBefore = g_allocationCount;
+		struct timespec start = _now();
+		for (std::size_t r = 0; r < option.repeatCount; r++) {
+			for (std::size_t i = 0; i < expressions.size(); i++) {
+				runPath(static_cast<PathType>(path), option, expressions, prepared, workspace, rpn, i, false);
+			}
+		}
+		struct timespec end = _now();
+		std::size_t allocationCount = g_allocationCount - allocationCountBefore;
+		double evaluationCount = static_cast<double>(option.repeatCount) * expressions.size();
+
+		std::cout
+			<< std::left << std::setw(34) << PATH_NAMES[path]
+			<< std::right << std::fixed << std::setprecision(3)
+			<< std::setw(12) << _elapsedNs(start, end) / (evaluationCount * totalTokenCount / expressions.size())
+			<< std::setw(12) << _elapsedNs(start, end) / evaluationCount
+			<< std::setw(16) << allocationCount / evaluationCount
+			<< std::endl;
+	}
+
+	if (mismatchCount != 0) {
+		std::cerr
+			<< "Error: "
+			<< mismatchCount
+			<< " mismatch(es) between evaluation paths"
+			<< std::endl;
+		return 1;
+	}
+	return 0;
+}
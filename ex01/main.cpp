@@ -1,33 +1,102 @@
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 
+#include "../common/NumberParser.hpp"
 #include "./RPN.hpp"
+#include "./RPNBatch.hpp"
+#include "./RPNExpression.hpp"
+#include "./WorkStealingPool.hpp"
+
+#define OPTION_PARALLEL "--parallel"
+#define OPTION_BATCH "--batch"
+
+static void print_usage(
+	const char *programName
+)
+{
+	std::cerr
+		<< "Usage: "
+		<< programName
+		<< " [" OPTION_PARALLEL "[=<threads>]] <expression>"
+		<< std::endl
+		<< "       "
+		<< programName
+		<< " " OPTION_BATCH "[=<threads>] <file>"
+		<< std::endl;
+}
+
+static RPN::VALUE_TYPE evaluateSequential(
+	const char *expression
+)
+{
+	RPN rpn;
+	std::size_t i = 0;
+	while (expression[i] != '\0') {
+		// スペースは必ず無視する仕様とする
+		if (!std::isspace(expression[i])) {
+			rpn.processInput(expression[i]);
+		}
+		++i;
+	}
+
+	return rpn.getResult();
+}
+
+static bool parseThreadCount(
+	const char *option,
+	const char *optionName,
+	std::size_t &threadCount
+)
+{
+	std::size_t optionLen = std::strlen(optionName);
+	if (std::strncmp(option, optionName, optionLen) != 0)
+		return false;
+	if (option[optionLen] == '\0') {
+		threadCount = WorkStealingPool::getDefaultThreadCount();
+		return true;
+	}
+	const char *value = option + optionLen + 1;
+	std::size_t count;
+	if (option[optionLen] != '=' || parseUnsigned(value, value + std::strlen(value), count) != NUMBER_PARSE_OK || count == 0)
+		return false;
+	threadCount = count;
+	return true;
+}
 
 int main(
 	int argc,
 	const char **argv
 )
 {
-	if (argc != 2) {
-		std::cerr
-			<< "Usage: "
-			<< argv[0]
-			<< " <expression>"
-			<< std::endl;
+	std::size_t threadCount = 0;
+	std::size_t batchThreadCount = 0;
+	if (argc == 3) {
+		if (!parseThreadCount(argv[1], OPTION_PARALLEL, threadCount) && !parseThreadCount(argv[1], OPTION_BATCH, batchThreadCount)) {
+			print_usage(argv[0]);
+			return 1;
+		}
+	} else if (argc != 2) {
+		print_usage(argv[0]);
 		return 1;
 	}
 
-	RPN rpn;
 	try {
-		std::size_t i = 0;
-		while (argv[1][i] != '\0') {
-			// スペースは必ず無視する仕様とする
-			if (!std::isspace(argv[1][i])) {
-				rpn.processInput(argv[1][i]);
-			}
-			++i;
+		if (batchThreadCount != 0) {
+			// 各行の結果・エラーは、入力と同じ順序で stdout に出力する
+			RPNBatch(batchThreadCount).run(argv[2], STDOUT_FILENO);
+			return 0;
 		}
 
-		RPN::VALUE_TYPE result = rpn.getResult();
+		RPN::VALUE_TYPE result;
+		if (threadCount == 0)
+			result = evaluateSequential(argv[1]);
+		else
+			result = RPNExpression(argv[2]).evaluateParallel(threadCount);
+
 		// charでもintとして出力する
 		std::cout << +result << std::endl;
 	} catch (std::exception &e) {
@@ -0,0 +1,26 @@
+#include <iostream>
+
+#include "./RPNConstexpr.hpp"
+
+// 以下はすべてコンパイル時に評価される
+// 値を変えてオーバーフローやゼロ除算を起こすと、コンパイルエラーになる
+static_assert(RPN_CONSTANT("8 9 * 9 - 9 - 9 - 4 - 1 +") == 42, "subject example 1");
+static_assert(RPN_CONSTANT("7 7 * 7 -") == 42, "subject example 2");
+static_assert(RPN_CONSTANT("1 2 * 2 / 2 * 2 4 - +") == 0, "subject example 3");
+static_assert(RPNConstexpr::Expression<'3', '4', '+', '2', '*'>::value == 14, "template parameter pack");
+
+int main(
+	int argc,
+	const char **argv
+)
+{
+	(void)argc;
+	(void)argv;
+
+	// 実行時にはただの定数として扱われる
+	std::cout << RPN_CONSTANT("8 9 * 9 - 9 - 9 - 4 - 1 +") << std::endl;
+	std::cout << RPN_CONSTANT("9 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 * 9 *") << std::endl;
+	std::cout << RPNConstexpr::Expression<'3', '4', '+', '2', '*'>()() << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../RPNExpression.hpp"
+#include "../RPNProgram.hpp"
+
+// 短い式で、RPNExpression::evaluate と次を比べる
+// - evaluateParallel: 小さい grainSize (葉まで分割しようとしても、範囲外を読まずに同じ結果になること)
+// - RPNProgram::evaluate: 変数を束縛しない場合 (最適化で変数の読み込みを消さないこと)
+
+#define MAX_GRAIN_SIZE 4
+#define MAX_THREAD_COUNT 3
+
+// 例外を投げた場合は、そのメッセージを結果とする
+static std::string _evaluate(
+	const RPNExpression &expression,
+	std::size_t threadCount,
+	std::size_t grainSize
+)
+{
+	try {
+		RPN::VALUE_TYPE result = threadCount == 0
+			? expression.evaluate()
+			: expression.evaluateParallel(threadCount, grainSize);
+		std::ostringstream text;
+		text << result;
+		return text.str();
+	} catch (std::exception &e) {
+		return e.what();
+	}
+}
+
+static std::size_t _checkExpression(
+	const std::string &text,
+	bool allowVariables
+)
+{
+	RPNExpression expression(text, allowVariables);
+	std::string expected = _evaluate(expression, 0, 0);
+	std::size_t failureCount = 0;
+	std::string optimized;
+	try {
+		std::ostringstream result;
+		result << RPNProgram(expression).evaluate(NULL);
+		optimized = result.str();
+	} catch (std::exception &e) {
+		optimized = e.what();
+	}
+	if (optimized != expected) {
+		std::cerr << "MISMATCH \"" << text << "\" (RPNProgram): expected " << expected << ", got " << optimized << std::endl;
+		++failureCount;
+	}
+	for (std::size_t threadCount = 1; threadCount <= MAX_THREAD_COUNT; threadCount++) {
+		for (std::size_t grainSize = 0; grainSize <= MAX_GRAIN_SIZE; grainSize++) {
+			std::string actual = _evaluate(expression, threadCount, grainSize);
+			if (actual != expected) {
+				std::cerr << "MISMATCH \"" << text << "\" (threads: " << threadCount << ", grain: " << grainSize
+					<< "): expected " << expected << ", got " << actual << std::endl;
+				++failureCount;
+			}
+		}
+	}
+	return failureCount;
+}
+
+int main(
+)
+{
+	static const char *EXPRESSIONS[] = {
+		"5",
+		"0",
+		"1 2 +",
+		"1 2 + 3 4 + *",
+		"8 9 * 9 - 9 - 9 - 4 - 1 +",
+		"1 2 3 4 5 6 7 8 9 + + + + + + + +",
+		"1 0 /",
+		"1 +",
+		"1 2",
+	};
+	static const char *VARIABLE_EXPRESSIONS[] = {
+		"a",
+		"1 a +",
+		"0 a *",
+		"a 0 *",
+		"1 0 a * +",
+	};
+	std::size_t failureCount = 0;
+	for (std::size_t i = 0; i < sizeof(EXPRESSIONS) / sizeof(EXPRESSIONS[0]); i++) {
+		failureCount += _checkExpression(EXPRESSIONS[i], false);
+	}
+	for (std::size_t i = 0; i < sizeof(VARIABLE_EXPRESSIONS) / sizeof(VARIABLE_EXPRESSIONS[0]); i++) {
+		failureCount += _checkExpression(VARIABLE_EXPRESSIONS[i], true);
+	}
+
+	if (failureCount != 0) {
+		std::cerr << "NG: " << failureCount << " mismatch(es)" << std::endl;
+		return 1;
+	}
+	std::cout << "OK" << std::endl;
+	return 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// 小さな配列(チャンク)を並べた列
+// チャンクごとの要素数を Fenwick tree で管理し、位置指定の参照と挿入を
+// O(log(チャンク数)) + O(チャンクサイズ) で行う
+// (1本の配列への挿入のように、全要素をずらす必要がない)
+template <typename T>
+class ChunkedSequence
+{
+ public:
+	static const std::size_t CHUNK_CAPACITY = 512;
+
+ private:
+	// _slab 上の CHUNK_CAPACITY 要素分の枠 (offset から length 要素が使われている)
+	typedef struct Chunk {
+		std::size_t offset;
+		std::size_t length;
+	} Chunk;
+
+	// 全チャンクの要素を置く1本の配列 (チャンクごとに確保しない)
+	// clear() しても容量は残るので、同じ大きさまでなら確保し直さずに使い回せる
+	std::vector<T> _slab;
+	// 列の順に並べたチャンク
+	std::vector<Chunk> _chunks;
+	// _tree[i] は Fenwick tree (1-indexed) のノード
+	std::vector<std::size_t> _tree;
+	std::size_t _size;
+
+	void _rebuildTree();
+	void _addToTree(std::size_t chunkIndex, std::size_t delta);
+	std::size_t _findChunk(std::size_t &position) const;
+	std::size_t _allocateChunk();
+	void _splitChunk(std::size_t chunkIndex);
+
+ public:
+	ChunkedSequence();
+	ChunkedSequence(const ChunkedSequence &src);
+	virtual ~ChunkedSequence();
+	ChunkedSequence &operator=(const ChunkedSequence &src);
+
+	std::size_t size() const;
+	const T &at(std::size_t position) const;
+	void insert(std::size_t position, const T &value);
+	void push_back(const T &value);
+	// 要素数 count までは確保し直さずに済むよう、あらかじめ確保しておく
+	void reserve(std::size_t count);
+	// 要素を捨てる (確保した領域は残す)
+	void clear();
+
+	template <typename OutputIterator>
+	OutputIterator copyTo(OutputIterator out) const;
+};
+
+#include "./ChunkedSequence.tpp"
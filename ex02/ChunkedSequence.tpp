@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+
+#include "./ChunkedSequence.hpp"
+
+template <typename T>
+ChunkedSequence<T>::ChunkedSequence(
+) : _slab(),
+		_chunks(),
+		_tree(),
+		_size(0)
+{
+}
+
+template <typename T>
+ChunkedSequence<T>::ChunkedSequence(
+	const ChunkedSequence &src
+) : _slab(src._slab),
+		_chunks(src._chunks),
+		_tree(src._tree),
+		_size(src._size)
+{
+}
+
+template <typename T>
+ChunkedSequence<T>::~ChunkedSequence(
+)
+{
+}
+
+template <typename T>
+ChunkedSequence<T> &ChunkedSequence<T>::operator=(
+	const ChunkedSequence &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_slab = src._slab;
+	this->_chunks = src._chunks;
+	this->_tree = src._tree;
+	this->_size = src._size;
+
+	return *this;
+}
+
+template <typename T>
+void ChunkedSequence<T>::_rebuildTree(
+)
+{
+	std::size_t chunkCount = this->_chunks.size();
+	this->_tree.assign(chunkCount + 1, 0);
+	for (std::size_t i = 1; i <= chunkCount; i++) {
+		this->_tree[i] += this->_chunks[i - 1].length;
+		std::size_t parent = i + (i & -i);
+		if (parent <= chunkCount)
+			this->_tree[parent] += this->_tree[i];
+	}
+}
+
+template <typename T>
+void ChunkedSequence<T>::_addToTree(
+	std::size_t chunkIndex,
+	std::size_t delta
+)
+{
+	for (std::size_t i = chunkIndex + 1; i < this->_tree.size(); i += (i & -i)) {
+		this->_tree[i] += delta;
+	}
+}
+
+// position を含むチャンクの index を返し、position をチャンク内の位置に書き換える
+// position == size() の場合は最後のチャンクの末尾を指す
+template <typename T>
+std::size_t ChunkedSequence<T>::_findChunk(
+	std::size_t &position
+) const
+{
+	std::size_t chunkCount = this->_chunks.size();
+	if (this->_size <= position) {
+		position -= this->_size - this->_chunks.back().length;
+		return chunkCount - 1;
+	}
+
+	std::size_t mask = 1;
+	while (mask * 2 <= chunkCount)
+		mask *= 2;
+	std::size_t index = 0;
+	for (; mask != 0; mask /= 2) {
+		std::size_t next = index + mask;
+		if (next <= chunkCount && this->_tree[next] <= position) {
+			index = next;
+			position -= this->_tree[next];
+		}
+	}
+	return index;
+}
+
+// _slab の末尾に新しい枠を足し、その先頭の位置を返す
+// (チャンクは減らないので、枠を返却して再利用する必要はない)
+template <typename T>
+std::size_t ChunkedSequence<T>::_allocateChunk(
+)
+{
+	std::size_t offset = this->_slab.size();
+	this->_slab.resize(offset + CHUNK_CAPACITY);
+	return offset;
+}
+
+template <typename T>
+void ChunkedSequence<T>::_splitChunk(
+	std::size_t chunkIndex
+)
+{
+	// 後半を新しい枠へ移し、チャンクの並びには (位置, 要素数) だけを差し込む
+	Chunk chunk;
+	chunk.offset = this->_allocateChunk();
+	Chunk &src = this->_chunks[chunkIndex];
+	std::size_t half = src.length / 2;
+	chunk.length = src.length - half;
+	std::copy(
+		this->_slab.begin() + src.offset + half,
+		this->_slab.begin() + src.offset + src.length,
+		this->_slab.begin() + chunk.offset
+	);
+	src.length = half;
+	this->_chunks.insert(this->_chunks.begin() + chunkIndex + 1, chunk);
+	this->_rebuildTree();
+}
+
+template <typename T>
+std::size_t ChunkedSequence<T>::size(
+) const
+{
+	return this->_size;
+}
+
+template <typename T>
+const T &ChunkedSequence<T>::at(
+	std::size_t position
+) const
+{
+	std::size_t chunkIndex = this->_findChunk(position);
+	return this->_slab[this->_chunks[chunkIndex].offset + position];
+}
+
+template <typename T>
+void ChunkedSequence<T>::insert(
+	std::size_t position,
+	const T &value
+)
+{
+	if (this->_chunks.empty()) {
+		this->push_back(value);
+		return;
+	}
+
+	std::size_t offset = position;
+	std::size_t chunkIndex = this->_findChunk(offset);
+	if (CHUNK_CAPACITY <= this->_chunks[chunkIndex].length) {
+		this->_splitChunk(chunkIndex);
+		offset = position;
+		chunkIndex = this->_findChunk(offset);
+	}
+	Chunk &chunk = this->_chunks[chunkIndex];
+	typename std::vector<T>::iterator chunkBegin = this->_slab.begin() + chunk.offset;
+	std::copy_backward(chunkBegin + offset, chunkBegin + chunk.length, chunkBegin + chunk.length + 1);
+	chunkBegin[offset] = value;
+	++chunk.length;
+	++this->_size;
+	this->_addToTree(chunkIndex, 1);
+}
+
+template <typename T>
+void ChunkedSequence<T>::push_back(
+	const T &value
+)
+{
+	if (this->_chunks.empty() || CHUNK_CAPACITY <= this->_chunks.back().length) {
+		Chunk chunk;
+		chunk.offset = this->_allocateChunk();
+		chunk.length = 0;
+		this->_chunks.push_back(chunk);
+		// 末尾への追加なので、木は全体を作り直さずに伸ばす
+		std::size_t i = this->_chunks.size();
+		std::size_t lowBit = i & -i;
+		std::size_t sum = 0;
+		for (std::size_t j = i - 1; i - lowBit < j; j -= (j & -j)) {
+			sum += this->_tree[j];
+		}
+		if (this->_tree.empty())
+			this->_tree.push_back(0);
+		this->_tree.push_back(sum);
+	}
+	Chunk &chunk = this->_chunks.back();
+	this->_slab[chunk.offset + chunk.length] = value;
+	++chunk.length;
+	++this->_size;
+	this->_addToTree(this->_chunks.size() - 1, 1);
+}
+
+// チャンクは満杯になってから半分に分けるので、最後のチャンク以外は常に半分以上埋まっている
+template <typename T>
+void ChunkedSequence<T>::reserve(
+	std::size_t count
+)
+{
+	std::size_t chunkCount = count / (CHUNK_CAPACITY / 2) + 1;
+	this->_slab.reserve(chunkCount * CHUNK_CAPACITY);
+	this->_chunks.reserve(chunkCount);
+	this->_tree.reserve(chunkCount + 1);
+}
+
+template <typename T>
+void ChunkedSequence<T>::clear(
+)
+{
+	this->_slab.clear();
+	this->_chunks.clear();
+	this->_tree.clear();
+	this->_size = 0;
+}
+
+template <typename T>
+template <typename OutputIterator>
+OutputIterator ChunkedSequence<T>::copyTo(
+	OutputIterator out
+) const
+{
+	for (std::size_t i = 0; i < this->_chunks.size(); i++) {
+		const Chunk &chunk = this->_chunks[i];
+		out = std::copy(this->_slab.begin() + chunk.offset, this->_slab.begin() + chunk.offset + chunk.length, out);
+	}
+	return out;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// k 本の整列済みの列をマージするためのトーナメント木 (敗者木)
+// 各ノードには対戦で負けた葉を持ち、勝者 (最小の葉) を取り出すたびに
+// その葉から根までの log2(k) 回の比較だけで次の勝者を決める
+template <typename T, typename Compare = std::less<T> >
+class LoserTree
+{
+ private:
+	Compare _compare;
+	// 各葉 (列) の先頭の要素
+	std::vector<T> _keys;
+	// 列が尽きた葉は、どの要素よりも大きいものとして扱う
+	std::vector<bool> _isExhausted;
+	// _losers[0] は勝者、_losers[1..k) は各ノードで負けた葉
+	std::vector<std::size_t> _losers;
+
+	bool _isLess(std::size_t left, std::size_t right) const;
+	void _replay(std::size_t leaf);
+
+ public:
+	LoserTree();
+	explicit LoserTree(std::size_t leafCount, const Compare &compare = Compare());
+	LoserTree(const LoserTree &src);
+	virtual ~LoserTree();
+	LoserTree &operator=(const LoserTree &src);
+
+	std::size_t size() const;
+	// build() の前に、各葉の先頭の要素を設定する (空の列は setExhausted)
+	void set(std::size_t leaf, const T &key);
+	void setExhausted(std::size_t leaf);
+	void build();
+
+	// すべての列が尽きたか
+	bool empty() const;
+	std::size_t top() const;
+	const T &topKey() const;
+	// 勝者の葉を、その列の次の要素で置き換える
+	void replaceTop(const T &key);
+	// 勝者の葉の列が尽きた
+	void popTop();
+};
+
+#include "./LoserTree.tpp"
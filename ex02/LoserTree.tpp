@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+
+#include "./LoserTree.hpp"
+
+template <typename T, typename Compare>
+LoserTree<T, Compare>::LoserTree(
+) : _compare(),
+		_keys(),
+		_isExhausted(),
+		_losers()
+{
+}
+
+template <typename T, typename Compare>
+LoserTree<T, Compare>::LoserTree(
+	std::size_t leafCount,
+	const Compare &compare
+) : _compare(compare),
+		_keys(leafCount),
+		_isExhausted(leafCount, true),
+		_losers(leafCount, 0)
+{
+}
+
+template <typename T, typename Compare>
+LoserTree<T, Compare>::LoserTree(
+	const LoserTree &src
+) : _compare(src._compare),
+		_keys(src._keys),
+		_isExhausted(src._isExhausted),
+		_losers(src._losers)
+{
+}
+
+template <typename T, typename Compare>
+LoserTree<T, Compare>::~LoserTree(
+)
+{
+}
+
+template <typename T, typename Compare>
+LoserTree<T, Compare> &LoserTree<T, Compare>::operator=(
+	const LoserTree &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_compare = src._compare;
+	this->_keys = src._keys;
+	this->_isExhausted = src._isExhausted;
+	this->_losers = src._losers;
+
+	return *this;
+}
+
+template <typename T, typename Compare>
+bool LoserTree<T, Compare>::_isLess(
+	std::size_t left,
+	std::size_t right
+) const
+{
+	if (this->_isExhausted[left])
+		return false;
+	if (this->_isExhausted[right])
+		return true;
+	return this->_compare(this->_keys[left], this->_keys[right]);
+}
+
+// 葉 leaf の要素が変わったので、根までの対戦をやり直す
+template <typename T, typename Compare>
+void LoserTree<T, Compare>::_replay(
+	std::size_t leaf
+)
+{
+	std::size_t winner = leaf;
+	for (std::size_t node = (leaf + this->_keys.size()) / 2; node != 0; node /= 2) {
+		if (this->_isLess(this->_losers[node], winner))
+			std::swap(this->_losers[node], winner);
+	}
+	this->_losers[0] = winner;
+}
+
+template <typename T, typename Compare>
+std::size_t LoserTree<T, Compare>::size(
+) const
+{
+	return this->_keys.size();
+}
+
+template <typename T, typename Compare>
+void LoserTree<T, Compare>::set(
+	std::size_t leaf,
+	const T &key
+)
+{
+	this->_keys[leaf] = key;
+	this->_isExhausted[leaf] = false;
+}
+
+template <typename T, typename Compare>
+void LoserTree<T, Compare>::setExhausted(
+	std::size_t leaf
+)
+{
+	this->_isExhausted[leaf] = true;
+}
+
+// 葉 i はノード k + i にあるものとして、下から順に対戦させる
+template <typename T, typename Compare>
+void LoserTree<T, Compare>::build(
+)
+{
+	std::size_t leafCount = this->_keys.size();
+	if (leafCount == 0)
+		return;
+	std::vector<std::size_t> winners(leafCount * 2);
+	for (std::size_t i = 0; i < leafCount; i++) {
+		winners[leafCount + i] = i;
+	}
+	for (std::size_t node = leafCount - 1; node != 0; node--) {
+		std::size_t left = winners[node * 2];
+		std::size_t right = winners[node * 2 + 1];
+		if (this->_isLess(right, left)) {
+			winners[node] = right;
+			this->_losers[node] = left;
+		} else {
+			winners[node] = left;
+			this->_losers[node] = right;
+		}
+	}
+	this->_losers[0] = winners[1];
+}
+
+template <typename T, typename Compare>
+bool LoserTree<T, Compare>::empty(
+) const
+{
+	return this->_keys.empty() || this->_isExhausted[this->_losers[0]];
+}
+
+template <typename T, typename Compare>
+std::size_t LoserTree<T, Compare>::top(
+) const
+{
+	return this->_losers[0];
+}
+
+template <typename T, typename Compare>
+const T &LoserTree<T, Compare>::topKey(
+) const
+{
+	return this->_keys[this->_losers[0]];
+}
+
+template <typename T, typename Compare>
+void LoserTree<T, Compare>::replaceTop(
+	const T &key
+)
+{
+	std::size_t leaf = this->_losers[0];
+	this->_keys[leaf] = key;
+	this->_replay(leaf);
+}
+
+template <typename T, typename Compare>
+void LoserTree<T, Compare>::popTop(
+)
+{
+	std::size_t leaf = this->_losers[0];
+	this->_isExhausted[leaf] = true;
+	this->_replay(leaf);
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#ifdef COUNT
+// ソート1回分の計測値 (MergeInsertion の全インスタンスで共通)
+typedef struct MergeInsertionStats {
+	// キー同士の比較回数
+	std::size_t comparisons;
+	// 要素のコピー(代入)回数 (swap は3回と数える)
+	std::size_t moves;
+	// operator new の呼び出し回数 (数えるのは利用側)
+	std::size_t allocations;
+} MergeInsertionStats;
+
+inline MergeInsertionStats &getMergeInsertionStats(
+)
+{
+	static MergeInsertionStats stats = {0, 0, 0};
+	return stats;
+}
+#endif	// COUNT
+
+// ペイロードを持たない (キーそのものを並べる) 場合に指定する
+struct MergeInsertionNoPayload {
+};
+
+template <typename Container>
+class MergeInsertionArrayChain;
+template <typename Container>
+class MergeInsertionListChain;
+
+// 並べる要素の型と、要素からキーを取り出す方法
+template <typename Key, typename Payload>
+struct MergeInsertionRecord {
+	typedef std::pair<Key, Payload> type;
+
+	static const Key &getKey(const type &record) { return record.first; }
+};
+
+template <typename Key>
+struct MergeInsertionRecord<Key, MergeInsertionNoPayload> {
+	typedef Key type;
+
+	static const Key &getKey(const type &key) { return key; }
+};
+
+// Ford-Johnson の merge-insertion sort
+// キー同士の比較は Compare でのみ行い、比較の順序と回数はコンテナの種類によらず同じになる
+// ランダムアクセスできるコンテナはユニットの位置の列を、std::list はノードの付け替え (splice) で並べる
+// (Compare はスレッド数を2以上にした場合、複数スレッドから同時に呼ばれる)
+template <typename Key, typename Payload = MergeInsertionNoPayload, typename Compare = std::less<Key> >
+class MergeInsertion
+{
+ public:
+	typedef typename MergeInsertionRecord<Key, Payload>::type value_type;
+	// スレッドに分割する、1レベルあたりの最小要素数
+	static const std::size_t PARALLEL_MIN_ELEMENTS = 1 << 16;
+	// adaptive の場合に、そのまま残す整列済みの区間の最小の長さ
+	static const std::size_t MIN_RUN_LENGTH = 16;
+	// network の場合に sorting network で並べるブロックの大きさ
+	static const std::size_t NETWORK_BLOCK_SIZE = 8;
+
+ private:
+	Compare _compare;
+	std::size_t _threadCount;
+	bool _isAdaptive;
+	bool _isNetwork;
+	bool _isIndirect;
+
+	// sorting network に渡す比較 (回数はブロック単位でまとめて数える)
+	struct UncountedLess {
+		const MergeInsertion *sorter;
+
+		bool operator()(const value_type &left, const value_type &right) const { return this->sorter->_isLess(left, right); }
+	};
+
+	// std::list::merge に渡す比較 (_less を通して回数を数える)
+	struct CountedLess {
+		const MergeInsertion *sorter;
+
+		bool operator()(const value_type &left, const value_type &right) const { return this->sorter->_less(left, right); }
+	};
+
+	template <typename Container>
+	struct PairingTask {
+		const MergeInsertion *sorter;
+		Container *arr;
+		std::size_t spanSize;
+		std::size_t beginSpan;
+		std::size_t endSpan;
+		std::size_t swapCount;
+	};
+
+	template <typename Container>
+	struct GatherTask {
+		const Container *arr;
+		std::vector<value_type> *scratch;
+		const std::vector<std::size_t> *unitOffsets;
+		std::size_t unitSize;
+		std::size_t beginUnit;
+		std::size_t endUnit;
+	};
+
+	// 1回のソートの間、全レベルで使い回す作業領域 (ランダムアクセスできるコンテナ用)
+	// 最上位のレベルで必要な大きさを最初に確保し、レベルごとには確保し直さない
+	template <typename Container>
+	struct RandomAccessWorkspace {
+		// 各レベルの並べ替え先
+		std::vector<value_type> scratch;
+		MergeInsertionArrayChain<Container> chain;
+		std::vector<std::size_t> unitOffsets;
+		std::vector<PairingTask<Container> > pairingTasks;
+		std::vector<GatherTask<Container> > gatherTasks;
+
+		RandomAccessWorkspace(const Container &arr, std::size_t threadCount);
+	};
+
+	bool _isLess(const value_type &left, const value_type &right) const;
+	bool _less(const value_type &left, const value_type &right) const;
+	static void _addComparisons(std::size_t count);
+	static void _addMoves(std::size_t count);
+	static std::vector<std::size_t> _makeGroupSizes(std::size_t count);
+	std::size_t _getTaskCount(std::size_t elementCount, std::size_t itemCount) const;
+
+	template <typename Task>
+	static void _runTasks(std::vector<Task> &tasks, void *(*routine)(void *));
+	template <typename Container>
+	static void *_runPairingTask(void *arg);
+	template <typename Container>
+	static void *_runGatherTask(void *arg);
+
+	template <typename Chain>
+	std::size_t _getInsertTo(const Chain &chain, std::size_t rangeUnitCount, const value_type &target) const;
+	template <typename Chain>
+	void _insertPending(Chain &chain, std::size_t pendingCount, std::size_t sortedCount, const std::vector<std::size_t> &groupSizes, std::size_t limit) const;
+	template <typename Chain>
+	void _insertPendingWithin(Chain &chain, std::size_t rangeUnitCount, std::size_t i, std::size_t limit, std::size_t &sortedLength) const;
+
+	static void _commitGathered(std::vector<value_type> &arr, std::vector<value_type> &scratch, std::size_t unitEnd);
+	template <typename Container>
+	static void _commitGathered(Container &arr, const std::vector<value_type> &scratch, std::size_t unitEnd);
+
+	template <typename Container>
+	void _sortRandomAccess(Container &arr, const std::vector<std::size_t> &groupSizes, std::size_t spanSize, RandomAccessWorkspace<Container> &workspace, std::size_t limit) const;
+	template <typename Container>
+	void _sortList(Container &arr, const std::vector<std::size_t> &groupSizes, std::size_t spanSize, MergeInsertionListChain<Container> &chain, std::size_t limit) const;
+
+	template <typename Iterator>
+	std::size_t _scanRun(Iterator &it, Iterator end, bool &isDescending) const;
+	template <typename Container>
+	void _sortSegment(Container &arr, std::size_t begin, std::size_t end, std::vector<value_type> &buffer, std::vector<std::size_t> &bounds) const;
+	template <typename Container>
+	void _mergeAdjacent(Container &arr, std::size_t begin, std::size_t mid, std::size_t end, std::vector<value_type> &buffer) const;
+	template <typename Container>
+	void _mergeSegments(Container &arr, std::vector<std::size_t> &bounds, std::vector<value_type> &buffer) const;
+	template <typename Container>
+	void _sortAdaptive(Container &container, std::random_access_iterator_tag) const;
+	template <typename Container>
+	void _sortAdaptive(Container &container, std::bidirectional_iterator_tag) const;
+
+	template <typename Container>
+	void _sortNetwork(Container &container, std::random_access_iterator_tag) const;
+	template <typename Container>
+	void _sortNetwork(Container &container, std::bidirectional_iterator_tag) const;
+
+	template <typename Container, typename Index>
+	static void _applyPermutation(Container &arr, std::vector<Index> &sources);
+	template <typename Index, typename Container>
+	void _sortHandles(Container &container) const;
+	template <typename Container>
+	void _sortIndirect(Container &container, std::random_access_iterator_tag) const;
+	template <typename Container>
+	void _sortIndirect(Container &container, std::bidirectional_iterator_tag) const;
+	template <typename Container>
+	void _sortDirect(Container &container) const;
+
+	template <typename Container>
+	void _sort(Container &container, std::random_access_iterator_tag) const;
+	template <typename Container>
+	void _sort(Container &container, std::bidirectional_iterator_tag) const;
+
+	template <typename Container>
+	void _partialSort(Container &container, std::size_t count, std::random_access_iterator_tag) const;
+	template <typename Container>
+	void _partialSort(Container &container, std::size_t count, std::bidirectional_iterator_tag) const;
+
+ public:
+	MergeInsertion();
+	explicit MergeInsertion(const Compare &compare);
+	MergeInsertion(const MergeInsertion &src);
+	virtual ~MergeInsertion();
+	MergeInsertion &operator=(const MergeInsertion &src);
+
+	std::size_t getThreadCount() const;
+	void setThreadCount(std::size_t threadCount);
+	// 入力中の長い整列済み (または逆順) の区間を検出してそのまま使い、
+	// それ以外の区間だけを merge-insertion で並べてからマージする
+	// (比較回数は最小でなくなるが、整列済みに近い入力では大きく減る)
+	bool isAdaptive() const;
+	void setAdaptive(bool isAdaptive);
+	// ランダムアクセスできるコンテナを NETWORK_BLOCK_SIZE 要素ずつ sorting network で並べてから、ブロックをマージする
+	// (比較回数は最小でなくなる代わりに、分岐の少ない処理 (SIMD が使える場合は SIMD) で速く並べる)
+	// std::list には効かない (adaptive またはそのままの merge-insertion で並べる)
+	bool isNetwork() const;
+	void setNetwork(bool isNetwork);
+	// ランダムアクセスできるコンテナを、(キー, 元の位置) の組を並べることで並べ、最後に1回だけ要素を移す
+	// (各レベルでスパンごと要素をコピーしなくなるので、ペイロードの大きい要素で効く)
+	// 組の並べ方には adaptive, network の指定がそのまま使われる
+	// std::list はもともと要素を移さないので効かない
+	bool isIndirect() const;
+	void setIndirect(bool isIndirect);
+
+	// value_type を要素に持つ std::vector, std::deque, std::list などを並べる
+	template <typename Container>
+	void sort(Container &container) const;
+	// 小さい方から count 個だけを先頭に昇順で並べる (残りの順序は問わない)
+	// 先頭 count 個に入り得ないユニットを各レベルで除き、挿入の探索範囲を count までに抑える
+	// adaptive, network, indirect の指定は使わない
+	template <typename Container>
+	void partialSort(Container &container, std::size_t count) const;
+};
+
+#include "./MergeInsertion.tpp"
@@ -0,0 +1,1103 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <limits>
+
+#include "./ChunkedSequence.hpp"
+#include "./SortingNetwork.hpp"
+#include "./MergeInsertion.hpp"
+
+// 主鎖をユニットの先頭位置の列で表す (ランダムアクセスできるコンテナ用)
+// 主鎖への挿入で列全体をずらさないよう、位置の列は ChunkedSequence で持つ
+// 1回のソートの間は全レベルで同じものを reset() して使い回す
+template <typename Container>
+class MergeInsertionArrayChain
+{
+ private:
+	const Container &_arr;
+	std::size_t _unitSize;
+	ChunkedSequence<std::size_t> _offsets;
+
+	MergeInsertionArrayChain(const MergeInsertionArrayChain &src);
+	MergeInsertionArrayChain &operator=(const MergeInsertionArrayChain &src);
+
+ public:
+	explicit MergeInsertionArrayChain(const Container &arr) : _arr(arr), _unitSize(1), _offsets() {}
+	virtual ~MergeInsertionArrayChain() {}
+
+	void reserve(std::size_t unitCount) { this->_offsets.reserve(unitCount); }
+	void reset(std::size_t unitSize)
+	{
+		this->_unitSize = unitSize;
+		this->_offsets.clear();
+	}
+	void push_back(std::size_t offset) { this->_offsets.push_back(offset); }
+	std::size_t size() const { return this->_offsets.size(); }
+	const typename Container::value_type &getUnitMax(std::size_t rank) const { return this->_arr[this->_offsets.at(rank) + this->_unitSize - 1]; }
+	// 未挿入のユニット i は、i + 1 番目のスパンの前半
+	const typename Container::value_type &getPendingMax(std::size_t i) const { return this->_arr[(i + 1) * this->_unitSize * 2 + this->_unitSize - 1]; }
+	void insertPending(std::size_t rank, std::size_t i) { this->_offsets.insert(rank, (i + 1) * this->_unitSize * 2); }
+	void copyOffsetsTo(std::vector<std::size_t> &offsets) const
+	{
+		offsets.resize(this->_offsets.size());
+		this->_offsets.copyTo(offsets.begin());
+	}
+};
+
+// 主鎖を std::list のノードの並びで表し、未挿入のユニットは別の list に退避しておく
+// ユニットの位置 (先頭と最大値のノード) を ChunkedSequence で持ち、順位から O(log n) でノードを引く
+// (list を先頭から歩かずに済むので、挿入1回あたり O(log n) の比較とノード参照で済む)
+// 1回のソートの間は全レベルで同じものを reset() して使い回す
+template <typename Container>
+class MergeInsertionListChain
+{
+ private:
+	typedef typename Container::iterator iterator;
+
+	typedef struct ListUnit {
+		iterator begin;
+		iterator max;
+	} ListUnit;
+
+	Container &_arr;
+	std::size_t _unitSize;
+	Container _pending;
+	ChunkedSequence<ListUnit> _units;
+	std::vector<ListUnit> _pendingUnits;
+
+	MergeInsertionListChain(const MergeInsertionListChain &src);
+	MergeInsertionListChain &operator=(const MergeInsertionListChain &src);
+
+	ListUnit _makeUnit(iterator begin) const
+	{
+		ListUnit unit;
+		unit.begin = begin;
+		unit.max = begin;
+		std::advance(unit.max, this->_unitSize - 1);
+		return unit;
+	}
+
+ public:
+	explicit MergeInsertionListChain(Container &arr) : _arr(arr), _unitSize(1), _pending(), _units(), _pendingUnits() {}
+	virtual ~MergeInsertionListChain() {}
+
+	void reserve(std::size_t unitCount)
+	{
+		this->_units.reserve(unitCount);
+		this->_pendingUnits.reserve(unitCount / 2);
+	}
+
+	// 最初のスパンの2ユニットと、以降のスパンの後半 (大きい方) を主鎖とし、
+	// 2番目以降のスパンの前半 (小さい方) を主鎖から外す
+	void reset(
+		std::size_t unitSize,
+		std::size_t fullSpanCount,
+		std::size_t spanCount
+	)
+	{
+		this->_unitSize = unitSize;
+		this->_units.clear();
+		this->_pendingUnits.clear();
+		iterator it = this->_arr.begin();
+		for (std::size_t span = 0; span < spanCount; span++) {
+			ListUnit unit = this->_makeUnit(it);
+			it = unit.max;
+			++it;
+			if (span == 0) {
+				this->_units.push_back(unit);
+			} else {
+				this->_pendingUnits.push_back(unit);
+				this->_pending.splice(this->_pending.end(), this->_arr, unit.begin, it);
+			}
+			if (span < fullSpanCount) {
+				unit = this->_makeUnit(it);
+				it = unit.max;
+				++it;
+				this->_units.push_back(unit);
+			}
+		}
+	}
+
+	std::size_t size() const { return this->_units.size(); }
+	const typename Container::value_type &getUnitMax(std::size_t rank) const { return *this->_units.at(rank).max; }
+	const typename Container::value_type &getPendingMax(std::size_t i) const { return *this->_pendingUnits[i].max; }
+	void insertPending(std::size_t rank, std::size_t i)
+	{
+		const ListUnit &unit = this->_pendingUnits[i];
+		iterator insertTo;
+		if (rank < this->_units.size()) {
+			insertTo = this->_units.at(rank).begin;
+		} else {
+			// 主鎖の末尾 (ユニットに属さない末尾の要素の手前)
+			insertTo = this->_units.at(rank - 1).max;
+			++insertTo;
+		}
+		iterator end = unit.max;
+		++end;
+		this->_arr.splice(insertTo, this->_pending, unit.begin, end);
+		this->_units.insert(rank, unit);
+	}
+};
+
+// 連続した8要素ブロックを sorting network で並べる
+// キーだけを std::less で並べる std::vector は、SortingNetwork.hpp の sortingNetworkBlocks (型によっては SIMD 版) を使う
+template <typename Container, typename Compare>
+struct MergeInsertionNetworkKernel {
+	template <typename Less>
+	static void sortBlocks(Container &arr, std::size_t blockCount, const Less &less)
+	{
+		for (std::size_t block = 0; block < blockCount; block++) {
+			sortingNetwork8(arr.begin() + block * SORTING_NETWORK_SIZE, less);
+		}
+	}
+};
+
+template <typename T>
+struct MergeInsertionNetworkKernel<std::vector<T>, std::less<T> > {
+	template <typename Less>
+	static void sortBlocks(std::vector<T> &arr, std::size_t blockCount, const Less &)
+	{
+		if (blockCount != 0)
+			sortingNetworkBlocks(&arr[0], blockCount);
+	}
+};
+
+template <typename Key, typename Payload, typename Compare>
+const std::size_t MergeInsertion<Key, Payload, Compare>::PARALLEL_MIN_ELEMENTS;
+
+template <typename Key, typename Payload, typename Compare>
+const std::size_t MergeInsertion<Key, Payload, Compare>::MIN_RUN_LENGTH;
+
+template <typename Key, typename Payload, typename Compare>
+const std::size_t MergeInsertion<Key, Payload, Compare>::NETWORK_BLOCK_SIZE;
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+MergeInsertion<Key, Payload, Compare>::RandomAccessWorkspace<Container>::RandomAccessWorkspace(
+	const Container &arr,
+	std::size_t threadCount
+) : scratch(arr.size()),
+		chain(arr),
+		unitOffsets(),
+		pairingTasks(),
+		gatherTasks()
+{
+	// 主鎖のユニット数は最上位のレベル (ユニットの大きさ 1) の要素数が最大
+	this->chain.reserve(arr.size());
+	this->unitOffsets.reserve(arr.size());
+	this->pairingTasks.reserve(threadCount);
+	this->gatherTasks.reserve(threadCount);
+}
+
+template <typename Key, typename Payload, typename Compare>
+MergeInsertion<Key, Payload, Compare>::MergeInsertion(
+) : _compare(),
+		_threadCount(1),
+		_isAdaptive(false),
+		_isNetwork(false),
+		_isIndirect(false)
+{
+}
+
+template <typename Key, typename Payload, typename Compare>
+MergeInsertion<Key, Payload, Compare>::MergeInsertion(
+	const Compare &compare
+) : _compare(compare),
+		_threadCount(1),
+		_isAdaptive(false),
+		_isNetwork(false),
+		_isIndirect(false)
+{
+}
+
+template <typename Key, typename Payload, typename Compare>
+MergeInsertion<Key, Payload, Compare>::MergeInsertion(
+	const MergeInsertion &src
+) : _compare(src._compare),
+		_threadCount(src._threadCount),
+		_isAdaptive(src._isAdaptive),
+		_isNetwork(src._isNetwork),
+		_isIndirect(src._isIndirect)
+{
+}
+
+template <typename Key, typename Payload, typename Compare>
+MergeInsertion<Key, Payload, Compare>::~MergeInsertion(
+)
+{
+}
+
+template <typename Key, typename Payload, typename Compare>
+MergeInsertion<Key, Payload, Compare> &MergeInsertion<Key, Payload, Compare>::operator=(
+	const MergeInsertion &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_compare = src._compare;
+	this->_threadCount = src._threadCount;
+	this->_isAdaptive = src._isAdaptive;
+	this->_isNetwork = src._isNetwork;
+	this->_isIndirect = src._isIndirect;
+
+	return *this;
+}
+
+template <typename Key, typename Payload, typename Compare>
+std::size_t MergeInsertion<Key, Payload, Compare>::getThreadCount(
+) const
+{
+	return this->_threadCount;
+}
+
+template <typename Key, typename Payload, typename Compare>
+void MergeInsertion<Key, Payload, Compare>::setThreadCount(
+	std::size_t threadCount
+)
+{
+	this->_threadCount = threadCount == 0 ? 1 : threadCount;
+}
+
+template <typename Key, typename Payload, typename Compare>
+bool MergeInsertion<Key, Payload, Compare>::isAdaptive(
+) const
+{
+	return this->_isAdaptive;
+}
+
+template <typename Key, typename Payload, typename Compare>
+void MergeInsertion<Key, Payload, Compare>::setAdaptive(
+	bool isAdaptive
+)
+{
+	this->_isAdaptive = isAdaptive;
+}
+
+template <typename Key, typename Payload, typename Compare>
+bool MergeInsertion<Key, Payload, Compare>::isNetwork(
+) const
+{
+	return this->_isNetwork;
+}
+
+template <typename Key, typename Payload, typename Compare>
+void MergeInsertion<Key, Payload, Compare>::setNetwork(
+	bool isNetwork
+)
+{
+	this->_isNetwork = isNetwork;
+}
+
+template <typename Key, typename Payload, typename Compare>
+bool MergeInsertion<Key, Payload, Compare>::isIndirect(
+) const
+{
+	return this->_isIndirect;
+}
+
+template <typename Key, typename Payload, typename Compare>
+void MergeInsertion<Key, Payload, Compare>::setIndirect(
+	bool isIndirect
+)
+{
+	this->_isIndirect = isIndirect;
+}
+
+template <typename Key, typename Payload, typename Compare>
+bool MergeInsertion<Key, Payload, Compare>::_isLess(
+	const value_type &left,
+	const value_type &right
+) const
+{
+	typedef MergeInsertionRecord<Key, Payload> Record;
+	return this->_compare(Record::getKey(left), Record::getKey(right));
+}
+
+// キー同士の比較は必ずこれを通す (COUNT 時に回数を数えるため)
+template <typename Key, typename Payload, typename Compare>
+bool MergeInsertion<Key, Payload, Compare>::_less(
+	const value_type &left,
+	const value_type &right
+) const
+{
+	_addComparisons(1);
+	return this->_isLess(left, right);
+}
+
+template <typename Key, typename Payload, typename Compare>
+void MergeInsertion<Key, Payload, Compare>::_addComparisons(
+	std::size_t count
+)
+{
+#ifdef COUNT
+	getMergeInsertionStats().comparisons += count;
+#else
+	(void)count;
+#endif	// COUNT
+}
+
+template <typename Key, typename Payload, typename Compare>
+void MergeInsertion<Key, Payload, Compare>::_addMoves(
+	std::size_t count
+)
+{
+#ifdef COUNT
+	getMergeInsertionStats().moves += count;
+#else
+	(void)count;
+#endif	// COUNT
+}
+
+// 挿入するグループの大きさ (ヤコブスタール数の差の2倍: 2, 2, 6, 10, 22, ...)
+template <typename Key, typename Payload, typename Compare>
+std::vector<std::size_t> MergeInsertion<Key, Payload, Compare>::_makeGroupSizes(
+	std::size_t count
+)
+{
+	std::vector<std::size_t> groupSizes;
+	// グループ数は size_t のビット数を超えない
+	groupSizes.reserve(sizeof(std::size_t) * CHAR_BIT);
+	std::size_t lastValue = 1;
+	std::size_t sum = lastValue;
+	std::size_t n = 1;
+	groupSizes.push_back(lastValue * 2);
+	while ((sum * 2) < count) {
+		std::size_t nextValue = 2 * lastValue + ((n++ & 1) == 0 ? 1 : -1);
+		groupSizes.push_back(nextValue * 2);
+		lastValue = nextValue;
+		// オーバーフローは到底起こり得ないのでチェックは省略
+		sum += nextValue;
+	}
+	return groupSizes;
+}
+
+// 要素数が少ないレベルではスレッドを作るコストの方が大きいので分割しない
+template <typename Key, typename Payload, typename Compare>
+std::size_t MergeInsertion<Key, Payload, Compare>::_getTaskCount(
+	std::size_t elementCount,
+	std::size_t itemCount
+) const
+{
+	if (this->_threadCount < 2 || elementCount < PARALLEL_MIN_ELEMENTS)
+		return 1;
+	return std::max<std::size_t>(1, std::min(this->_threadCount, itemCount));
+}
+
+// tasks[0] は呼び出し元のスレッドで実行し、残りはスレッドを作って実行する
+// (スレッドを作れなかった分は呼び出し元で順に実行する)
+template <typename Key, typename Payload, typename Compare>
+template <typename Task>
+void MergeInsertion<Key, Payload, Compare>::_runTasks(
+	std::vector<Task> &tasks,
+	void *(*routine)(void *)
+)
+{
+	if (tasks.size() == 1) {
+		routine(&tasks[0]);
+		return;
+	}
+	std::vector<pthread_t> threads(tasks.size());
+	std::vector<bool> isStarted(tasks.size(), false);
+	for (std::size_t i = 1; i < tasks.size(); i++) {
+		isStarted[i] = pthread_create(&threads[i], NULL, routine, &tasks[i]) == 0;
+	}
+	routine(&tasks[0]);
+	for (std::size_t i = 1; i < tasks.size(); i++) {
+		if (isStarted[i])
+			pthread_join(threads[i], NULL);
+		else
+			routine(&tasks[i]);
+	}
+}
+
+// [beginSpan, endSpan) 番目のスパンの2ユニットを比較して並べる
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void *MergeInsertion<Key, Payload, Compare>::_runPairingTask(
+	void *arg
+)
+{
+	PairingTask<Container> &task = *static_cast<PairingTask<Container> *>(arg);
+	Container &arr = *task.arr;
+	std::size_t spanSizeHalf = task.spanSize / 2;
+	task.swapCount = 0;
+	for (std::size_t span = task.beginSpan; span < task.endSpan; span++) {
+		std::size_t i = span * task.spanSize;
+		std::size_t leftMax = i + spanSizeHalf - 1;
+		std::size_t rightMax = leftMax + spanSizeHalf;
+		// 複数スレッドから呼ばれるので _less は使わず、回数は呼び出し元でまとめて数える
+		if (task.sorter->_isLess(arr[rightMax], arr[leftMax])) {
+			std::swap_ranges(arr.begin() + i, arr.begin() + leftMax + 1, arr.begin() + leftMax + 1);
+			++task.swapCount;
+		}
+	}
+	return NULL;
+}
+
+// [beginUnit, endUnit) 番目のユニットを scratch の同じ順位の位置へコピーする
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void *MergeInsertion<Key, Payload, Compare>::_runGatherTask(
+	void *arg
+)
+{
+	GatherTask<Container> &task = *static_cast<GatherTask<Container> *>(arg);
+	const std::vector<std::size_t> &unitOffsets = *task.unitOffsets;
+	typename std::vector<value_type>::iterator outIt = task.scratch->begin() + task.beginUnit * task.unitSize;
+	for (std::size_t i = task.beginUnit; i < task.endUnit; i++) {
+		typename Container::const_iterator unitIt = task.arr->begin() + unitOffsets[i];
+		outIt = std::copy(unitIt, unitIt + task.unitSize, outIt);
+	}
+	return NULL;
+}
+
+// 主鎖の先頭 rangeUnitCount ユニットから target の挿入位置を二分探索する
+template <typename Key, typename Payload, typename Compare>
+template <typename Chain>
+std::size_t MergeInsertion<Key, Payload, Compare>::_getInsertTo(
+	const Chain &chain,
+	std::size_t rangeUnitCount,
+	const value_type &target
+) const
+{
+	std::size_t rangeTop = 0;
+	while (rangeUnitCount != 0) {
+		std::size_t rangeCenter = rangeTop + rangeUnitCount / 2;
+		if (this->_less(chain.getUnitMax(rangeCenter), target)) {
+			// 前半分 + 中央が除かれる
+			rangeTop = rangeCenter + 1;
+			rangeUnitCount = rangeUnitCount - (rangeUnitCount / 2) - 1;
+		} else {
+			rangeUnitCount = rangeUnitCount / 2;
+		}
+	}
+	return rangeTop;
+}
+
+// 未挿入のユニットを、グループごとに後ろから主鎖へ挿入する
+// 最初の2ユニット(1スパン)は必ずソート済みなので、探索範囲は1ユニットから始まる
+// 主鎖の先頭 limit ユニットだけを確定させる場合は、探索範囲を limit までに抑え、
+// それより後ろに入るユニットは主鎖の末尾へ回す (末尾の順序は問わない)
+// 相手が並んでいない (sortedCount 番目以降の) ユニットは、グループの後で整列済みの範囲全体から探す
+template <typename Key, typename Payload, typename Compare>
+template <typename Chain>
+void MergeInsertion<Key, Payload, Compare>::_insertPending(
+	Chain &chain,
+	std::size_t pendingCount,
+	std::size_t sortedCount,
+	const std::vector<std::size_t> &groupSizes,
+	std::size_t limit
+) const
+{
+	// 主鎖のうち、先頭から整列している部分 (最初のスパンの2ユニットと、並んでいる相手) の長さ
+	std::size_t sortedLength = pendingCount == sortedCount ? chain.size() : sortedCount + 2;
+	std::size_t pendingIndex = 0;
+	std::size_t lastGroupSize = 0;
+	std::size_t searchRangeUnitCount = 1;
+	for (std::size_t group = 0; pendingIndex < sortedCount; group++) {
+		std::size_t groupSize = std::min(groupSizes[group], sortedCount - pendingIndex);
+		searchRangeUnitCount += lastGroupSize + groupSize;
+		lastGroupSize = groupSize;
+		for (std::size_t i = pendingIndex + groupSize; pendingIndex < i--;) {
+			this->_insertPendingWithin(chain, std::min(searchRangeUnitCount, sortedLength), i, limit, sortedLength);
+		}
+		pendingIndex += groupSize;
+	}
+	for (; pendingIndex < pendingCount; pendingIndex++) {
+		this->_insertPendingWithin(chain, sortedLength, pendingIndex, limit, sortedLength);
+	}
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Chain>
+void MergeInsertion<Key, Payload, Compare>::_insertPendingWithin(
+	Chain &chain,
+	std::size_t rangeUnitCount,
+	std::size_t i,
+	std::size_t limit,
+	std::size_t &sortedLength
+) const
+{
+	// 探索範囲が limit に届く場合は、先に limit 番目と比べて、後ろに入るものを1回の比較で除く
+	if (limit <= rangeUnitCount) {
+		if (this->_less(chain.getUnitMax(limit - 1), chain.getPendingMax(i))) {
+			chain.insertPending(chain.size(), i);
+			return;
+		}
+		rangeUnitCount = limit - 1;
+	}
+	chain.insertPending(this->_getInsertTo(chain, rangeUnitCount, chain.getPendingMax(i)), i);
+	++sortedLength;
+}
+
+// std::vector は scratch と中身を入れ替える (ユニットに属さない末尾の要素も scratch へ移しておく)
+template <typename Key, typename Payload, typename Compare>
+void MergeInsertion<Key, Payload, Compare>::_commitGathered(
+	std::vector<value_type> &arr,
+	std::vector<value_type> &scratch,
+	std::size_t unitEnd
+)
+{
+	std::copy(arr.begin() + unitEnd, arr.end(), scratch.begin() + unitEnd);
+	_addMoves(arr.size() - unitEnd);
+	arr.swap(scratch);
+}
+
+// それ以外のコンテナは scratch から書き戻す (末尾の要素はそのまま残る)
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_commitGathered(
+	Container &arr,
+	const std::vector<value_type> &scratch,
+	std::size_t unitEnd
+)
+{
+	std::copy(scratch.begin(), scratch.begin() + unitEnd, arr.begin());
+	_addMoves(unitEnd);
+}
+
+// ユニットの位置を並べ替えたあと、レベルの最後に1回だけ要素を scratch へ並べ直す
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortRandomAccess(
+	Container &arr,
+	const std::vector<std::size_t> &groupSizes,
+	std::size_t spanSize,
+	RandomAccessWorkspace<Container> &workspace,
+	std::size_t limit
+) const
+{
+	if (arr.size() < spanSize)
+		return;
+
+	std::size_t spanSizeHalf = spanSize / 2;
+	std::size_t fullSpanCount = arr.size() / spanSize;
+	// スパン同士は独立しているので、スパン単位で分割して比較する
+	std::size_t pairingTaskCount = this->_getTaskCount(arr.size(), fullSpanCount);
+	std::vector<PairingTask<Container> > &pairingTasks = workspace.pairingTasks;
+	pairingTasks.resize(pairingTaskCount);
+	for (std::size_t i = 0; i < pairingTaskCount; i++) {
+		pairingTasks[i].sorter = this;
+		pairingTasks[i].arr = &arr;
+		pairingTasks[i].spanSize = spanSize;
+		pairingTasks[i].beginSpan = fullSpanCount * i / pairingTaskCount;
+		pairingTasks[i].endSpan = fullSpanCount * (i + 1) / pairingTaskCount;
+	}
+	_runTasks(pairingTasks, &MergeInsertion::_runPairingTask<Container>);
+	_addComparisons(fullSpanCount);
+	for (std::size_t i = 0; i < pairingTaskCount; i++) {
+		_addMoves(pairingTasks[i].swapCount * spanSizeHalf * 3);
+	}
+
+	// 大きい方のユニットが limit 以内に入るには、相手と合わせて自分より小さいユニットが limit - 1 個以下でなければならない
+	// (大きい方の中で limit の半分 (切り上げ) 番目より後ろのものは除いてよい)
+	std::size_t spanLimit = limit - limit / 2;
+	this->_sortRandomAccess(arr, groupSizes, spanSize * 2, workspace, spanLimit);
+
+	std::size_t spanCount = fullSpanCount;
+	bool isAdditionalSpanAvailable = spanSizeHalf <= (arr.size() % spanSize);
+	if (isAdditionalSpanAvailable)
+		++spanCount;
+	if (spanCount < 2)
+		return;
+
+	// 主鎖: 最初のスパンの2ユニットと、以降のスパンの後半 (大きい方)
+	// 並んでいるのは先頭の sortedSpanCount スパンまでで、それより後ろの大きい方は limit 以内に入らない
+	MergeInsertionArrayChain<Container> &chain = workspace.chain;
+	chain.reset(spanSizeHalf);
+	chain.push_back(0);
+	for (std::size_t i = 0; i < fullSpanCount; i++) {
+		chain.push_back(i * spanSize + spanSizeHalf);
+	}
+	std::size_t sortedSpanCount = std::min(fullSpanCount, spanLimit);
+	this->_insertPending(chain, spanCount - 1, sortedSpanCount == fullSpanCount ? spanCount - 1 : sortedSpanCount - 1, groupSizes, limit);
+
+	// 主鎖の順にユニットを並べ、ユニットに属さない末尾の要素はそのまま残す
+	// コピー先が重ならないので、ユニット単位で分割してコピーする
+	std::size_t unitEnd = fullSpanCount * spanSize + (isAdditionalSpanAvailable ? spanSizeHalf : 0);
+	std::vector<std::size_t> &unitOffsets = workspace.unitOffsets;
+	chain.copyOffsetsTo(unitOffsets);
+	std::size_t gatherTaskCount = this->_getTaskCount(arr.size(), unitOffsets.size());
+	std::vector<GatherTask<Container> > &gatherTasks = workspace.gatherTasks;
+	gatherTasks.resize(gatherTaskCount);
+	for (std::size_t i = 0; i < gatherTaskCount; i++) {
+		gatherTasks[i].arr = &arr;
+		gatherTasks[i].scratch = &workspace.scratch;
+		gatherTasks[i].unitOffsets = &unitOffsets;
+		gatherTasks[i].unitSize = spanSizeHalf;
+		gatherTasks[i].beginUnit = unitOffsets.size() * i / gatherTaskCount;
+		gatherTasks[i].endUnit = unitOffsets.size() * (i + 1) / gatherTaskCount;
+	}
+	_runTasks(gatherTasks, &MergeInsertion::_runGatherTask<Container>);
+	_addMoves(unitEnd);
+	_commitGathered(arr, workspace.scratch, unitEnd);
+}
+
+// 要素はコピーせず、ノードの付け替えだけで並べる
+// limit の扱いは _sortRandomAccess と同じ
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortList(
+	Container &arr,
+	const std::vector<std::size_t> &groupSizes,
+	std::size_t spanSize,
+	MergeInsertionListChain<Container> &chain,
+	std::size_t limit
+) const
+{
+	typedef typename Container::iterator iterator;
+
+	if (arr.size() < spanSize)
+		return;
+
+	std::size_t spanSizeHalf = spanSize / 2;
+	std::size_t fullSpanCount = arr.size() / spanSize;
+	iterator it = arr.begin();
+	for (std::size_t span = 0; span < fullSpanCount; span++) {
+		iterator leftMaxIt = it;
+		std::advance(leftMaxIt, spanSizeHalf - 1);
+		iterator rightTopIt = leftMaxIt;
+		++rightTopIt;
+		iterator rightMaxIt = rightTopIt;
+		std::advance(rightMaxIt, spanSizeHalf - 1);
+		iterator spanEndIt = rightMaxIt;
+		++spanEndIt;
+		// 大きい方のユニットを後ろにする
+		if (this->_less(*rightMaxIt, *leftMaxIt))
+			arr.splice(it, arr, rightTopIt, spanEndIt);
+		it = spanEndIt;
+	}
+
+	std::size_t spanLimit = limit - limit / 2;
+	this->_sortList(arr, groupSizes, spanSize * 2, chain, spanLimit);
+
+	std::size_t spanCount = fullSpanCount;
+	bool isAdditionalSpanAvailable = spanSizeHalf <= (arr.size() % spanSize);
+	if (isAdditionalSpanAvailable)
+		++spanCount;
+	if (spanCount < 2)
+		return;
+
+	chain.reset(spanSizeHalf, fullSpanCount, spanCount);
+	std::size_t sortedSpanCount = std::min(fullSpanCount, spanLimit);
+	this->_insertPending(chain, spanCount - 1, sortedSpanCount == fullSpanCount ? spanCount - 1 : sortedSpanCount - 1, groupSizes, limit);
+}
+
+// it から始まる昇順 (等しい要素を含む) または狭義の降順の区間の長さを返し、it を区間の末尾の次へ進める
+// 区間の長さ分 (末尾では1つ少ない) の比較を行う
+template <typename Key, typename Payload, typename Compare>
+template <typename Iterator>
+std::size_t MergeInsertion<Key, Payload, Compare>::_scanRun(
+	Iterator &it,
+	Iterator end,
+	bool &isDescending
+) const
+{
+	Iterator next = it;
+	++next;
+	isDescending = false;
+	if (next == end) {
+		it = next;
+		return 1;
+	}
+	isDescending = this->_less(*next, *it);
+	std::size_t length = 2;
+	for (++it, ++next; next != end; ++it, ++next, ++length) {
+		if (this->_less(*next, *it) != isDescending)
+			break;
+	}
+	it = next;
+	return length;
+}
+
+// [begin, end) を merge-insertion で並べ、整列済みの区間の境界として end を記録する
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortSegment(
+	Container &arr,
+	std::size_t begin,
+	std::size_t end,
+	std::vector<value_type> &buffer,
+	std::vector<std::size_t> &bounds
+) const
+{
+	if (begin == end)
+		return;
+	if (begin == 0 && end == arr.size()) {
+		// 全体が整列していない場合はコピーせずにそのまま並べる
+		this->_sort(arr, std::random_access_iterator_tag());
+	} else if (1 < end - begin) {
+		buffer.assign(arr.begin() + begin, arr.begin() + end);
+		this->_sort(buffer, std::random_access_iterator_tag());
+		std::copy(buffer.begin(), buffer.end(), arr.begin() + begin);
+		_addMoves((end - begin) * 2);
+	}
+	bounds.push_back(end);
+}
+
+// 整列済みの [begin, mid) と [mid, end) をマージする (前半だけを buffer に退避する)
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_mergeAdjacent(
+	Container &arr,
+	std::size_t begin,
+	std::size_t mid,
+	std::size_t end,
+	std::vector<value_type> &buffer
+) const
+{
+	// 境目がすでに整列していれば何もしない
+	if (!this->_less(arr[mid], arr[mid - 1]))
+		return;
+	buffer.assign(arr.begin() + begin, arr.begin() + mid);
+	std::size_t out = begin;
+	std::size_t left = 0;
+	std::size_t right = mid;
+	while (left < buffer.size() && right < end) {
+		if (this->_less(arr[right], buffer[left]))
+			arr[out++] = arr[right++];
+		else
+			arr[out++] = buffer[left++];
+	}
+	while (left < buffer.size()) {
+		arr[out++] = buffer[left++];
+	}
+	_addMoves((mid - begin) + (out - begin));
+}
+
+// bounds で区切られた整列済みの区間を、隣どうし2つずつマージしていく
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_mergeSegments(
+	Container &arr,
+	std::vector<std::size_t> &bounds,
+	std::vector<value_type> &buffer
+) const
+{
+	while (2 < bounds.size()) {
+		std::size_t boundCount = 1;
+		for (std::size_t i = 0; i + 1 < bounds.size(); i += 2) {
+			if (i + 2 < bounds.size())
+				this->_mergeAdjacent(arr, bounds[i], bounds[i + 1], bounds[i + 2], buffer);
+			bounds[boundCount++] = bounds[std::min(i + 2, bounds.size() - 1)];
+		}
+		bounds.resize(boundCount);
+	}
+}
+
+// 長い区間はそのまま (降順なら反転して) 残し、その間の短い区間をまとめて merge-insertion で並べてからマージする
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortAdaptive(
+	Container &arr,
+	std::random_access_iterator_tag
+) const
+{
+	std::size_t size = arr.size();
+	if (size < 2)
+		return;
+
+	std::vector<value_type> buffer;
+	// 整列済みの区間の境界 (先頭の 0 と末尾の size を含む)
+	std::vector<std::size_t> bounds;
+	bounds.push_back(0);
+	std::size_t disorderedBegin = 0;
+	typename Container::iterator it = arr.begin();
+	for (std::size_t i = 0; i < size;) {
+		bool isDescending;
+		std::size_t runLength = this->_scanRun(it, arr.end(), isDescending);
+		if (MIN_RUN_LENGTH <= runLength) {
+			this->_sortSegment(arr, disorderedBegin, i, buffer, bounds);
+			if (isDescending) {
+				std::reverse(arr.begin() + i, arr.begin() + i + runLength);
+				_addMoves(runLength / 2 * 3);
+			}
+			bounds.push_back(i + runLength);
+			disorderedBegin = i + runLength;
+		}
+		i += runLength;
+	}
+	this->_sortSegment(arr, disorderedBegin, size, buffer, bounds);
+	this->_mergeSegments(arr, bounds, buffer);
+}
+
+// list は区間ごとに別の list へ付け替え、std::list::merge でマージする
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortAdaptive(
+	Container &arr,
+	std::bidirectional_iterator_tag
+) const
+{
+	typedef typename Container::iterator iterator;
+
+	if (arr.size() < 2)
+		return;
+
+	// 要素の追加で list 自体がコピーされないよう deque で持つ
+	std::deque<Container> segments;
+	Container disordered;
+	while (!arr.empty()) {
+		iterator runBegin = arr.begin();
+		iterator runEnd = runBegin;
+		bool isDescending;
+		std::size_t runLength = this->_scanRun(runEnd, arr.end(), isDescending);
+		if (runLength < MIN_RUN_LENGTH) {
+			disordered.splice(disordered.end(), arr, runBegin, runEnd);
+			continue;
+		}
+		if (!disordered.empty()) {
+			this->_sort(disordered, std::bidirectional_iterator_tag());
+			segments.push_back(Container());
+			segments.back().swap(disordered);
+		}
+		segments.push_back(Container());
+		segments.back().splice(segments.back().end(), arr, runBegin, runEnd);
+		if (isDescending)
+			segments.back().reverse();
+	}
+	if (!disordered.empty()) {
+		this->_sort(disordered, std::bidirectional_iterator_tag());
+		segments.push_back(Container());
+		segments.back().swap(disordered);
+	}
+
+	CountedLess less;
+	less.sorter = this;
+	while (1 < segments.size()) {
+		std::size_t segmentCount = 0;
+		for (std::size_t i = 0; i < segments.size(); i += 2) {
+			if (i + 1 < segments.size()) {
+				Container &left = segments[i];
+				Container &right = segments[i + 1];
+				// 境目がすでに整列していれば付け替えるだけで済む
+				if (this->_less(right.front(), left.back()))
+					left.merge(right, less);
+				else
+					left.splice(left.end(), right);
+			}
+			segments[segmentCount++].swap(segments[i]);
+		}
+		segments.resize(segmentCount);
+	}
+	arr.swap(segments.front());
+}
+
+// NETWORK_BLOCK_SIZE 要素ずつのブロックを sorting network で並べ、端数は merge-insertion で並べてからマージする
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortNetwork(
+	Container &arr,
+	std::random_access_iterator_tag
+) const
+{
+	std::size_t size = arr.size();
+	std::size_t blockCount = size / NETWORK_BLOCK_SIZE;
+	UncountedLess less;
+	less.sorter = this;
+	MergeInsertionNetworkKernel<Container, Compare>::sortBlocks(arr, blockCount, less);
+	_addComparisons(blockCount * SORTING_NETWORK_COMPARATOR_COUNT);
+
+	std::vector<value_type> buffer;
+	std::vector<std::size_t> bounds;
+	bounds.reserve(blockCount + 2);
+	for (std::size_t block = 0; block <= blockCount; block++) {
+		bounds.push_back(block * NETWORK_BLOCK_SIZE);
+	}
+	this->_sortSegment(arr, blockCount * NETWORK_BLOCK_SIZE, size, buffer, bounds);
+	this->_mergeSegments(arr, bounds, buffer);
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortNetwork(
+	Container &container,
+	std::bidirectional_iterator_tag
+) const
+{
+	if (this->_isAdaptive)
+		this->_sortAdaptive(container, std::bidirectional_iterator_tag());
+	else
+		this->_sort(container, std::bidirectional_iterator_tag());
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sort(
+	Container &container,
+	std::random_access_iterator_tag
+) const
+{
+	RandomAccessWorkspace<Container> workspace(container, this->_threadCount);
+	this->_sortRandomAccess(container, _makeGroupSizes(container.size()), 2, workspace, std::numeric_limits<std::size_t>::max());
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sort(
+	Container &container,
+	std::bidirectional_iterator_tag
+) const
+{
+	MergeInsertionListChain<Container> chain(container);
+	chain.reserve(container.size());
+	this->_sortList(container, _makeGroupSizes(container.size()), 2, chain, std::numeric_limits<std::size_t>::max());
+}
+
+// 並べた後の i 番目に、元の sources[i] 番目の要素を置く
+// 置換を巡回ごとにたどるので、各要素の移動は1回 (巡回ごとに1つ退避する) で済む
+// たどり終えた位置は sources[i] = i にして印にする
+template <typename Key, typename Payload, typename Compare>
+template <typename Container, typename Index>
+void MergeInsertion<Key, Payload, Compare>::_applyPermutation(
+	Container &arr,
+	std::vector<Index> &sources
+)
+{
+	for (std::size_t start = 0; start < sources.size(); start++) {
+		if (sources[start] == start)
+			continue;
+		value_type saved = arr[start];
+		std::size_t current = start;
+		std::size_t moveCount = 2;
+		while (sources[current] != start) {
+			std::size_t next = sources[current];
+			arr[current] = arr[next];
+			sources[current] = static_cast<Index>(current);
+			current = next;
+			++moveCount;
+		}
+		arr[current] = saved;
+		sources[current] = static_cast<Index>(current);
+		_addMoves(moveCount);
+	}
+}
+
+// (キー, 元の位置) の組を並べ、その順に要素を1回だけ移す
+// 比較は組のキーに対して同じ Compare で行うので、比較の順序と回数は直接並べる場合と同じになる
+template <typename Key, typename Payload, typename Compare>
+template <typename Index, typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortHandles(
+	Container &container
+) const
+{
+	typedef MergeInsertion<Key, Index, Compare> HandleSorter;
+	typedef MergeInsertionRecord<Key, Payload> Record;
+
+	std::vector<typename HandleSorter::value_type> handles;
+	handles.reserve(container.size());
+	for (std::size_t i = 0; i < container.size(); i++) {
+		handles.push_back(typename HandleSorter::value_type(Record::getKey(container[i]), static_cast<Index>(i)));
+	}
+	HandleSorter sorter(this->_compare);
+	sorter.setThreadCount(this->_threadCount);
+	sorter.setAdaptive(this->_isAdaptive);
+	sorter.setNetwork(this->_isNetwork);
+	sorter.sort(handles);
+
+	std::vector<Index> sources(handles.size());
+	for (std::size_t i = 0; i < handles.size(); i++) {
+		sources[i] = handles[i].second;
+	}
+	std::vector<typename HandleSorter::value_type>().swap(handles);
+	_applyPermutation(container, sources);
+}
+
+// 位置が unsigned int に収まる場合は組を小さくする (キーが 32 ビット以下なら 8 バイト)
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortIndirect(
+	Container &container,
+	std::random_access_iterator_tag
+) const
+{
+	if (container.size() <= std::numeric_limits<unsigned int>::max())
+		this->_sortHandles<unsigned int>(container);
+	else
+		this->_sortHandles<std::size_t>(container);
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortIndirect(
+	Container &container,
+	std::bidirectional_iterator_tag
+) const
+{
+	this->_sortDirect(container);
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_sortDirect(
+	Container &container
+) const
+{
+	typedef typename std::iterator_traits<typename Container::iterator>::iterator_category Category;
+	if (this->_isNetwork)
+		this->_sortNetwork(container, Category());
+	else if (this->_isAdaptive)
+		this->_sortAdaptive(container, Category());
+	else
+		this->_sort(container, Category());
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::sort(
+	Container &container
+) const
+{
+	typedef typename std::iterator_traits<typename Container::iterator>::iterator_category Category;
+	if (this->_isIndirect)
+		this->_sortIndirect(container, Category());
+	else
+		this->_sortDirect(container);
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_partialSort(
+	Container &container,
+	std::size_t count,
+	std::random_access_iterator_tag
+) const
+{
+	RandomAccessWorkspace<Container> workspace(container, this->_threadCount);
+	this->_sortRandomAccess(container, _makeGroupSizes(container.size()), 2, workspace, count);
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::_partialSort(
+	Container &container,
+	std::size_t count,
+	std::bidirectional_iterator_tag
+) const
+{
+	MergeInsertionListChain<Container> chain(container);
+	chain.reserve(container.size());
+	this->_sortList(container, _makeGroupSizes(container.size()), 2, chain, count);
+}
+
+template <typename Key, typename Payload, typename Compare>
+template <typename Container>
+void MergeInsertion<Key, Payload, Compare>::partialSort(
+	Container &container,
+	std::size_t count
+) const
+{
+	typedef typename std::iterator_traits<typename Container::iterator>::iterator_category Category;
+	if (count == 0)
+		return;
+	if (container.size() <= count) {
+		this->_sort(container, Category());
+		return;
+	}
+	this->_partialSort(container, count, Category());
+}
@@ -10,80 +10,239 @@
 #include <iostream>
 #include <iterator>
 #include <limits>
-#include <set>
+#include <new>
+#include <stdexcept>
+
+#include "./PmergeMeReader.hpp"
 
 PmergeMe::VALUE_TYPE PmergeMe::MAX = std::numeric_limits<PmergeMe::VALUE_TYPE>::max();
 PmergeMe::VALUE_TYPE PmergeMe::MIN = std::numeric_limits<PmergeMe::VALUE_TYPE>::min();
 
-#ifdef DEBUG
-template <typename T>
-static void print_container(
-	const std::string &header,
-	const T &container
+#ifdef COUNT
+// コンテナが内部で行う確保も含めて数えるため、グローバルの operator new を置き換える
+void *operator new(
+	std::size_t size
+) throw(std::bad_alloc)
+{
+	++getMergeInsertionStats().allocations;
+	void *ptr = std::malloc(size == 0 ? 1 : size);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(
+	void *ptr
+) throw()
+{
+	std::free(ptr);
+}
+
+const PmergeMe::Stats &PmergeMe::getStats(
 )
 {
-	std::cout
-		<< header;
-	for (
-		typename T::const_iterator it = container.begin();
-		it != container.end();
-		++it
-	) {
-		std::cout
-			<< " "
-			<< *it;
-	}
-	std::cout
-		<< std::endl;
+	return getMergeInsertionStats();
+}
+
+void PmergeMe::resetStats(
+)
+{
+	PmergeMe::Stats &stats = getMergeInsertionStats();
+	stats.comparisons = 0;
+	stats.moves = 0;
+	stats.allocations = 0;
 }
-#endif	// DEBUG
+#endif	// COUNT
 
-PmergeMe::PmergeMe()
+PmergeMe::PmergeMe(
+) : _width(PmergeMe::WIDTH_16),
+		_storage16(),
+		_storage32(),
+		_storage64(),
+		_threadCount(1),
+		_isAdaptive(false),
+		_isNetwork(false),
+		_isIndirect(false),
+		_topCount(0)
 {
 }
 
-static bool isPositiveIntStr(
-	const char *str
+// 重複の検出に使う、空きを表す値 (0 自体は別に数える)
+static const PmergeMe::VALUE_TYPE EMPTY_SLOT = 0;
+// 1つのハッシュ表に入れる要素数の目安 (表がキャッシュに収まる程度)
+static const size_t DUPLICATE_CHECK_BUCKET_SIZE = 1 << 12;
+
+static PmergeMe::VALUE_TYPE _hash(
+	PmergeMe::VALUE_TYPE value
 )
 {
-	while (*str != '\0') {
-		if (!std::isdigit(*str))
-			return false;
-		str++;
+	value *= 0x9E3779B97F4A7C15ULL;
+	return value ^ (value >> 29);
+}
+
+// ハッシュの上位ビットでバケットに振り分けてから、バケットごとに小さなオープンアドレス法の表で調べる
+// (std::set のように要素ごとの確保をせず、表がキャッシュに収まるようにするため)
+static bool _hasDuplicate(
+	const std::vector<PmergeMe::VALUE_TYPE> &values
+)
+{
+	size_t bucketBits = 0;
+	while ((DUPLICATE_CHECK_BUCKET_SIZE << bucketBits) < values.size())
+		++bucketBits;
+	size_t bucketCount = static_cast<size_t>(1) << bucketBits;
+
+	std::vector<size_t> bucketEnds(bucketCount + 1, 0);
+	size_t zeroCount = 0;
+	for (size_t i = 0; i < values.size(); i++) {
+		if (values[i] == EMPTY_SLOT)
+			++zeroCount;
+		else
+			++bucketEnds[bucketBits == 0 ? 1 : (_hash(values[i]) >> (64 - bucketBits)) + 1];
+	}
+	if (1 < zeroCount)
+		return true;
+	size_t maxBucketSize = 0;
+	for (size_t i = 1; i <= bucketCount; i++) {
+		maxBucketSize = std::max(maxBucketSize, bucketEnds[i]);
+		bucketEnds[i] += bucketEnds[i - 1];
+	}
+
+	std::vector<PmergeMe::VALUE_TYPE> partitioned(bucketEnds[bucketCount]);
+	std::vector<size_t> bucketPositions(bucketEnds.begin(), bucketEnds.end() - 1);
+	for (size_t i = 0; i < values.size(); i++) {
+		if (values[i] != EMPTY_SLOT)
+			partitioned[bucketPositions[bucketBits == 0 ? 0 : _hash(values[i]) >> (64 - bucketBits)]++] = values[i];
 	}
-	return true;
+
+	// 表の使用率を 1/2 以下に保つ
+	size_t tableSize = 1;
+	while (tableSize < maxBucketSize * 2)
+		tableSize *= 2;
+	std::vector<PmergeMe::VALUE_TYPE> table(tableSize);
+	for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+		std::fill(table.begin(), table.end(), EMPTY_SLOT);
+		for (size_t i = bucketEnds[bucket]; i < bucketEnds[bucket + 1]; i++) {
+			size_t slot = _hash(partitioned[i]) & (tableSize - 1);
+			while (table[slot] != EMPTY_SLOT) {
+				if (table[slot] == partitioned[i])
+					return true;
+				slot = (slot + 1) & (tableSize - 1);
+			}
+			table[slot] = partitioned[i];
+		}
+	}
+	return false;
 }
 
 PmergeMe::PmergeMe(
 	int argc,
 	const char **argv
-) : _container1(),
-		_container2()
+) : _width(PmergeMe::WIDTH_16),
+		_storage16(),
+		_storage32(),
+		_storage64(),
+		_threadCount(1),
+		_isAdaptive(false),
+		_isNetwork(false),
+		_isIndirect(false),
+		_topCount(0)
 {
-	errno = 0;
-	char *endptr;
+	std::vector<PmergeMe::VALUE_TYPE> values;
+	values.reserve(argc);
 	for (int i = 1; i < argc; i++) {
-		if (!isPositiveIntStr(argv[i]))
-			throw std::invalid_argument("invalid argument");
-		PmergeMe::VALUE_TYPE value = std::strtoull(argv[i], &endptr, 10);
-		if (errno == ERANGE) {
-			const char *msg = std::strerror(errno);
-			throw std::out_of_range(msg);
-		} else if (*endptr != '\0') {
-			throw std::invalid_argument("invalid argument");
-		}
-		this->_container1.push_back(value);
+		PmergeMe::VALUE_TYPE value;
+		PmergeMeReader::parseValue(argv[i], argv[i] + std::strlen(argv[i]), value);
+		values.push_back(value);
 	}
-	std::set<PmergeMe::VALUE_TYPE> uniqueCheck(this->_container1.begin(), this->_container1.end());
-	if (this->_container1.size() != uniqueCheck.size())
+	this->_initContainers(values);
+}
+
+PmergeMe::PmergeMe(
+	PmergeMeReader &reader,
+	const std::string &inputPath
+) : _width(PmergeMe::WIDTH_16),
+		_storage16(),
+		_storage32(),
+		_storage64(),
+		_threadCount(1),
+		_isAdaptive(false),
+		_isNetwork(false),
+		_isIndirect(false),
+		_topCount(0)
+{
+	std::vector<PmergeMe::VALUE_TYPE> values;
+	reader.readFile(inputPath, values);
+	if (values.empty())
+		throw std::invalid_argument("invalid argument (no values)");
+	this->_initContainers(values);
+}
+
+PmergeMe::PmergeMe(
+	const PmergeMe::CONTAINER_TYPE_3 &values
+) : _width(PmergeMe::WIDTH_16),
+		_storage16(),
+		_storage32(),
+		_storage64(),
+		_threadCount(1),
+		_isAdaptive(false),
+		_isNetwork(false),
+		_isIndirect(false),
+		_topCount(0)
+{
+	this->_initContainers(values);
+}
+
+// 読み込んだ値を検査し、最大値が収まる最小の幅のコンテナへコピーする
+void PmergeMe::_initContainers(
+	const std::vector<PmergeMe::VALUE_TYPE> &values
+)
+{
+	if (_hasDuplicate(values))
 		throw std::invalid_argument("invalid argument (not unique)");
-	this->_container2 = std::list<PmergeMe::VALUE_TYPE>(this->_container1.begin(), this->_container1.end());
+	PmergeMe::VALUE_TYPE maxValue = values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+	if (maxValue <= std::numeric_limits<unsigned short>::max())
+		this->_width = PmergeMe::WIDTH_16;
+	else if (maxValue <= std::numeric_limits<unsigned int>::max())
+		this->_width = PmergeMe::WIDTH_32;
+	else
+		this->_width = PmergeMe::WIDTH_64;
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			this->_storage16.assign(values);
+			break;
+		case PmergeMe::WIDTH_32:
+			this->_storage32.assign(values);
+			break;
+		case PmergeMe::WIDTH_64:
+			this->_storage64.assign(values);
+			break;
+	}
+}
+
+template <typename T>
+MergeInsertion<T> PmergeMe::_makeSorter(
+	size_t threadCount
+) const
+{
+	MergeInsertion<T> sorter;
+	sorter.setThreadCount(threadCount);
+	sorter.setAdaptive(this->_isAdaptive);
+	sorter.setNetwork(this->_isNetwork);
+	sorter.setIndirect(this->_isIndirect);
+	return sorter;
 }
 
 PmergeMe::PmergeMe(
 	const PmergeMe &src
-) : _container1(src._container1),
-		_container2(src._container2)
+) : _width(src._width),
+		_storage16(src._storage16),
+		_storage32(src._storage32),
+		_storage64(src._storage64),
+		_threadCount(src._threadCount),
+		_isAdaptive(src._isAdaptive),
+		_isNetwork(src._isNetwork),
+		_isIndirect(src._isIndirect),
+		_topCount(src._topCount)
 {
 }
 
@@ -99,396 +258,248 @@ PmergeMe &PmergeMe::operator=(
 	if (this == &src)
 		return *this;
 
-	this->_container1 = src._container1;
-	this->_container2 = src._container2;
+	this->_width = src._width;
+	this->_storage16 = src._storage16;
+	this->_storage32 = src._storage32;
+	this->_storage64 = src._storage64;
+	this->_threadCount = src._threadCount;
+	this->_isAdaptive = src._isAdaptive;
+	this->_isNetwork = src._isNetwork;
+	this->_isIndirect = src._isIndirect;
+	this->_topCount = src._topCount;
 
 	return *this;
 }
 
-const PmergeMe::CONTAINER_TYPE_1 PmergeMe::getContainer1(
-) const
-{
-	return this->_container1;
-}
-const PmergeMe::CONTAINER_TYPE_2 PmergeMe::getContainer2(
-) const
+// 値のコンテナは空にして、設定だけをコピーする
+void PmergeMe::_copySettings(
+	const PmergeMe &src
+)
 {
-	return this->_container2;
+	this->_width = src._width;
+	this->_storage16 = PmergeMeStorage<unsigned short>();
+	this->_storage32 = PmergeMeStorage<unsigned int>();
+	this->_storage64 = PmergeMeStorage<PmergeMe::VALUE_TYPE>();
+	this->_threadCount = src._threadCount;
+	this->_isAdaptive = src._isAdaptive;
+	this->_isNetwork = src._isNetwork;
+	this->_isIndirect = src._isIndirect;
+	this->_topCount = src._topCount;
 }
 
-static PmergeMe::CONTAINER_TYPE_2::iterator __it_add(
-	PmergeMe::CONTAINER_TYPE_2::iterator it,
-	size_t n
+void PmergeMe::copyContainer1(
+	const PmergeMe &src
 )
 {
-	for (size_t i = 0; i < n; i++) {
-		++it;
+	if (this == &src)
+		return;
+
+	this->_copySettings(src);
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			this->_storage16.copyContainer1(src._storage16);
+			break;
+		case PmergeMe::WIDTH_32:
+			this->_storage32.copyContainer1(src._storage32);
+			break;
+		case PmergeMe::WIDTH_64:
+			this->_storage64.copyContainer1(src._storage64);
+			break;
 	}
-	return it;
 }
 
-static PmergeMe::CONTAINER_TYPE_1::iterator _getInsertTo1(
-	PmergeMe::CONTAINER_TYPE_1::iterator rangeTopIt,
-	size_t rangeUnitCount,
-	size_t unitSize,
-	PmergeMe::VALUE_TYPE targetValue
+void PmergeMe::copyContainer2(
+	const PmergeMe &src
 )
 {
-#ifdef DEBUG
-	std::cout
-		<< std::endl
-		<< "_getInsertTo1(): "
-		<< "rangeUnitCount: "
-		<< rangeUnitCount
-		<< ", rangeTopItValue: "
-		<< *rangeTopIt
-		<< ", unitSize: "
-		<< unitSize
-		<< ", targetValue: "
-		<< targetValue
-		<< std::endl;
-#endif	// DEBUG
-	if (rangeUnitCount == 0)
-		return rangeTopIt;
-	PmergeMe::CONTAINER_TYPE_1::iterator rangeCenterUnitTopIt = rangeTopIt + (rangeUnitCount / 2) * unitSize;
-	PmergeMe::CONTAINER_TYPE_1::iterator rangeCenterUnitEndIt = rangeCenterUnitTopIt + unitSize;
-	PmergeMe::VALUE_TYPE rangeCenterUnitMaxValue = *(rangeCenterUnitEndIt - 1);
-#ifdef DEBUG
-	std::cout
-		<< "rangeEndIt(Value): "
-		<< *((rangeTopIt + rangeUnitCount * unitSize) - 1)
-		<< ", rangeCenterUnitTopIt: "
-		<< *rangeCenterUnitTopIt
-		<< ", rangeCenterUnitMaxValue: "
-		<< rangeCenterUnitMaxValue
-		<< std::endl;
-#endif	// DEBUG
-	if (rangeCenterUnitMaxValue < targetValue) {
-		// 前半分 + targetが除かれる
-		return _getInsertTo1(rangeCenterUnitEndIt, rangeUnitCount - (rangeUnitCount / 2) - 1, unitSize, targetValue);
-	} else {
-		return _getInsertTo1(rangeTopIt, rangeUnitCount / 2, unitSize, targetValue);
+	if (this == &src)
+		return;
+
+	this->_copySettings(src);
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			this->_storage16.copyContainer2(src._storage16);
+			break;
+		case PmergeMe::WIDTH_32:
+			this->_storage32.copyContainer2(src._storage32);
+			break;
+		case PmergeMe::WIDTH_64:
+			this->_storage64.copyContainer2(src._storage64);
+			break;
 	}
 }
 
-static PmergeMe::CONTAINER_TYPE_2::iterator _getInsertTo2(
-	PmergeMe::CONTAINER_TYPE_2::iterator rangeTopIt,
-	size_t rangeUnitCount,
-	size_t unitSize,
-	PmergeMe::VALUE_TYPE targetValue
+void PmergeMe::copyContainer3(
+	const PmergeMe &src
 )
 {
-#ifdef DEBUG
-	std::cout
-		<< std::endl
-		<< "_getInsertTo1(): "
-		<< "rangeUnitCount: "
-		<< rangeUnitCount
-		<< ", rangeTopItValue: "
-		<< *rangeTopIt
-		<< ", unitSize: "
-		<< unitSize
-		<< ", targetValue: "
-		<< targetValue
-		<< std::endl;
-#endif	// DEBUG
-	if (rangeUnitCount == 0)
-		return rangeTopIt;
-	PmergeMe::CONTAINER_TYPE_2::iterator rangeCenterUnitTopIt = __it_add(rangeTopIt, (rangeUnitCount / 2) * unitSize);
-	PmergeMe::CONTAINER_TYPE_2::iterator rangeCenterUnitEndIt = __it_add(rangeCenterUnitTopIt, unitSize);
-	PmergeMe::CONTAINER_TYPE_2::iterator tmpRangeCenterUnitMaxValIt = rangeCenterUnitEndIt;
-	PmergeMe::VALUE_TYPE rangeCenterUnitMaxValue = *(--tmpRangeCenterUnitMaxValIt);
-#ifdef DEBUG
-	PmergeMe::CONTAINER_TYPE_2::iterator rangeEndValIt = __it_add(rangeTopIt, rangeUnitCount * unitSize - 1);
-	std::cout
-		<< "rangeEndIt(Value): "
-		<< *rangeEndValIt
-		<< ", rangeCenterUnitTopIt: "
-		<< *rangeCenterUnitTopIt
-		<< ", rangeCenterUnitMaxValue: "
-		<< rangeCenterUnitMaxValue
-		<< std::endl;
-#endif	// DEBUG
-	if (rangeCenterUnitMaxValue < targetValue) {
-		if (rangeUnitCount == 1)
-			return rangeCenterUnitEndIt;
-		// 前半分 + targetが除かれる
-		return _getInsertTo2(rangeCenterUnitEndIt, rangeUnitCount - (rangeUnitCount / 2) - 1, unitSize, targetValue);
-	} else {
-		return _getInsertTo2(rangeTopIt, rangeUnitCount / 2, unitSize, targetValue);
+	if (this == &src)
+		return;
+
+	this->_copySettings(src);
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			this->_storage16.copyContainer3(src._storage16);
+			break;
+		case PmergeMe::WIDTH_32:
+			this->_storage32.copyContainer3(src._storage32);
+			break;
+		case PmergeMe::WIDTH_64:
+			this->_storage64.copyContainer3(src._storage64);
+			break;
 	}
 }
 
-static void _sort1(
-	PmergeMe::CONTAINER_TYPE_1 &arr,
-	const PmergeMe::CONTAINER_TYPE_1 &insertSpanCount,
-	size_t spanSize
-)
+PmergeMe::CONTAINER_TYPE_1 PmergeMe::getContainer1(
+) const
 {
-	if (arr.size() < spanSize)
-		return;
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			return PmergeMe::CONTAINER_TYPE_1(this->_storage16.getContainer1().begin(), this->_storage16.getContainer1().end());
+		case PmergeMe::WIDTH_32:
+			return PmergeMe::CONTAINER_TYPE_1(this->_storage32.getContainer1().begin(), this->_storage32.getContainer1().end());
+		default:
+			return this->_storage64.getContainer1();
+	}
+}
 
-	size_t spanSizeHalf = spanSize / 2;
-	for (
-		PmergeMe::CONTAINER_TYPE_1::iterator it = arr.begin();
-		spanSize <= static_cast<size_t>(std::distance(it, arr.end()));
-	) {
-		PmergeMe::CONTAINER_TYPE_1::iterator leftMaxIt = it + spanSizeHalf - 1;
-		PmergeMe::CONTAINER_TYPE_1::iterator rightMaxIt = leftMaxIt + spanSizeHalf;
-		if (*rightMaxIt < *leftMaxIt) {
-			it = std::swap_ranges(it, leftMaxIt + 1, leftMaxIt + 1);
-		} else {
-			it = rightMaxIt + 1;
-		}
+PmergeMe::CONTAINER_TYPE_2 PmergeMe::getContainer2(
+) const
+{
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			return PmergeMe::CONTAINER_TYPE_2(this->_storage16.getContainer2().begin(), this->_storage16.getContainer2().end());
+		case PmergeMe::WIDTH_32:
+			return PmergeMe::CONTAINER_TYPE_2(this->_storage32.getContainer2().begin(), this->_storage32.getContainer2().end());
+		default:
+			return this->_storage64.getContainer2();
 	}
+}
 
-#ifdef DEBUG
-	std::cout
-		<< "spanSize: "
-		<< spanSize
-		<< std::endl;
-	print_container("before recursive:", arr);
-#endif	// DEBUG
-
-	_sort1(arr, insertSpanCount, spanSize * 2);
-
-	size_t spanCount = arr.size() / spanSize;
-	bool isAdditionalSpanAvailable = spanSizeHalf <= (arr.size() % spanSize);
-	if (isAdditionalSpanAvailable)
-		++spanCount;
-	if (spanCount < 2)
-		return;
-#ifdef DEBUG
-	std::cout
-		<< "spanCount: "
-		<< spanCount
-		<< std::endl;
-	print_container("before erase:", arr);
-#endif	// DEBUG
-
-	std::deque<std::deque<PmergeMe::CONTAINER_TYPE_1> > spanSet;
-	PmergeMe::CONTAINER_TYPE_1::const_iterator insertSpanCountIt = insertSpanCount.begin();
-	for (
-		// 最初の2ユニット(1スパン)は必ずソート済みなのでunsortedには含めない
-		PmergeMe::CONTAINER_TYPE_1::iterator it = arr.begin() + spanSize;;
-	) {
-		size_t spanSetSize = spanSet.size();
-		if (spanSetSize == 0 || spanSet.back().size() == *insertSpanCountIt) {
-			spanSet.push_back(std::deque<PmergeMe::CONTAINER_TYPE_1>());
-			++insertSpanCountIt;
-		}
-		spanSet.back().push_back(std::deque<PmergeMe::VALUE_TYPE>(it, it + spanSizeHalf));
-		it = arr.erase(it, it + spanSizeHalf);
-		size_t distanceToEnd = static_cast<size_t>(std::distance(it, arr.end()));
-		if (distanceToEnd < spanSize) {
-			break;
-		}
-		it += spanSizeHalf;
+PmergeMe::CONTAINER_TYPE_3 PmergeMe::getContainer3(
+) const
+{
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			return PmergeMe::CONTAINER_TYPE_3(this->_storage16.getContainer3().begin(), this->_storage16.getContainer3().end());
+		case PmergeMe::WIDTH_32:
+			return PmergeMe::CONTAINER_TYPE_3(this->_storage32.getContainer3().begin(), this->_storage32.getContainer3().end());
+		default:
+			return this->_storage64.getContainer3();
 	}
+}
 
-	size_t lastSpanSetSize = 0;
-	size_t searchRangeUnitCount = 1;
-	while (spanSet.size() != 0) {
-		std::deque<PmergeMe::CONTAINER_TYPE_1> targetSpanSet = spanSet.front();
-		spanSet.pop_front();
-
-		size_t initialTargetSpanSetSize = targetSpanSet.size();
-		// 最初の2ユニット(1スパン)は必ずソート済みなので比較対象範囲
-		searchRangeUnitCount += lastSpanSetSize + initialTargetSpanSetSize;
-		lastSpanSetSize = initialTargetSpanSetSize;
-		while (targetSpanSet.size() != 0) {
-			PmergeMe::CONTAINER_TYPE_1 targetSpan = targetSpanSet.back();
-			targetSpanSet.pop_back();
-
-			// そのunitのMAX値
-			PmergeMe::VALUE_TYPE targetValue = targetSpan.back();
-#ifdef DEBUG
-			print_container("arr Before:", arr);
-			print_container("targetSpan:", targetSpan);
-			std::cout
-				<< "searchRangeUnitCount: "
-				<< searchRangeUnitCount
-				<< std::endl;
-			std::cout
-				<< "spanSizeHalf: "
-				<< spanSizeHalf
-				<< std::endl;
-			std::cout
-				<< "targetValue: "
-				<< targetValue
-				<< std::endl;
-#endif	// DEBUG
-			PmergeMe::CONTAINER_TYPE_1::iterator insertToIt = _getInsertTo1(arr.begin(), searchRangeUnitCount, spanSizeHalf, targetValue);
-#ifdef DEBUG
-			std::cout
-				<< "insertTo: "
-				<< *insertToIt;
-			if (insertToIt == arr.begin()) {
-				std::cout << " (begin)";
-			} else {
-				std::cout << " (after " << *(insertToIt - 1) << ")";
-			}
-			std::cout
-				<< std::endl;
-#endif	// DEBUG
-			arr.insert(insertToIt, targetSpan.begin(), targetSpan.end());
-#ifdef DEBUG
-			print_container("arr After :", arr);
-			std::cout << std::endl;
-#endif	// DEBUG
-		}
+size_t PmergeMe::getSize(
+) const
+{
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			return this->_storage16.getContainer3().size();
+		case PmergeMe::WIDTH_32:
+			return this->_storage32.getContainer3().size();
+		default:
+			return this->_storage64.getContainer3().size();
 	}
 }
 
-static void _sort2(
-	PmergeMe::CONTAINER_TYPE_2 &arr,
-	const PmergeMe::CONTAINER_TYPE_2 &insertSpanCount,
-	size_t spanSize
+PmergeMe::Width PmergeMe::getWidth(
+) const
+{
+	return this->_width;
+}
+
+size_t PmergeMe::getThreadCount(
+) const
+{
+	return this->_threadCount;
+}
+
+void PmergeMe::setThreadCount(
+	size_t threadCount
 )
 {
-	if (arr.size() < spanSize)
-		return;
+	this->_threadCount = threadCount == 0 ? 1 : threadCount;
+}
 
-	size_t spanSizeHalf = spanSize / 2;
-	for (
-		PmergeMe::CONTAINER_TYPE_2::iterator it = arr.begin();
-		spanSize <= static_cast<size_t>(std::distance(it, arr.end()));
-	) {
-		PmergeMe::CONTAINER_TYPE_2::iterator leftMaxIt = __it_add(it, spanSizeHalf - 1);
-		PmergeMe::CONTAINER_TYPE_2::iterator rightMaxIt = __it_add(leftMaxIt, spanSizeHalf);
-		if (*rightMaxIt < *leftMaxIt) {
-			PmergeMe::CONTAINER_TYPE_2::iterator rightMinIt = leftMaxIt;
-			++rightMinIt;
-			it = std::swap_ranges(it, rightMinIt, rightMinIt);
-		} else {
-			it = ++rightMaxIt;
-		}
-	}
+bool PmergeMe::isAdaptive(
+) const
+{
+	return this->_isAdaptive;
+}
 
-#ifdef DEBUG
-	std::cout
-		<< "spanSize: "
-		<< spanSize
-		<< std::endl;
-	print_container("before recursive:", arr);
-#endif	// DEBUG
-
-	_sort2(arr, insertSpanCount, spanSize * 2);
-
-	size_t spanCount = arr.size() / spanSize;
-	bool isAdditionalSpanAvailable = spanSizeHalf <= (arr.size() % spanSize);
-	if (isAdditionalSpanAvailable)
-		++spanCount;
-	if (spanCount < 2)
-		return;
-#ifdef DEBUG
-	std::cout
-		<< "spanCount: "
-		<< spanCount
-		<< std::endl;
-	print_container("before erase:", arr);
-#endif	// DEBUG
-
-	std::list<std::list<PmergeMe::CONTAINER_TYPE_2> > spanSet;
-	PmergeMe::CONTAINER_TYPE_2::const_iterator insertSpanCountIt = insertSpanCount.begin();
-	for (
-		// 最初の2ユニット(1スパン)は必ずソート済みなのでunsortedには含めない
-		PmergeMe::CONTAINER_TYPE_2::iterator it = __it_add(arr.begin(), spanSize);;
-	) {
-		size_t spanSetSize = spanSet.size();
-		if (spanSetSize == 0 || spanSet.back().size() == *insertSpanCountIt) {
-			spanSet.push_back(std::list<PmergeMe::CONTAINER_TYPE_2>());
-			++insertSpanCountIt;
-		}
-		PmergeMe::CONTAINER_TYPE_2::iterator moveEndIt = __it_add(it, spanSizeHalf);
-		PmergeMe::CONTAINER_TYPE_2 targetSpan;
-		targetSpan.splice(targetSpan.begin(), arr, it, moveEndIt);
-		spanSet.back().push_back(targetSpan);
-		it = moveEndIt;
-		size_t distanceToEnd = static_cast<size_t>(std::distance(it, arr.end()));
-		if (distanceToEnd < spanSize) {
-			break;
-		}
-		it = __it_add(it, spanSizeHalf);
-	}
+void PmergeMe::setAdaptive(
+	bool isAdaptive
+)
+{
+	this->_isAdaptive = isAdaptive;
+}
 
-	size_t lastSpanSetSize = 0;
-	size_t searchRangeUnitCount = 1;
-	while (spanSet.size() != 0) {
-		std::list<PmergeMe::CONTAINER_TYPE_2> targetSpanSet = spanSet.front();
-		spanSet.pop_front();
-
-		size_t initialTargetSpanSetSize = targetSpanSet.size();
-		// 最初の2ユニット(1スパン)は必ずソート済みなので比較対象範囲
-		searchRangeUnitCount += lastSpanSetSize + initialTargetSpanSetSize;
-		lastSpanSetSize = initialTargetSpanSetSize;
-		while (targetSpanSet.size() != 0) {
-			PmergeMe::CONTAINER_TYPE_2 targetSpan = targetSpanSet.back();
-			targetSpanSet.pop_back();
-
-			PmergeMe::VALUE_TYPE targetValue = targetSpan.back();
-#ifdef DEBUG
-			print_container("arr Before:", arr);
-			print_container("targetSpan:", targetSpan);
-			std::cout
-				<< "searchRangeUnitCount: "
-				<< searchRangeUnitCount
-				<< std::endl;
-			std::cout
-				<< "targetValue: "
-				<< targetValue
-				<< std::endl;
-#endif	// DEBUG
-			PmergeMe::CONTAINER_TYPE_2::iterator insertToIt = _getInsertTo2(arr.begin(), searchRangeUnitCount, spanSizeHalf, targetValue);
-#ifdef DEBUG
-			PmergeMe::CONTAINER_TYPE_2::iterator tmpInsertToItBack = insertToIt;
-			std::cout
-				<< "insertTo: "
-				<< *insertToIt;
-			if (insertToIt == arr.begin()) {
-				std::cout << " (begin)";
-			} else {
-				std::cout << " (after " << *(--tmpInsertToItBack) << ")";
-			}
-			std::cout
-				<< std::endl;
-#endif	// DEBUG
-			arr.splice(insertToIt, targetSpan);
-#ifdef DEBUG
-			print_container("arr After :", arr);
-			std::cout << std::endl;
-#endif	// DEBUG
-		}
-	}
+bool PmergeMe::isNetwork(
+) const
+{
+	return this->_isNetwork;
 }
 
-template <typename T>
-static T generate_insert_span_count(
-	size_t requiredCount
+void PmergeMe::setNetwork(
+	bool isNetwork
 )
 {
-	T container;
-	size_t lastValue = 1;
-	size_t sum = lastValue;
-	size_t n = 1;
-	container.push_back(lastValue);
-	while ((sum * 2) < requiredCount) {
-		size_t nextValue = 2 * lastValue + ((n++ & 1) == 0 ? 1 : -1);
-		container.push_back(nextValue);
-		lastValue = nextValue;
-		// オーバーフローは到底起こり得ないのでチェックは省略
-		sum += nextValue;
-	}
+	this->_isNetwork = isNetwork;
+}
+
+bool PmergeMe::isIndirect(
+) const
+{
+	return this->_isIndirect;
+}
+
+void PmergeMe::setIndirect(
+	bool isIndirect
+)
+{
+	this->_isIndirect = isIndirect;
+}
+
+size_t PmergeMe::getTopCount(
+) const
+{
+	return this->_topCount;
+}
+
+void PmergeMe::setTopCount(
+	size_t topCount
+)
+{
+	this->_topCount = topCount;
+}
 
-	for (
-		typename T::iterator it = container.begin();
-		it != container.end();
-		++it
-	) {
-		*it *= 2;
+size_t PmergeMe::getFordJohnsonWorstCase(
+	size_t n
+)
+{
+	// sum(k = 1..n) ceil(log2(3k / 4))
+	size_t sum = 0;
+	size_t bits = 0;
+	for (size_t k = 1; k <= n; k++) {
+		while ((static_cast<size_t>(4) << bits) < 3 * k)
+			++bits;
+		sum += bits;
 	}
+	return sum;
+}
 
-	return container;
+const char *PmergeMe::getWidthName(
+	Width width
+)
+{
+	switch (width) {
+		case PmergeMe::WIDTH_16:
+			return "16-bit";
+		case PmergeMe::WIDTH_32:
+			return "32-bit";
+		default:
+			return "64-bit";
+	}
 }
 
 void PmergeMe::sort1(
@@ -498,28 +509,17 @@ void PmergeMe::sort1(
 	std::cout << std::endl
 						<< "# sort1 ===" << std::endl;
 #endif	// DEBUG || VALIDATE
-	PmergeMe::CONTAINER_TYPE_1 insertSpanCount = generate_insert_span_count<PmergeMe::CONTAINER_TYPE_1>(this->_container1.size());
-	_sort1(this->_container1, insertSpanCount, 2);
-
-#if defined(DEBUG) || defined(VALIDATE)
-	PmergeMe::VALUE_TYPE lastValue = this->_container1.front();
-	for (
-		PmergeMe::CONTAINER_TYPE_1::const_iterator it = this->_container1.begin() + 1;
-		it != this->_container1.end();
-		++it
-	) {
-		if (lastValue > *it) {
-			std::cerr
-				<< "sort1 failed ("
-				<< lastValue
-				<< " > "
-				<< *it
-				<< ")"
-				<< std::endl;
-		}
-		lastValue = *it;
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			this->_storage16.sort1(this->_makeSorter<unsigned short>(1), this->_topCount);
+			break;
+		case PmergeMe::WIDTH_32:
+			this->_storage32.sort1(this->_makeSorter<unsigned int>(1), this->_topCount);
+			break;
+		case PmergeMe::WIDTH_64:
+			this->_storage64.sort1(this->_makeSorter<PmergeMe::VALUE_TYPE>(1), this->_topCount);
+			break;
 	}
-#endif	// DEBUG || VALIDATE
 }
 
 void PmergeMe::sort2(
@@ -529,27 +529,35 @@ void PmergeMe::sort2(
 	std::cout << std::endl
 						<< "# sort2 ===" << std::endl;
 #endif	// DEBUG || VALIDATE
-	PmergeMe::CONTAINER_TYPE_2 insertSpanCount = generate_insert_span_count<PmergeMe::CONTAINER_TYPE_2>(this->_container2.size());
-	_sort2(this->_container2, insertSpanCount, 2);
-#if defined(DEBUG) || defined(VALIDATE)
-	PmergeMe::VALUE_TYPE lastValue = this->_container2.front();
-	for (
-		PmergeMe::CONTAINER_TYPE_2::const_iterator it = this->_container2.begin();
-		it != this->_container2.end();
-		++it
-	) {
-		if (it == this->_container2.begin())
-			continue;
-		if (lastValue > *it) {
-			std::cerr
-				<< "sort2 failed ("
-				<< lastValue
-				<< " > "
-				<< *it
-				<< ")"
-				<< std::endl;
-		}
-		lastValue = *it;
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			this->_storage16.sort2(this->_makeSorter<unsigned short>(1), this->_topCount);
+			break;
+		case PmergeMe::WIDTH_32:
+			this->_storage32.sort2(this->_makeSorter<unsigned int>(1), this->_topCount);
+			break;
+		case PmergeMe::WIDTH_64:
+			this->_storage64.sort2(this->_makeSorter<PmergeMe::VALUE_TYPE>(1), this->_topCount);
+			break;
 	}
+}
+
+void PmergeMe::sort3(
+)
+{
+#if defined(DEBUG) || defined(VALIDATE)
+	std::cout << std::endl
+						<< "# sort3 ===" << std::endl;
 #endif	// DEBUG || VALIDATE
+	switch (this->_width) {
+		case PmergeMe::WIDTH_16:
+			this->_storage16.sort3(this->_makeSorter<unsigned short>(this->_threadCount), this->_topCount);
+			break;
+		case PmergeMe::WIDTH_32:
+			this->_storage32.sort3(this->_makeSorter<unsigned int>(this->_threadCount), this->_topCount);
+			break;
+		case PmergeMe::WIDTH_64:
+			this->_storage64.sort3(this->_makeSorter<PmergeMe::VALUE_TYPE>(this->_threadCount), this->_topCount);
+			break;
+	}
 }
@@ -2,13 +2,23 @@
 
 #include <time.h>
 
+#include <cstddef>
 #include <deque>
 #include <list>
+#include <string>
+#include <vector>
+
+#include "./MergeInsertion.hpp"
+#include "./PmergeMeStorage.hpp"
+
+class PmergeMeReader;
 
 #define __CONTAINER_TYPE_1 std::deque<PmergeMe::VALUE_TYPE>
 #define __CONTAINER_TYPE_2 std::list<PmergeMe::VALUE_TYPE>
+#define __CONTAINER_TYPE_3 std::vector<PmergeMe::VALUE_TYPE>
 #define __CONTAINER_TYPE_1_STR "std::deque"
 #define __CONTAINER_TYPE_2_STR "std::list "
+#define __CONTAINER_TYPE_3_STR "std::vector"
 
 class PmergeMe
 {
@@ -16,22 +26,81 @@ class PmergeMe
 	typedef unsigned long long VALUE_TYPE;
 	typedef __CONTAINER_TYPE_1 CONTAINER_TYPE_1;
 	typedef __CONTAINER_TYPE_2 CONTAINER_TYPE_2;
+	typedef __CONTAINER_TYPE_3 CONTAINER_TYPE_3;
+	// 値を持つ型の幅 (読み込んだ値の最大値で決める)
+	typedef enum Width {
+		WIDTH_16,
+		WIDTH_32,
+		WIDTH_64
+	} Width;
+#ifdef COUNT
+	typedef MergeInsertionStats Stats;
+#endif	// COUNT
 
  private:
 	static VALUE_TYPE MAX;
 	static VALUE_TYPE MIN;
-	PmergeMe::CONTAINER_TYPE_1 _container1;
-	PmergeMe::CONTAINER_TYPE_2 _container2;
+	Width _width;
+	// _width に合う1つだけに値を持つ (残りは空)
+	PmergeMeStorage<unsigned short> _storage16;
+	PmergeMeStorage<unsigned int> _storage32;
+	PmergeMeStorage<PmergeMe::VALUE_TYPE> _storage64;
+	// sort3 で使うスレッド数
+	size_t _threadCount;
+	// 整列済みの区間を検出して使うか (MergeInsertion::setAdaptive)
+	bool _isAdaptive;
+	// ブロックを sorting network で並べてからマージするか (MergeInsertion::setNetwork)
+	bool _isNetwork;
+	// (キー, 位置) の組を並べてから要素を移すか (MergeInsertion::setIndirect)
+	bool _isIndirect;
+	// 0 以外なら、小さい方から _topCount 個だけを並べる (MergeInsertion::partialSort)
+	size_t _topCount;
+
+	void _initContainers(const std::vector<PmergeMe::VALUE_TYPE> &values);
+	void _copySettings(const PmergeMe &src);
+	template <typename T>
+	MergeInsertion<T> _makeSorter(size_t threadCount) const;
 
  public:
 	PmergeMe();
 	PmergeMe(int argc, const char **argv);
+	PmergeMe(PmergeMeReader &reader, const std::string &inputPath);
+	explicit PmergeMe(const PmergeMe::CONTAINER_TYPE_3 &values);
 	PmergeMe(const PmergeMe &src);
 	virtual ~PmergeMe();
 	PmergeMe &operator=(const PmergeMe &src);
 
-	const PmergeMe::CONTAINER_TYPE_1 getContainer1() const;
-	const PmergeMe::CONTAINER_TYPE_2 getContainer2() const;
+	// src の設定と、sortN で並べる1つのコンテナだけをコピーする
+	// ほかのコンテナは空になる (getSize は copyContainer3 の場合のみ要素数を返す)
+	void copyContainer1(const PmergeMe &src);
+	void copyContainer2(const PmergeMe &src);
+	void copyContainer3(const PmergeMe &src);
+
+	// 値は VALUE_TYPE に戻したコピーを返す
+	PmergeMe::CONTAINER_TYPE_1 getContainer1() const;
+	PmergeMe::CONTAINER_TYPE_2 getContainer2() const;
+	PmergeMe::CONTAINER_TYPE_3 getContainer3() const;
+	size_t getSize() const;
+	Width getWidth() const;
+	size_t getThreadCount() const;
+	void setThreadCount(size_t threadCount);
+	bool isAdaptive() const;
+	void setAdaptive(bool isAdaptive);
+	bool isNetwork() const;
+	void setNetwork(bool isNetwork);
+	bool isIndirect() const;
+	void setIndirect(bool isIndirect);
+	size_t getTopCount() const;
+	void setTopCount(size_t topCount);
 	void sort1();
 	void sort2();
+	void sort3();
+
+	// n 要素を Ford-Johnson で並べる際の比較回数の最悪値
+	static size_t getFordJohnsonWorstCase(size_t n);
+	static const char *getWidthName(Width width);
+#ifdef COUNT
+	static const Stats &getStats();
+	static void resetStats();
+#endif	// COUNT
 };
@@ -0,0 +1,252 @@
+#include "./PmergeMeConcurrentSort.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+
+// 全スレッドが入力のコピーを終えるまで待たせ、揃ってから一斉に並べ始める
+typedef struct StartGate {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	std::size_t readyCount;
+	bool isOpen;
+	// スレッドを起動できなかった場合は、並べずに終わらせる
+	bool isAborted;
+} StartGate;
+
+typedef struct ThreadArg {
+	PmergeMeConcurrentSort::Run *run;
+	const PmergeMe *input;
+	StartGate *gate;
+	struct timespec end;
+} ThreadArg;
+
+static struct timespec _now(
+	clockid_t clockId
+)
+{
+	struct timespec time;
+	if (clock_gettime(clockId, &time) != 0)
+		throw std::runtime_error(std::strerror(errno));
+	return time;
+}
+
+static struct timespec _sub(
+	const struct timespec &start,
+	const struct timespec &end
+)
+{
+	struct timespec result;
+	result.tv_sec = end.tv_sec - start.tv_sec;
+	result.tv_nsec = end.tv_nsec - start.tv_nsec;
+	if (result.tv_nsec < 0) {
+		--result.tv_sec;
+		result.tv_nsec += 1000 * 1000 * 1000;
+	}
+	return result;
+}
+
+static bool _isBefore(
+	const struct timespec &left,
+	const struct timespec &right
+)
+{
+	return left.tv_sec != right.tv_sec ? left.tv_sec < right.tv_sec : left.tv_nsec < right.tv_nsec;
+}
+
+// 許可されている CPU を順に並べる
+static std::vector<int> _getAllowedCpus(
+)
+{
+	std::vector<int> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) != 0)
+		return cpus;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &set))
+			cpus.push_back(cpu);
+	}
+	return cpus;
+}
+
+static bool _pin(
+	int cpu
+)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+static void *_runThread(
+	void *p
+)
+{
+	ThreadArg &arg = *static_cast<ThreadArg *>(p);
+	PmergeMeConcurrentSort::Run &run = *arg.run;
+	try {
+		if (run.cpu != -1 && !_pin(run.cpu))
+			run.cpu = -1;
+		// 固定した CPU 上で並べるコンテナだけをコピーして、ページを確保しておく
+		(run.result.*run.copyMethod)(*arg.input);
+	} catch (const std::exception &e) {
+		run.error = e.what();
+	}
+	StartGate &gate = *arg.gate;
+	pthread_mutex_lock(&gate.mutex);
+	++gate.readyCount;
+	pthread_cond_broadcast(&gate.cond);
+	while (!gate.isOpen)
+		pthread_cond_wait(&gate.cond, &gate.mutex);
+	bool isAborted = gate.isAborted;
+	pthread_mutex_unlock(&gate.mutex);
+	if (isAborted || !run.error.empty())
+		return NULL;
+
+	try {
+		struct rusage usageStart, usageEnd;
+		getrusage(RUSAGE_THREAD, &usageStart);
+		struct timespec wallStart = _now(CLOCK_MONOTONIC);
+		struct timespec cpuStart = _now(CLOCK_THREAD_CPUTIME_ID);
+		(run.result.*run.sortMethod)();
+		struct timespec cpuEnd = _now(CLOCK_THREAD_CPUTIME_ID);
+		arg.end = _now(CLOCK_MONOTONIC);
+		getrusage(RUSAGE_THREAD, &usageEnd);
+		run.cpuTime = _sub(cpuStart, cpuEnd);
+		run.wallTime = _sub(wallStart, arg.end);
+		run.voluntarySwitches = usageEnd.ru_nvcsw - usageStart.ru_nvcsw;
+		run.involuntarySwitches = usageEnd.ru_nivcsw - usageStart.ru_nivcsw;
+	} catch (const std::exception &e) {
+		run.error = e.what();
+	}
+	return NULL;
+}
+
+PmergeMeConcurrentSort::PmergeMeConcurrentSort(
+	const PmergeMe &input
+) : _input(&input),
+		_runs(),
+		_wallTime()
+{
+}
+
+PmergeMeConcurrentSort::PmergeMeConcurrentSort(
+	const PmergeMeConcurrentSort &src
+) : _input(src._input),
+		_runs(src._runs),
+		_wallTime(src._wallTime)
+{
+}
+
+PmergeMeConcurrentSort::~PmergeMeConcurrentSort(
+)
+{
+}
+
+PmergeMeConcurrentSort &PmergeMeConcurrentSort::operator=(
+	const PmergeMeConcurrentSort &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_input = src._input;
+	this->_runs = src._runs;
+	this->_wallTime = src._wallTime;
+
+	return *this;
+}
+
+void PmergeMeConcurrentSort::add(
+	CopyMethod copyMethod,
+	SortMethod sortMethod
+)
+{
+	Run run;
+	run.copyMethod = copyMethod;
+	run.sortMethod = sortMethod;
+	run.cpu = -1;
+	run.cpuTime.tv_sec = 0;
+	run.cpuTime.tv_nsec = 0;
+	run.wallTime = run.cpuTime;
+	run.voluntarySwitches = 0;
+	run.involuntarySwitches = 0;
+	this->_runs.push_back(run);
+}
+
+void PmergeMeConcurrentSort::run(
+)
+{
+	// CPU が足りない場合は、同じ CPU を複数のスレッドで使う
+	std::vector<int> cpus = _getAllowedCpus();
+	for (std::size_t i = 0; i < this->_runs.size(); i++) {
+		this->_runs[i].cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+		this->_runs[i].error.clear();
+	}
+
+	std::vector<ThreadArg> args(this->_runs.size());
+	std::vector<pthread_t> threads(this->_runs.size());
+	StartGate gate;
+	pthread_mutex_init(&gate.mutex, NULL);
+	pthread_cond_init(&gate.cond, NULL);
+	gate.readyCount = 0;
+	gate.isOpen = false;
+	gate.isAborted = false;
+	std::size_t startedCount = 0;
+	for (; startedCount < this->_runs.size(); startedCount++) {
+		ThreadArg &arg = args[startedCount];
+		arg.run = &this->_runs[startedCount];
+		arg.input = this->_input;
+		arg.gate = &gate;
+		arg.end.tv_sec = 0;
+		arg.end.tv_nsec = 0;
+		if (pthread_create(&threads[startedCount], NULL, _runThread, &arg) != 0)
+			break;
+	}
+
+	// 起動したスレッドが揃ったら (起動できなかったものがあれば中止にして) 一斉に始めさせる
+	pthread_mutex_lock(&gate.mutex);
+	while (gate.readyCount < startedCount)
+		pthread_cond_wait(&gate.cond, &gate.mutex);
+	gate.isAborted = startedCount != this->_runs.size();
+	gate.isOpen = true;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_cond_broadcast(&gate.cond);
+	pthread_mutex_unlock(&gate.mutex);
+	for (std::size_t i = 0; i < startedCount; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	pthread_cond_destroy(&gate.cond);
+	pthread_mutex_destroy(&gate.mutex);
+	if (gate.isAborted)
+		throw std::runtime_error("Failed to create a thread");
+
+	struct timespec end = start;
+	for (std::size_t i = 0; i < this->_runs.size(); i++) {
+		if (!this->_runs[i].error.empty())
+			throw std::runtime_error(this->_runs[i].error);
+		if (_isBefore(end, args[i].end))
+			end = args[i].end;
+	}
+	this->_wallTime = _sub(start, end);
+}
+
+const std::vector<PmergeMeConcurrentSort::Run> &PmergeMeConcurrentSort::getRuns(
+) const
+{
+	return this->_runs;
+}
+
+const struct timespec &PmergeMeConcurrentSort::getWallTime(
+) const
+{
+	return this->_wallTime;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <time.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "./PmergeMe.hpp"
+
+// 複数のバックエンド (sort1, sort2, sort3) を、それぞれ別の CPU に固定したスレッドで同時に並べる
+// 入力は各スレッドが、自分の並べるコンテナだけをコピーする (ページをそのスレッドで確保・書き込みしてから測る) ので、
+// 互いのキャッシュやページフォールトの影響を受けにくく、順に測るより早く結果が揃う
+class PmergeMeConcurrentSort
+{
+ public:
+	typedef void (PmergeMe::*CopyMethod)(const PmergeMe &src);
+	typedef void (PmergeMe::*SortMethod)();
+
+	typedef struct Run {
+		// sortMethod が並べるコンテナだけを、入力からコピーする
+		CopyMethod copyMethod;
+		SortMethod sortMethod;
+		// 固定した CPU (固定できなかった場合は -1)
+		int cpu;
+		// スレッドの CPU 時間 (CLOCK_THREAD_CPUTIME_ID) と経過時間 (CLOCK_MONOTONIC)
+		struct timespec cpuTime;
+		struct timespec wallTime;
+		// 並べている間のコンテキストスイッチの回数 (getrusage(RUSAGE_THREAD))
+		long voluntarySwitches;
+		long involuntarySwitches;
+		// 並べた結果 (copyMethod でコピーしたコンテナ以外は空)
+		PmergeMe result;
+		// スレッド内で起きた例外のメッセージ (空なら成功)
+		std::string error;
+	} Run;
+
+ private:
+	const PmergeMe *_input;
+	std::vector<Run> _runs;
+	// 全スレッドが揃って始めてから、最後のスレッドが終わるまで
+	struct timespec _wallTime;
+
+	PmergeMeConcurrentSort();
+
+ public:
+	explicit PmergeMeConcurrentSort(const PmergeMe &input);
+	PmergeMeConcurrentSort(const PmergeMeConcurrentSort &src);
+	virtual ~PmergeMeConcurrentSort();
+	PmergeMeConcurrentSort &operator=(const PmergeMeConcurrentSort &src);
+
+	void add(CopyMethod copyMethod, SortMethod sortMethod);
+	// 追加したバックエンドをすべて同時に並べる (どれかが失敗した場合は runtime_error)
+	void run();
+
+	const std::vector<Run> &getRuns() const;
+	const struct timespec &getWallTime() const;
+};
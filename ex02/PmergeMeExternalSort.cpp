@@ -0,0 +1,590 @@
+#include "./PmergeMeExternalSort.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "./LoserTree.hpp"
+#include "./MergeInsertion.hpp"
+
+const std::size_t PmergeMeExternalSort::SORT_BYTES_PER_VALUE = 40;
+const std::size_t PmergeMeExternalSort::INDIRECT_SORT_BYTES_PER_VALUE = 72;
+const std::size_t PmergeMeExternalSort::WRITE_BUFFER_SIZE = 1 << 20;
+const std::size_t PmergeMeExternalSort::MIN_MERGE_BUFFER_SIZE = 1 << 16;
+const std::size_t PmergeMeExternalSort::MIN_MEMORY_LIMIT = 1 << 22;
+
+static const std::size_t VALUE_SIZE = sizeof(PmergeMe::VALUE_TYPE);
+// 10進数で書いた値 + 区切りの最大長
+static const std::size_t MAX_TEXT_LENGTH = 21;
+
+static double _now(
+)
+{
+	struct timespec time;
+	if (clock_gettime(CLOCK_MONOTONIC, &time) != 0)
+		throw std::runtime_error(std::strerror(errno));
+	return time.tv_sec + time.tv_nsec / (1000.0 * 1000 * 1000);
+}
+
+static void _writeAll(
+	int fd,
+	const char *data,
+	std::size_t length
+)
+{
+	while (length != 0) {
+		ssize_t ret = write(fd, data, length);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			throw std::runtime_error(std::strerror(errno));
+		}
+		data += ret;
+		length -= static_cast<std::size_t>(ret);
+	}
+}
+
+// offset から length バイトを読む (EOF で途切れた場合は読めた分だけ)
+static std::size_t _preadAll(
+	int fd,
+	char *data,
+	std::size_t length,
+	off_t offset
+)
+{
+	std::size_t total = 0;
+	while (total < length) {
+		ssize_t ret = pread(fd, data + total, length - total, offset + static_cast<off_t>(total));
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			throw std::runtime_error(std::strerror(errno));
+		}
+		if (ret == 0)
+			break;
+		total += static_cast<std::size_t>(ret);
+	}
+	return total;
+}
+
+// スコープを抜けるときに閉じるファイルディスクリプタ (標準入出力は閉じない)
+class ScopedFd
+{
+ private:
+	int _fd;
+
+	ScopedFd(const ScopedFd &src);
+	ScopedFd &operator=(const ScopedFd &src);
+
+ public:
+	explicit ScopedFd(int fd) : _fd(fd) {}
+	virtual ~ScopedFd()
+	{
+		if (STDERR_FILENO < this->_fd)
+			close(this->_fd);
+	}
+
+	int get() const { return this->_fd; }
+	// 閉じずに手放す
+	int release()
+	{
+		int fd = this->_fd;
+		this->_fd = -1;
+		return fd;
+	}
+	// 持っている fd を閉じて fd に差し替える
+	void reset(int fd)
+	{
+		if (STDERR_FILENO < this->_fd)
+			close(this->_fd);
+		this->_fd = fd;
+	}
+};
+
+// 値をバッファに貯め、まとめて書き出す
+class BufferedWriter
+{
+ private:
+	int _fd;
+	PmergeMeReader::Format _format;
+	std::vector<char> _buffer;
+	std::size_t _length;
+	std::size_t _writtenBytes;
+
+	BufferedWriter(const BufferedWriter &src);
+	BufferedWriter &operator=(const BufferedWriter &src);
+
+ public:
+	BufferedWriter(int fd, PmergeMeReader::Format format, std::size_t bufferSize)
+		: _fd(fd), _format(format), _buffer(std::max(bufferSize, MAX_TEXT_LENGTH)), _length(0), _writtenBytes(0) {}
+	virtual ~BufferedWriter() {}
+
+	void write(PmergeMe::VALUE_TYPE value)
+	{
+		if (this->_buffer.size() - this->_length < MAX_TEXT_LENGTH)
+			this->flush();
+		char *out = &this->_buffer[this->_length];
+		if (this->_format == PmergeMeReader::FORMAT_BINARY) {
+			for (std::size_t byte = 0; byte < VALUE_SIZE; byte++) {
+				out[byte] = static_cast<char>(value >> (byte * 8));
+			}
+			this->_length += VALUE_SIZE;
+			return;
+		}
+		char digits[MAX_TEXT_LENGTH];
+		std::size_t digitCount = 0;
+		do {
+			digits[digitCount++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+		for (std::size_t i = 0; i < digitCount; i++) {
+			out[i] = digits[digitCount - 1 - i];
+		}
+		out[digitCount] = '\n';
+		this->_length += digitCount + 1;
+	}
+
+	void flush()
+	{
+		_writeAll(this->_fd, &this->_buffer[0], this->_length);
+		this->_writtenBytes += this->_length;
+		this->_length = 0;
+	}
+
+	std::size_t getWrittenBytes() const { return this->_writtenBytes; }
+};
+
+// 一時ファイル上の1本の列を、バッファ単位で先頭から読む
+class RunCursor
+{
+ private:
+	int _fd;
+	off_t _offset;
+	// まだバッファに読み込んでいないバイト数
+	std::size_t _remainingBytes;
+	std::vector<char> _buffer;
+	std::size_t _position;
+	std::size_t _length;
+	std::size_t _readBytes;
+
+ public:
+	RunCursor() : _fd(-1), _offset(0), _remainingBytes(0), _buffer(), _position(0), _length(0), _readBytes(0) {}
+	virtual ~RunCursor() {}
+
+	void open(int fd, off_t offset, std::size_t count, std::size_t bufferSize)
+	{
+		this->_fd = fd;
+		this->_offset = offset;
+		this->_remainingBytes = count * VALUE_SIZE;
+		this->_buffer.resize(std::min(bufferSize, this->_remainingBytes));
+		this->_position = 0;
+		this->_length = 0;
+	}
+
+	bool next(PmergeMe::VALUE_TYPE &value)
+	{
+		if (this->_position == this->_length) {
+			if (this->_remainingBytes == 0)
+				return false;
+			std::size_t length = std::min(this->_buffer.size(), this->_remainingBytes);
+			if (_preadAll(this->_fd, &this->_buffer[0], length, this->_offset) != length)
+				throw std::runtime_error("Failed to read temporary file (unexpected end of file)");
+			this->_offset += static_cast<off_t>(length);
+			this->_remainingBytes -= length;
+			this->_readBytes += length;
+			this->_position = 0;
+			this->_length = length;
+		}
+		const unsigned char *p = reinterpret_cast<const unsigned char *>(&this->_buffer[this->_position]);
+		value = 0;
+		for (std::size_t byte = VALUE_SIZE; byte-- != 0;) {
+			value = (value << 8) | p[byte];
+		}
+		this->_position += VALUE_SIZE;
+		return true;
+	}
+
+	std::size_t getReadBytes() const { return this->_readBytes; }
+};
+
+// マージでの比較 (COUNT 時は MergeInsertion と同じ計測値に数える)
+struct ValueLess {
+	bool operator()(PmergeMe::VALUE_TYPE left, PmergeMe::VALUE_TYPE right) const
+	{
+#ifdef COUNT
+		++getMergeInsertionStats().comparisons;
+#endif	// COUNT
+		return left < right;
+	}
+};
+
+// 出力する値が1つ前と同じなら重複として扱う (整列済みなので隣だけ見ればよい)
+static void _checkUnique(
+	PmergeMe::VALUE_TYPE value,
+	PmergeMe::VALUE_TYPE &lastValue,
+	bool &isFirst
+)
+{
+	if (!isFirst && value == lastValue)
+		throw std::invalid_argument("invalid argument (not unique)");
+	lastValue = value;
+	isFirst = false;
+}
+
+PmergeMeExternalSort::PmergeMeExternalSort(
+) : _memoryLimit(MIN_MEMORY_LIMIT),
+		_tempDirectory(),
+		_threadCount(1),
+		_isAdaptive(false),
+		_isNetwork(false),
+		_isIndirect(false),
+		_valueCount(0),
+		_phases()
+{
+	const char *tempDirectory = std::getenv("TMPDIR");
+	this->_tempDirectory = tempDirectory != NULL && *tempDirectory != '\0' ? tempDirectory : "/tmp";
+}
+
+PmergeMeExternalSort::PmergeMeExternalSort(
+	std::size_t memoryLimit
+) : _memoryLimit(std::max(memoryLimit, MIN_MEMORY_LIMIT)),
+		_tempDirectory(),
+		_threadCount(1),
+		_isAdaptive(false),
+		_isNetwork(false),
+		_isIndirect(false),
+		_valueCount(0),
+		_phases()
+{
+	const char *tempDirectory = std::getenv("TMPDIR");
+	this->_tempDirectory = tempDirectory != NULL && *tempDirectory != '\0' ? tempDirectory : "/tmp";
+}
+
+PmergeMeExternalSort::PmergeMeExternalSort(
+	const PmergeMeExternalSort &src
+) : _memoryLimit(src._memoryLimit),
+		_tempDirectory(src._tempDirectory),
+		_threadCount(src._threadCount),
+		_isAdaptive(src._isAdaptive),
+		_isNetwork(src._isNetwork),
+		_isIndirect(src._isIndirect),
+		_valueCount(src._valueCount),
+		_phases(src._phases)
+{
+}
+
+PmergeMeExternalSort::~PmergeMeExternalSort(
+)
+{
+}
+
+PmergeMeExternalSort &PmergeMeExternalSort::operator=(
+	const PmergeMeExternalSort &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_memoryLimit = src._memoryLimit;
+	this->_tempDirectory = src._tempDirectory;
+	this->_threadCount = src._threadCount;
+	this->_isAdaptive = src._isAdaptive;
+	this->_isNetwork = src._isNetwork;
+	this->_isIndirect = src._isIndirect;
+	this->_valueCount = src._valueCount;
+	this->_phases = src._phases;
+
+	return *this;
+}
+
+std::size_t PmergeMeExternalSort::getMemoryLimit(
+) const
+{
+	return this->_memoryLimit;
+}
+
+void PmergeMeExternalSort::setMemoryLimit(
+	std::size_t memoryLimit
+)
+{
+	this->_memoryLimit = std::max(memoryLimit, MIN_MEMORY_LIMIT);
+}
+
+const std::string &PmergeMeExternalSort::getTempDirectory(
+) const
+{
+	return this->_tempDirectory;
+}
+
+void PmergeMeExternalSort::setTempDirectory(
+	const std::string &tempDirectory
+)
+{
+	this->_tempDirectory = tempDirectory;
+}
+
+void PmergeMeExternalSort::setThreadCount(
+	std::size_t threadCount
+)
+{
+	this->_threadCount = threadCount == 0 ? 1 : threadCount;
+}
+
+void PmergeMeExternalSort::setAdaptive(
+	bool isAdaptive
+)
+{
+	this->_isAdaptive = isAdaptive;
+}
+
+void PmergeMeExternalSort::setNetwork(
+	bool isNetwork
+)
+{
+	this->_isNetwork = isNetwork;
+}
+
+void PmergeMeExternalSort::setIndirect(
+	bool isIndirect
+)
+{
+	this->_isIndirect = isIndirect;
+}
+
+std::size_t PmergeMeExternalSort::getValueCount(
+) const
+{
+	return this->_valueCount;
+}
+
+const std::vector<PmergeMeExternalSort::Phase> &PmergeMeExternalSort::getPhases(
+) const
+{
+	return this->_phases;
+}
+
+// 一時ファイルは作成してすぐに削除し、閉じた時点で (異常終了時も) 消えるようにする
+int PmergeMeExternalSort::_createTempFile(
+) const
+{
+	std::string path = this->_tempDirectory + "/PmergeMe.XXXXXX";
+	std::vector<char> pathTemplate(path.begin(), path.end());
+	pathTemplate.push_back('\0');
+	int fd = mkstemp(&pathTemplate[0]);
+	if (fd < 0) {
+		const char *msg = std::strerror(errno);
+		throw std::runtime_error("Failed to create temporary file in " + this->_tempDirectory + ": " + msg);
+	}
+	unlink(&pathTemplate[0]);
+	return fd;
+}
+
+// メモリ上限に収まる分ずつ読み込んで並べ、列として runFd へ書き出す
+// 1回で読み切れた場合は一時ファイルを使わず、そのまま outputFd へ書き出す (runs は空のまま)
+void PmergeMeExternalSort::_generateRuns(
+	PmergeMeReader &reader,
+	int inputFd,
+	int outputFd,
+	int runFd,
+	std::vector<Run> &runs
+)
+{
+	Phase phase;
+	phase.name = "run generation";
+	phase.readBytes = 0;
+	phase.writtenBytes = 0;
+	phase.runCount = 0;
+	double start = _now();
+	std::size_t readBytes = reader.getReadBytes();
+
+	std::size_t reservedBytes = PmergeMeReader::BUFFER_SIZE + WRITE_BUFFER_SIZE;
+	std::size_t bytesPerValue = this->_isIndirect ? INDIRECT_SORT_BYTES_PER_VALUE : SORT_BYTES_PER_VALUE;
+	std::size_t capacity = this->_memoryLimit <= reservedBytes
+		? 1
+		: std::max<std::size_t>(1, (this->_memoryLimit - reservedBytes) / bytesPerValue);
+	std::vector<PmergeMe::VALUE_TYPE> values;
+	values.reserve(capacity);
+	MergeInsertion<PmergeMe::VALUE_TYPE> sorter;
+	sorter.setThreadCount(this->_threadCount);
+	sorter.setAdaptive(this->_isAdaptive);
+	sorter.setNetwork(this->_isNetwork);
+	sorter.setIndirect(this->_isIndirect);
+	BufferedWriter runWriter(runFd, PmergeMeReader::FORMAT_BINARY, WRITE_BUFFER_SIZE);
+	off_t offset = 0;
+	bool isRemaining = true;
+	while (isRemaining) {
+		values.clear();
+		isRemaining = reader.readChunk(inputFd, values, capacity);
+		if (values.empty())
+			break;
+		sorter.sort(values);
+		this->_valueCount += values.size();
+
+		if (runs.empty() && !isRemaining) {
+			phase.name = "in-memory sort";
+			BufferedWriter writer(outputFd, reader.getFormat(), WRITE_BUFFER_SIZE);
+			PmergeMe::VALUE_TYPE lastValue = 0;
+			bool isFirst = true;
+			for (std::size_t i = 0; i < values.size(); i++) {
+				_checkUnique(values[i], lastValue, isFirst);
+				writer.write(values[i]);
+			}
+			writer.flush();
+			phase.writtenBytes += writer.getWrittenBytes();
+			phase.runCount = 1;
+			break;
+		}
+
+		for (std::size_t i = 0; i < values.size(); i++) {
+			runWriter.write(values[i]);
+		}
+		Run run;
+		run.offset = offset;
+		run.count = values.size();
+		runs.push_back(run);
+		offset += static_cast<off_t>(values.size() * VALUE_SIZE);
+	}
+	runWriter.flush();
+
+	phase.readBytes = reader.getReadBytes() - readBytes;
+	phase.writtenBytes += runWriter.getWrittenBytes();
+	if (!runs.empty())
+		phase.runCount = runs.size();
+	phase.seconds = _now() - start;
+	this->_phases.push_back(phase);
+}
+
+// 1回のマージでまとめる列の数 (列ごとの読み込みバッファが MIN_MERGE_BUFFER_SIZE を下回らない数)
+std::size_t PmergeMeExternalSort::_getMergeFanIn(
+) const
+{
+	std::size_t bufferBytes = this->_memoryLimit - WRITE_BUFFER_SIZE;
+	return std::max<std::size_t>(2, bufferBytes / MIN_MERGE_BUFFER_SIZE);
+}
+
+// runFd 上の runs を敗者木でマージし、outputFd の現在位置へ書き出す
+void PmergeMeExternalSort::_mergeRuns(
+	int runFd,
+	const std::vector<Run> &runs,
+	int outputFd,
+	PmergeMeReader::Format format,
+	bool isFinal,
+	Phase &phase
+)
+{
+	std::size_t bufferSize = (this->_memoryLimit - WRITE_BUFFER_SIZE) / runs.size();
+	bufferSize = std::max(bufferSize - bufferSize % VALUE_SIZE, VALUE_SIZE);
+
+	std::vector<RunCursor> cursors(runs.size());
+	LoserTree<PmergeMe::VALUE_TYPE, ValueLess> tree(runs.size());
+	for (std::size_t i = 0; i < runs.size(); i++) {
+		cursors[i].open(runFd, runs[i].offset, runs[i].count, bufferSize);
+		PmergeMe::VALUE_TYPE value;
+		if (cursors[i].next(value))
+			tree.set(i, value);
+		else
+			tree.setExhausted(i);
+	}
+	tree.build();
+
+	BufferedWriter writer(outputFd, format, WRITE_BUFFER_SIZE);
+	PmergeMe::VALUE_TYPE lastValue = 0;
+	bool isFirst = true;
+	while (!tree.empty()) {
+		PmergeMe::VALUE_TYPE value = tree.topKey();
+		if (isFinal)
+			_checkUnique(value, lastValue, isFirst);
+		writer.write(value);
+		if (cursors[tree.top()].next(value))
+			tree.replaceTop(value);
+		else
+			tree.popTop();
+	}
+	writer.flush();
+
+	for (std::size_t i = 0; i < cursors.size(); i++) {
+		phase.readBytes += cursors[i].getReadBytes();
+	}
+	phase.writtenBytes += writer.getWrittenBytes();
+	++phase.runCount;
+}
+
+void PmergeMeExternalSort::sort(
+	PmergeMeReader &reader,
+	const std::string &inputPath,
+	const std::string &outputPath
+)
+{
+	this->_valueCount = 0;
+	this->_phases.clear();
+
+	ScopedFd inputFd(inputPath == "-" ? STDIN_FILENO : open(inputPath.c_str(), O_RDONLY));
+	if (inputFd.get() < 0)
+		throw std::runtime_error("Failed to open file: " + inputPath);
+	// O_TRUNC で入力を消してしまわないよう、同じファイルへの出力は受け付けない
+	struct stat inputStat, outputStat;
+	if (outputPath != "-" && fstat(inputFd.get(), &inputStat) == 0 && stat(outputPath.c_str(), &outputStat) == 0
+		&& inputStat.st_dev == outputStat.st_dev && inputStat.st_ino == outputStat.st_ino)
+		throw std::invalid_argument("invalid argument (output is the input file)");
+	ScopedFd outputFd(outputPath == "-" ? STDOUT_FILENO : open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+	if (outputFd.get() < 0)
+		throw std::runtime_error("Failed to open file: " + outputPath);
+	ScopedFd runFd(this->_createTempFile());
+
+	std::vector<Run> runs;
+	this->_generateRuns(reader, inputFd.get(), outputFd.get(), runFd.get(), runs);
+	if (this->_valueCount == 0)
+		throw std::invalid_argument("invalid argument (no values)");
+
+	// 列が多すぎる場合は fanIn 本ずつマージした列を別の一時ファイルへ書き、本数を減らす
+	std::size_t fanIn = this->_getMergeFanIn();
+	for (std::size_t pass = 1; fanIn < runs.size(); pass++) {
+		Phase phase;
+		std::ostringstream name;
+		name << "merge pass " << pass;
+		phase.name = name.str();
+		phase.readBytes = 0;
+		phase.writtenBytes = 0;
+		phase.runCount = 0;
+		double start = _now();
+		ScopedFd nextFd(this->_createTempFile());
+		std::vector<Run> nextRuns;
+		off_t offset = 0;
+		for (std::size_t i = 0; i < runs.size(); i += fanIn) {
+			std::vector<Run> group(runs.begin() + i, runs.begin() + std::min(i + fanIn, runs.size()));
+			this->_mergeRuns(runFd.get(), group, nextFd.get(), PmergeMeReader::FORMAT_BINARY, false, phase);
+			Run run;
+			run.offset = offset;
+			run.count = 0;
+			for (std::size_t j = 0; j < group.size(); j++) {
+				run.count += group[j].count;
+			}
+			nextRuns.push_back(run);
+			offset += static_cast<off_t>(run.count * VALUE_SIZE);
+		}
+		runFd.reset(nextFd.release());
+		runs.swap(nextRuns);
+		phase.seconds = _now() - start;
+		this->_phases.push_back(phase);
+	}
+
+	if (runs.empty())
+		return;
+	Phase phase;
+	phase.name = "final merge";
+	phase.readBytes = 0;
+	phase.writtenBytes = 0;
+	phase.runCount = 0;
+	double start = _now();
+	this->_mergeRuns(runFd.get(), runs, outputFd.get(), reader.getFormat(), true, phase);
+	phase.seconds = _now() - start;
+	this->_phases.push_back(phase);
+}
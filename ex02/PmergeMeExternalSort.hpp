@@ -0,0 +1,80 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "./PmergeMe.hpp"
+#include "./PmergeMeReader.hpp"
+
+// メモリに収まらない入力を並べる外部ソート
+// 1. メモリ上限に収まる分ずつ読み込んで MergeInsertion で並べ、整列済みの列 (run) として一時ファイルへ書き出す
+// 2. 列を敗者木で k-way マージする (列が多すぎる場合は、何回かに分けてマージする)
+// 一時ファイルは 8バイト little-endian のバイナリ、出力は入力と同じ形式で書く
+class PmergeMeExternalSort
+{
+ public:
+	// 各段階の I/O 量と所要時間
+	typedef struct Phase {
+		std::string name;
+		std::size_t readBytes;
+		std::size_t writtenBytes;
+		// 出力した列の数
+		std::size_t runCount;
+		double seconds;
+	} Phase;
+
+	// メモリ上で並べる際の1要素あたりの使用量の目安 (値, 並べ替え先, 主鎖の位置の列)
+	static const std::size_t SORT_BYTES_PER_VALUE;
+	// indirect の場合の目安 (値, (キー, 位置) の組とその並べ替え先, 主鎖の位置の列, 移す元の位置の列)
+	static const std::size_t INDIRECT_SORT_BYTES_PER_VALUE;
+	static const std::size_t WRITE_BUFFER_SIZE;
+	// マージで列ごとに持つ読み込みバッファの最小の大きさ (これを下回る場合は何回かに分けてマージする)
+	static const std::size_t MIN_MERGE_BUFFER_SIZE;
+	static const std::size_t MIN_MEMORY_LIMIT;
+
+ private:
+	// 一時ファイル上の列 (offset バイト目から count 個)
+	typedef struct Run {
+		off_t offset;
+		std::size_t count;
+	} Run;
+
+	std::size_t _memoryLimit;
+	std::string _tempDirectory;
+	std::size_t _threadCount;
+	bool _isAdaptive;
+	bool _isNetwork;
+	bool _isIndirect;
+	std::size_t _valueCount;
+	std::vector<Phase> _phases;
+
+	int _createTempFile() const;
+	void _generateRuns(PmergeMeReader &reader, int inputFd, int outputFd, int runFd, std::vector<Run> &runs);
+	std::size_t _getMergeFanIn() const;
+	void _mergeRuns(int runFd, const std::vector<Run> &runs, int outputFd, PmergeMeReader::Format format, bool isFinal, Phase &phase);
+
+ public:
+	PmergeMeExternalSort();
+	explicit PmergeMeExternalSort(std::size_t memoryLimit);
+	PmergeMeExternalSort(const PmergeMeExternalSort &src);
+	virtual ~PmergeMeExternalSort();
+	PmergeMeExternalSort &operator=(const PmergeMeExternalSort &src);
+
+	std::size_t getMemoryLimit() const;
+	void setMemoryLimit(std::size_t memoryLimit);
+	const std::string &getTempDirectory() const;
+	void setTempDirectory(const std::string &tempDirectory);
+	void setThreadCount(std::size_t threadCount);
+	void setAdaptive(bool isAdaptive);
+	void setNetwork(bool isNetwork);
+	void setIndirect(bool isIndirect);
+
+	// inputPath, outputPath が "-" の場合は標準入出力を使う
+	void sort(PmergeMeReader &reader, const std::string &inputPath, const std::string &outputPath);
+
+	std::size_t getValueCount() const;
+	const std::vector<Phase> &getPhases() const;
+};
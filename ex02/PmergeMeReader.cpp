@@ -0,0 +1,324 @@
+#include "./PmergeMeReader.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "../common/NumberParser.hpp"
+
+const std::size_t PmergeMeReader::BUFFER_SIZE = 1 << 20;
+
+static const PmergeMe::VALUE_TYPE VALUE_MAX = std::numeric_limits<PmergeMe::VALUE_TYPE>::max();
+// 確認なしで溢れずに読める桁数
+static const std::size_t SAFE_DIGITS = std::numeric_limits<PmergeMe::VALUE_TYPE>::digits10;
+
+PmergeMeReader::PmergeMeReader(
+) : _format(FORMAT_TEXT),
+		_buffer(),
+		_position(0),
+		_length(0),
+		_isEof(false),
+		_value(0),
+		_digitCount(0),
+		_readBytes(0)
+{
+}
+
+PmergeMeReader::PmergeMeReader(
+	Format format
+) : _format(format),
+		_buffer(),
+		_position(0),
+		_length(0),
+		_isEof(false),
+		_value(0),
+		_digitCount(0),
+		_readBytes(0)
+{
+}
+
+PmergeMeReader::PmergeMeReader(
+	const PmergeMeReader &src
+) : _format(src._format),
+		_buffer(),
+		_position(0),
+		_length(0),
+		_isEof(false),
+		_value(0),
+		_digitCount(0),
+		_readBytes(0)
+{
+}
+
+PmergeMeReader::~PmergeMeReader(
+)
+{
+}
+
+PmergeMeReader &PmergeMeReader::operator=(
+	const PmergeMeReader &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_format = src._format;
+
+	return *this;
+}
+
+PmergeMeReader::Format PmergeMeReader::getFormat(
+) const
+{
+	return this->_format;
+}
+
+static bool _isSpace(
+	char c
+)
+{
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// value * 10 + digit が溢れる場合は out_of_range
+static void _appendDigit(
+	PmergeMe::VALUE_TYPE &value,
+	unsigned int digit
+)
+{
+	if (VALUE_MAX / 10 <= value) {
+		if (VALUE_MAX / 10 < value || VALUE_MAX % 10 < digit)
+			throw std::out_of_range(std::strerror(ERANGE));
+	}
+	value = value * 10 + digit;
+}
+
+void PmergeMeReader::parseValue(
+	const char *begin,
+	const char *end,
+	PmergeMe::VALUE_TYPE &value
+)
+{
+	switch (parseUnsigned(begin, end, value)) {
+		case NUMBER_PARSE_OK:
+			break;
+		case NUMBER_PARSE_INVALID:
+			throw std::invalid_argument("invalid argument");
+		case NUMBER_PARSE_OVERFLOW:
+			throw std::out_of_range(std::strerror(ERANGE));
+	}
+}
+
+// 読み込みの途中の状態を捨て、バッファを解放する
+void PmergeMeReader::_reset(
+)
+{
+	std::vector<char>().swap(this->_buffer);
+	this->_position = 0;
+	this->_length = 0;
+	this->_isEof = false;
+	this->_value = 0;
+	this->_digitCount = 0;
+}
+
+// _buffer[offset] 以降に読み込み、読み込んだバイト数を返す (0 は EOF)
+std::size_t PmergeMeReader::_fill(
+	int fd,
+	std::size_t offset
+)
+{
+	while (true) {
+		ssize_t ret = ::read(fd, &this->_buffer[offset], this->_buffer.size() - offset);
+		if (0 <= ret) {
+			this->_readBytes += static_cast<std::size_t>(ret);
+			return static_cast<std::size_t>(ret);
+		}
+		if (errno != EINTR)
+			throw std::runtime_error(std::strerror(errno));
+	}
+}
+
+bool PmergeMeReader::_readText(
+	int fd,
+	std::vector<PmergeMe::VALUE_TYPE> &values,
+	std::size_t maxCount
+)
+{
+	// バッファの境目をまたぐ数は、途中までの値を持ち越して続きを読む
+	std::size_t count = 0;
+	while (true) {
+		if (this->_position == this->_length) {
+			if (this->_isEof) {
+				if (this->_digitCount != 0) {
+					// 上限に達している場合は、最後の数を次の呼び出しに持ち越す
+					if (count == maxCount)
+						return true;
+					values.push_back(this->_value);
+				}
+				return false;
+			}
+			this->_position = 0;
+			this->_length = this->_fill(fd, 0);
+			this->_isEof = this->_length == 0;
+			continue;
+		}
+		const char *begin = &this->_buffer[0];
+		const char *p = begin + this->_position;
+		const char *end = begin + this->_length;
+		PmergeMe::VALUE_TYPE value = this->_value;
+		std::size_t digitCount = this->_digitCount;
+		for (; p != end; ++p) {
+			unsigned int digit = static_cast<unsigned char>(*p - '0');
+			if (digit <= 9 && digitCount == 0) {
+				// バッファ内で終わる数は、まとめて変換する
+				PmergeMe::VALUE_TYPE parsed = 0;
+				bool isOverflow = false;
+				const char *digitsEnd = parseDigitPrefix(p, end, parsed, isOverflow);
+				if (digitsEnd != end) {
+					if (isOverflow)
+						throw std::out_of_range(std::strerror(ERANGE));
+					value = parsed;
+					digitCount = digitsEnd - p;
+					p = digitsEnd - 1;
+					continue;
+				}
+			}
+			if (digit <= 9) {
+				// SAFE_DIGITS 桁までは溢れないので確認を省く
+				if (digitCount < SAFE_DIGITS)
+					value = value * 10 + digit;
+				else
+					_appendDigit(value, digit);
+				++digitCount;
+			} else if (_isSpace(*p)) {
+				if (digitCount != 0) {
+					values.push_back(value);
+					if (++count == maxCount) {
+						this->_position = p + 1 - begin;
+						this->_value = 0;
+						this->_digitCount = 0;
+						return true;
+					}
+				}
+				value = 0;
+				digitCount = 0;
+			} else {
+				throw std::invalid_argument("invalid argument");
+			}
+		}
+		this->_position = this->_length;
+		this->_value = value;
+		this->_digitCount = digitCount;
+	}
+}
+
+bool PmergeMeReader::_readBinary(
+	int fd,
+	std::vector<PmergeMe::VALUE_TYPE> &values,
+	std::size_t maxCount
+)
+{
+	const std::size_t valueSize = sizeof(PmergeMe::VALUE_TYPE);
+	std::size_t count = 0;
+	while (true) {
+		std::size_t available = this->_length - this->_position;
+		if (available < valueSize) {
+			if (this->_isEof) {
+				if (available != 0)
+					throw std::invalid_argument("invalid argument (truncated binary input)");
+				return false;
+			}
+			// 読み残した (値の途中の) バイトはバッファの先頭へ移して続きを読む
+			std::memmove(&this->_buffer[0], &this->_buffer[this->_position], available);
+			this->_position = 0;
+			std::size_t length = this->_fill(fd, available);
+			this->_length = available + length;
+			this->_isEof = length == 0;
+			continue;
+		}
+		std::size_t chunkCount = std::min(available / valueSize, maxCount - count);
+		const unsigned char *p = reinterpret_cast<const unsigned char *>(&this->_buffer[this->_position]);
+		for (std::size_t i = 0; i < chunkCount * valueSize; i += valueSize) {
+			PmergeMe::VALUE_TYPE value = 0;
+			for (std::size_t byte = valueSize; byte-- != 0;) {
+				value = (value << 8) | p[i + byte];
+			}
+			values.push_back(value);
+		}
+		this->_position += chunkCount * valueSize;
+		count += chunkCount;
+		if (count == maxCount)
+			return true;
+	}
+}
+
+bool PmergeMeReader::readChunk(
+	int fd,
+	std::vector<PmergeMe::VALUE_TYPE> &values,
+	std::size_t maxCount
+)
+{
+	if (maxCount == 0)
+		return true;
+	if (this->_buffer.empty())
+		this->_buffer.resize(BUFFER_SIZE);
+	bool isRemaining;
+	try {
+		isRemaining = this->_format == FORMAT_BINARY
+			? this->_readBinary(fd, values, maxCount)
+			: this->_readText(fd, values, maxCount);
+	} catch (...) {
+		this->_reset();
+		throw;
+	}
+	if (!isRemaining)
+		this->_reset();
+	return isRemaining;
+}
+
+void PmergeMeReader::read(
+	int fd,
+	std::vector<PmergeMe::VALUE_TYPE> &values
+)
+{
+	if (this->_format == FORMAT_BINARY) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+			values.reserve(values.size() + static_cast<std::size_t>(st.st_size) / sizeof(PmergeMe::VALUE_TYPE));
+	}
+	while (this->readChunk(fd, values, std::numeric_limits<std::size_t>::max()))
+		;
+}
+
+void PmergeMeReader::readFile(
+	const std::string &path,
+	std::vector<PmergeMe::VALUE_TYPE> &values
+)
+{
+	if (path == "-") {
+		this->read(STDIN_FILENO, values);
+		return;
+	}
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open file: " + path);
+	try {
+		this->read(fd, values);
+	} catch (...) {
+		close(fd);
+		throw;
+	}
+	close(fd);
+}
+
+std::size_t PmergeMeReader::getReadBytes(
+) const
+{
+	return this->_readBytes;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "./PmergeMe.hpp"
+
+// ファイル (または標準入力) から並べる値を読み込む
+// テキスト: 空白区切りの10進数 / バイナリ: 8バイト little-endian の列
+class PmergeMeReader
+{
+ public:
+	typedef enum Format {
+		FORMAT_TEXT,
+		FORMAT_BINARY
+	} Format;
+
+	static const std::size_t BUFFER_SIZE;
+
+ private:
+	Format _format;
+	std::vector<char> _buffer;
+	// _buffer の未処理の範囲 [_position, _length)
+	std::size_t _position;
+	std::size_t _length;
+	bool _isEof;
+	// バッファの境目をまたぐ数の、途中までの値と桁数 (テキスト)
+	PmergeMe::VALUE_TYPE _value;
+	std::size_t _digitCount;
+	// これまでに読み込んだバイト数
+	std::size_t _readBytes;
+
+	void _reset();
+	std::size_t _fill(int fd, std::size_t offset);
+	bool _readText(int fd, std::vector<PmergeMe::VALUE_TYPE> &values, std::size_t maxCount);
+	bool _readBinary(int fd, std::vector<PmergeMe::VALUE_TYPE> &values, std::size_t maxCount);
+
+ public:
+	PmergeMeReader();
+	explicit PmergeMeReader(Format format);
+	PmergeMeReader(const PmergeMeReader &src);
+	virtual ~PmergeMeReader();
+	PmergeMeReader &operator=(const PmergeMeReader &src);
+
+	Format getFormat() const;
+	void read(int fd, std::vector<PmergeMe::VALUE_TYPE> &values);
+	// values に最大 maxCount 個を追加する (続きは次の呼び出しで読む)
+	// 入力の終わりに達した場合は false を返す
+	bool readChunk(int fd, std::vector<PmergeMe::VALUE_TYPE> &values, std::size_t maxCount);
+	// path が "-" の場合は標準入力から読む
+	void readFile(const std::string &path, std::vector<PmergeMe::VALUE_TYPE> &values);
+	std::size_t getReadBytes() const;
+
+	// [begin, end) の10進数を value に変換する (数字以外を含む場合は invalid_argument, 溢れる場合は out_of_range)
+	static void parseValue(const char *begin, const char *end, PmergeMe::VALUE_TYPE &value);
+};
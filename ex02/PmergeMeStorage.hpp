@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <vector>
+
+#include "./MergeInsertion.hpp"
+
+// PmergeMe の3つのコンテナを、値の型 T (16, 32, 64 ビットの符号なし整数) で持つ
+// 値の範囲に合う小さい型で持つことで、1要素あたりのメモリ (キャッシュ, 帯域) を減らす
+// 比較は値そのものの大小で行うので、比較の順序と回数は型によらず同じになる
+template <typename T>
+class PmergeMeStorage
+{
+ public:
+	typedef T VALUE_TYPE;
+	typedef std::deque<T> CONTAINER_TYPE_1;
+	typedef std::list<T> CONTAINER_TYPE_2;
+	typedef std::vector<T> CONTAINER_TYPE_3;
+
+ private:
+	CONTAINER_TYPE_1 _container1;
+	CONTAINER_TYPE_2 _container2;
+	CONTAINER_TYPE_3 _container3;
+
+	static std::size_t _getSortedCount(std::size_t size, std::size_t topCount);
+
+ public:
+	PmergeMeStorage();
+	PmergeMeStorage(const PmergeMeStorage &src);
+	virtual ~PmergeMeStorage();
+	PmergeMeStorage &operator=(const PmergeMeStorage &src);
+
+	// values はすべて T で表せること
+	template <typename Value>
+	void assign(const std::vector<Value> &values);
+
+	// src の1つのコンテナだけをコピーする (ほかのコンテナは空にする)
+	void copyContainer1(const PmergeMeStorage &src);
+	void copyContainer2(const PmergeMeStorage &src);
+	void copyContainer3(const PmergeMeStorage &src);
+
+	const CONTAINER_TYPE_1 &getContainer1() const;
+	const CONTAINER_TYPE_2 &getContainer2() const;
+	const CONTAINER_TYPE_3 &getContainer3() const;
+	// topCount が 0 以外なら、小さい方から topCount 個だけを並べる
+	void sort1(const MergeInsertion<T> &sorter, std::size_t topCount);
+	void sort2(const MergeInsertion<T> &sorter, std::size_t topCount);
+	void sort3(const MergeInsertion<T> &sorter, std::size_t topCount);
+};
+
+#include "./PmergeMeStorage.tpp"
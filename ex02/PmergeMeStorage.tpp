@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#if defined(DEBUG) || defined(VALIDATE)
+#include <iostream>
+#include <iterator>
+#endif	// DEBUG || VALIDATE
+#ifdef DEBUG
+#include <string>
+#endif	// DEBUG
+
+#include "./PmergeMeStorage.hpp"
+
+#ifdef DEBUG
+template <typename Container>
+static void _printStorageContainer(
+	const std::string &header,
+	const Container &container
+)
+{
+	std::cout
+		<< header;
+	for (
+		typename Container::const_iterator it = container.begin();
+		it != container.end();
+		++it
+	) {
+		std::cout
+			<< " "
+			<< static_cast<unsigned long long>(*it);
+	}
+	std::cout
+		<< std::endl;
+}
+#endif	// DEBUG
+
+template <typename T>
+PmergeMeStorage<T>::PmergeMeStorage(
+) : _container1(),
+		_container2(),
+		_container3()
+{
+}
+
+template <typename T>
+PmergeMeStorage<T>::PmergeMeStorage(
+	const PmergeMeStorage &src
+) : _container1(src._container1),
+		_container2(src._container2),
+		_container3(src._container3)
+{
+}
+
+template <typename T>
+PmergeMeStorage<T>::~PmergeMeStorage(
+)
+{
+}
+
+template <typename T>
+PmergeMeStorage<T> &PmergeMeStorage<T>::operator=(
+	const PmergeMeStorage &src
+)
+{
+	if (this == &src)
+		return *this;
+
+	this->_container1 = src._container1;
+	this->_container2 = src._container2;
+	this->_container3 = src._container3;
+
+	return *this;
+}
+
+// 並べ終えたあとに整列しているはずの先頭の要素数
+template <typename T>
+std::size_t PmergeMeStorage<T>::_getSortedCount(
+	std::size_t size,
+	std::size_t topCount
+)
+{
+	if (topCount == 0)
+		return size;
+	return std::min(topCount, size);
+}
+
+template <typename T>
+template <typename Value>
+void PmergeMeStorage<T>::assign(
+	const std::vector<Value> &values
+)
+{
+	this->_container3.resize(values.size());
+	for (std::size_t i = 0; i < values.size(); i++) {
+		this->_container3[i] = static_cast<T>(values[i]);
+	}
+	this->_container1.assign(this->_container3.begin(), this->_container3.end());
+	this->_container2.assign(this->_container3.begin(), this->_container3.end());
+}
+
+template <typename T>
+void PmergeMeStorage<T>::copyContainer1(
+	const PmergeMeStorage &src
+)
+{
+	this->_container1 = src._container1;
+	this->_container2.clear();
+	this->_container3.clear();
+}
+
+template <typename T>
+void PmergeMeStorage<T>::copyContainer2(
+	const PmergeMeStorage &src
+)
+{
+	this->_container1.clear();
+	this->_container2 = src._container2;
+	this->_container3.clear();
+}
+
+template <typename T>
+void PmergeMeStorage<T>::copyContainer3(
+	const PmergeMeStorage &src
+)
+{
+	this->_container1.clear();
+	this->_container2.clear();
+	this->_container3 = src._container3;
+}
+
+template <typename T>
+const typename PmergeMeStorage<T>::CONTAINER_TYPE_1 &PmergeMeStorage<T>::getContainer1(
+) const
+{
+	return this->_container1;
+}
+
+template <typename T>
+const typename PmergeMeStorage<T>::CONTAINER_TYPE_2 &PmergeMeStorage<T>::getContainer2(
+) const
+{
+	return this->_container2;
+}
+
+template <typename T>
+const typename PmergeMeStorage<T>::CONTAINER_TYPE_3 &PmergeMeStorage<T>::getContainer3(
+) const
+{
+	return this->_container3;
+}
+
+template <typename T>
+void PmergeMeStorage<T>::sort1(
+	const MergeInsertion<T> &sorter,
+	std::size_t topCount
+)
+{
+	if (topCount != 0)
+		sorter.partialSort(this->_container1, topCount);
+	else
+		sorter.sort(this->_container1);
+#ifdef DEBUG
+	_printStorageContainer("sort1:", this->_container1);
+#endif	// DEBUG
+
+#if defined(DEBUG) || defined(VALIDATE)
+	T lastValue = this->_container1.front();
+	for (
+		typename CONTAINER_TYPE_1::const_iterator it = this->_container1.begin() + 1;
+		it != this->_container1.begin() + _getSortedCount(this->_container1.size(), topCount);
+		++it
+	) {
+		if (lastValue > *it) {
+			std::cerr
+				<< "sort1 failed ("
+				<< static_cast<unsigned long long>(lastValue)
+				<< " > "
+				<< static_cast<unsigned long long>(*it)
+				<< ")"
+				<< std::endl;
+		}
+		lastValue = *it;
+	}
+#endif	// DEBUG || VALIDATE
+}
+
+template <typename T>
+void PmergeMeStorage<T>::sort2(
+	const MergeInsertion<T> &sorter,
+	std::size_t topCount
+)
+{
+	if (topCount != 0)
+		sorter.partialSort(this->_container2, topCount);
+	else
+		sorter.sort(this->_container2);
+#ifdef DEBUG
+	_printStorageContainer("sort2:", this->_container2);
+#endif	// DEBUG
+#if defined(DEBUG) || defined(VALIDATE)
+	T lastValue = this->_container2.front();
+	typename CONTAINER_TYPE_2::const_iterator sortedEnd = this->_container2.begin();
+	std::advance(sortedEnd, _getSortedCount(this->_container2.size(), topCount));
+	for (
+		typename CONTAINER_TYPE_2::const_iterator it = this->_container2.begin();
+		it != sortedEnd;
+		++it
+	) {
+		if (it == this->_container2.begin())
+			continue;
+		if (lastValue > *it) {
+			std::cerr
+				<< "sort2 failed ("
+				<< static_cast<unsigned long long>(lastValue)
+				<< " > "
+				<< static_cast<unsigned long long>(*it)
+				<< ")"
+				<< std::endl;
+		}
+		lastValue = *it;
+	}
+#endif	// DEBUG || VALIDATE
+}
+
+template <typename T>
+void PmergeMeStorage<T>::sort3(
+	const MergeInsertion<T> &sorter,
+	std::size_t topCount
+)
+{
+	if (topCount != 0)
+		sorter.partialSort(this->_container3, topCount);
+	else
+		sorter.sort(this->_container3);
+#ifdef DEBUG
+	_printStorageContainer("sort3:", this->_container3);
+#endif	// DEBUG
+
+#if defined(DEBUG) || defined(VALIDATE)
+	for (std::size_t i = 1; i < _getSortedCount(this->_container3.size(), topCount); i++) {
+		if (this->_container3[i - 1] > this->_container3[i]) {
+			std::cerr
+				<< "sort3 failed ("
+				<< static_cast<unsigned long long>(this->_container3[i - 1])
+				<< " > "
+				<< static_cast<unsigned long long>(this->_container3[i])
+				<< ")"
+				<< std::endl;
+		}
+	}
+#endif	// DEBUG || VALIDATE
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif	// __AVX2__ || __SSE4_2__
+
+// 8要素を並べる sorting network (深さ 6, 19 回の比較交換)
+// 比較の順序が入力によらず決まっているので、分岐せずに (SIMD では複数のブロックを同時に) 並べられる
+static const std::size_t SORTING_NETWORK_SIZE = 8;
+static const std::size_t SORTING_NETWORK_COMPARATOR_COUNT = 19;
+static const unsigned char SORTING_NETWORK_COMPARATORS[SORTING_NETWORK_COMPARATOR_COUNT][2] = {
+	{0, 2}, {1, 3}, {4, 6}, {5, 7},
+	{0, 4}, {1, 5}, {2, 6}, {3, 7},
+	{0, 1}, {2, 3}, {4, 5}, {6, 7},
+	{2, 4}, {3, 5},
+	{1, 4}, {3, 6},
+	{1, 2}, {3, 4}, {5, 6},
+};
+
+// first[0..8) を並べる (比較結果で値を選ぶだけなので、コンパイラが条件付き転送にできる)
+template <typename RandomAccessIterator, typename Less>
+inline void sortingNetwork8(
+	RandomAccessIterator first,
+	const Less &less
+)
+{
+	typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+	for (std::size_t i = 0; i < SORTING_NETWORK_COMPARATOR_COUNT; i++) {
+		value_type &left = first[SORTING_NETWORK_COMPARATORS[i][0]];
+		value_type &right = first[SORTING_NETWORK_COMPARATORS[i][1]];
+		bool isSwapped = less(right, left);
+		value_type low = isSwapped ? right : left;
+		value_type high = isSwapped ? left : right;
+		left = low;
+		right = high;
+	}
+}
+
+#if defined(__AVX2__)
+// 符号なしの比較を符号付きの比較 (vpcmpgtq) で行うため、最上位ビットを反転する
+static inline void _compareExchangeAvx2(
+	__m256i &left,
+	__m256i &right
+)
+{
+	const __m256i bias = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+	__m256i isGreater = _mm256_cmpgt_epi64(_mm256_xor_si256(left, bias), _mm256_xor_si256(right, bias));
+	__m256i low = _mm256_blendv_epi8(left, right, isGreater);
+	right = _mm256_blendv_epi8(right, left, isGreater);
+	left = low;
+}
+
+// 4x4 の転置 (転置をもう一度行うと元に戻る)
+static inline void _transposeAvx2(
+	__m256i &a,
+	__m256i &b,
+	__m256i &c,
+	__m256i &d
+)
+{
+	__m256i ab0 = _mm256_unpacklo_epi64(a, b);
+	__m256i ab1 = _mm256_unpackhi_epi64(a, b);
+	__m256i cd0 = _mm256_unpacklo_epi64(c, d);
+	__m256i cd1 = _mm256_unpackhi_epi64(c, d);
+	a = _mm256_permute2x128_si256(ab0, cd0, 0x20);
+	b = _mm256_permute2x128_si256(ab1, cd1, 0x20);
+	c = _mm256_permute2x128_si256(ab0, cd0, 0x31);
+	d = _mm256_permute2x128_si256(ab1, cd1, 0x31);
+}
+
+// 連続した4ブロック (32要素) を同時に並べる
+// 転置して「各ブロックの i 番目」を1つのレジスタに集め、レジスタ同士で比較交換する
+static inline void _sortingNetworkAvx2(
+	unsigned long long *data
+)
+{
+	__m256i rows[SORTING_NETWORK_SIZE];
+	for (std::size_t half = 0; half < 2; half++) {
+		__m256i *row = rows + half * 4;
+		for (std::size_t block = 0; block < 4; block++) {
+			row[block] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + block * SORTING_NETWORK_SIZE + half * 4));
+		}
+		_transposeAvx2(row[0], row[1], row[2], row[3]);
+	}
+	for (std::size_t i = 0; i < SORTING_NETWORK_COMPARATOR_COUNT; i++) {
+		_compareExchangeAvx2(rows[SORTING_NETWORK_COMPARATORS[i][0]], rows[SORTING_NETWORK_COMPARATORS[i][1]]);
+	}
+	for (std::size_t half = 0; half < 2; half++) {
+		__m256i *row = rows + half * 4;
+		_transposeAvx2(row[0], row[1], row[2], row[3]);
+		for (std::size_t block = 0; block < 4; block++) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(data + block * SORTING_NETWORK_SIZE + half * 4), row[block]);
+		}
+	}
+}
+#elif defined(__SSE4_2__)
+static inline void _compareExchangeSse(
+	__m128i &left,
+	__m128i &right
+)
+{
+	const __m128i bias = _mm_set1_epi64x(static_cast<long long>(1ULL << 63));
+	__m128i isGreater = _mm_cmpgt_epi64(_mm_xor_si128(left, bias), _mm_xor_si128(right, bias));
+	__m128i low = _mm_blendv_epi8(left, right, isGreater);
+	right = _mm_blendv_epi8(right, left, isGreater);
+	left = low;
+}
+
+// 連続した2ブロック (16要素) を同時に並べる
+static inline void _sortingNetworkSse(
+	unsigned long long *data
+)
+{
+	__m128i rows[SORTING_NETWORK_SIZE];
+	for (std::size_t i = 0; i < SORTING_NETWORK_SIZE; i += 2) {
+		__m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		__m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + SORTING_NETWORK_SIZE + i));
+		rows[i] = _mm_unpacklo_epi64(first, second);
+		rows[i + 1] = _mm_unpackhi_epi64(first, second);
+	}
+	for (std::size_t i = 0; i < SORTING_NETWORK_COMPARATOR_COUNT; i++) {
+		_compareExchangeSse(rows[SORTING_NETWORK_COMPARATORS[i][0]], rows[SORTING_NETWORK_COMPARATORS[i][1]]);
+	}
+	for (std::size_t i = 0; i < SORTING_NETWORK_SIZE; i += 2) {
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_unpacklo_epi64(rows[i], rows[i + 1]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(data + SORTING_NETWORK_SIZE + i), _mm_unpackhi_epi64(rows[i], rows[i + 1]));
+	}
+}
+#endif	// __AVX2__ / __SSE4_2__
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+// 16, 32 ビットの値を符号なしの min / max で比較交換する (1レジスタに入る数だけのブロックを同時に並べる)
+#if defined(__AVX2__)
+struct SortingNetworkLanes32 {
+	typedef unsigned int value_type;
+	typedef __m256i vector_type;
+	static const std::size_t LANE_COUNT = 8;
+
+	static vector_type load(const value_type *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+	static void store(value_type *p, vector_type v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+	static vector_type min(vector_type a, vector_type b) { return _mm256_min_epu32(a, b); }
+	static vector_type max(vector_type a, vector_type b) { return _mm256_max_epu32(a, b); }
+};
+
+struct SortingNetworkLanes16 {
+	typedef unsigned short value_type;
+	typedef __m256i vector_type;
+	static const std::size_t LANE_COUNT = 16;
+
+	static vector_type load(const value_type *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+	static void store(value_type *p, vector_type v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+	static vector_type min(vector_type a, vector_type b) { return _mm256_min_epu16(a, b); }
+	static vector_type max(vector_type a, vector_type b) { return _mm256_max_epu16(a, b); }
+};
+#else
+struct SortingNetworkLanes32 {
+	typedef unsigned int value_type;
+	typedef __m128i vector_type;
+	static const std::size_t LANE_COUNT = 4;
+
+	static vector_type load(const value_type *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+	static void store(value_type *p, vector_type v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+	static vector_type min(vector_type a, vector_type b) { return _mm_min_epu32(a, b); }
+	static vector_type max(vector_type a, vector_type b) { return _mm_max_epu32(a, b); }
+};
+
+struct SortingNetworkLanes16 {
+	typedef unsigned short value_type;
+	typedef __m128i vector_type;
+	static const std::size_t LANE_COUNT = 8;
+
+	static vector_type load(const value_type *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+	static void store(value_type *p, vector_type v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+	static vector_type min(vector_type a, vector_type b) { return _mm_min_epu16(a, b); }
+	static vector_type max(vector_type a, vector_type b) { return _mm_max_epu16(a, b); }
+};
+#endif	// __AVX2__
+
+// 連続した LANE_COUNT ブロックを同時に並べる
+// 「各ブロックの i 番目」を作業領域に集め (転置し) てから、レジスタ同士で比較交換する
+template <typename Lanes>
+static inline void _sortingNetworkLanes(
+	typename Lanes::value_type *data
+)
+{
+	typedef typename Lanes::value_type value_type;
+	typedef typename Lanes::vector_type vector_type;
+	value_type columns[SORTING_NETWORK_SIZE][Lanes::LANE_COUNT];
+	for (std::size_t block = 0; block < Lanes::LANE_COUNT; block++) {
+		for (std::size_t i = 0; i < SORTING_NETWORK_SIZE; i++) {
+			columns[i][block] = data[block * SORTING_NETWORK_SIZE + i];
+		}
+	}
+	vector_type rows[SORTING_NETWORK_SIZE];
+	for (std::size_t i = 0; i < SORTING_NETWORK_SIZE; i++) {
+		rows[i] = Lanes::load(columns[i]);
+	}
+	for (std::size_t i = 0; i < SORTING_NETWORK_COMPARATOR_COUNT; i++) {
+		vector_type &left = rows[SORTING_NETWORK_COMPARATORS[i][0]];
+		vector_type &right = rows[SORTING_NETWORK_COMPARATORS[i][1]];
+		vector_type low = Lanes::min(left, right);
+		right = Lanes::max(left, right);
+		left = low;
+	}
+	for (std::size_t i = 0; i < SORTING_NETWORK_SIZE; i++) {
+		Lanes::store(columns[i], rows[i]);
+	}
+	for (std::size_t block = 0; block < Lanes::LANE_COUNT; block++) {
+		for (std::size_t i = 0; i < SORTING_NETWORK_SIZE; i++) {
+			data[block * SORTING_NETWORK_SIZE + i] = columns[i][block];
+		}
+	}
+}
+
+template <typename Lanes>
+static inline void _sortingNetworkLanesBlocks(
+	typename Lanes::value_type *data,
+	std::size_t blockCount
+)
+{
+	std::size_t block = 0;
+	for (; block + Lanes::LANE_COUNT <= blockCount; block += Lanes::LANE_COUNT) {
+		_sortingNetworkLanes<Lanes>(data + block * SORTING_NETWORK_SIZE);
+	}
+	for (; block < blockCount; block++) {
+		sortingNetwork8(data + block * SORTING_NETWORK_SIZE, std::less<typename Lanes::value_type>());
+	}
+}
+#endif	// __AVX2__ || __SSE4_2__
+
+// 連続した blockCount 個の8要素ブロックを、それぞれ昇順に並べる
+// SIMD の処理がない型は1ブロックずつ並べる
+template <typename T>
+inline void sortingNetworkBlocks(
+	T *data,
+	std::size_t blockCount
+)
+{
+	for (std::size_t block = 0; block < blockCount; block++) {
+		sortingNetwork8(data + block * SORTING_NETWORK_SIZE, std::less<T>());
+	}
+}
+
+// AVX2 / SSE4.2 を有効にしてビルドした場合は SIMD で、それ以外は1ブロックずつ並べる
+inline void sortingNetworkBlocks(
+	unsigned long long *data,
+	std::size_t blockCount
+)
+{
+	std::size_t block = 0;
+#if defined(__AVX2__)
+	for (; block + 4 <= blockCount; block += 4) {
+		_sortingNetworkAvx2(data + block * SORTING_NETWORK_SIZE);
+	}
+#elif defined(__SSE4_2__)
+	for (; block + 2 <= blockCount; block += 2) {
+		_sortingNetworkSse(data + block * SORTING_NETWORK_SIZE);
+	}
+#endif	// __AVX2__ / __SSE4_2__
+	for (; block < blockCount; block++) {
+		sortingNetwork8(data + block * SORTING_NETWORK_SIZE, std::less<unsigned long long>());
+	}
+}
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+inline void sortingNetworkBlocks(
+	unsigned int *data,
+	std::size_t blockCount
+)
+{
+	_sortingNetworkLanesBlocks<SortingNetworkLanes32>(data, blockCount);
+}
+
+inline void sortingNetworkBlocks(
+	unsigned short *data,
+	std::size_t blockCount
+)
+{
+	_sortingNetworkLanesBlocks<SortingNetworkLanes16>(data, blockCount);
+}
+#endif	// __AVX2__ || __SSE4_2__
+
+// SIMD を使っているかの表示用
+inline const char *getSortingNetworkKernelName(
+)
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(__SSE4_2__)
+	return "SSE4.2";
+#else
+	return "scalar";
+#endif	// __AVX2__ / __SSE4_2__
+}
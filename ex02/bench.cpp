@@ -0,0 +1,739 @@
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common/NumberParser.hpp"
+#include "./MergeInsertion.hpp"
+#include "./PmergeMe.hpp"
+#include "./SortingNetwork.hpp"
+
+typedef enum Distribution {
+	DIST_RANDOM,
+	DIST_SORTED,
+	DIST_REVERSE,
+	DIST_SAWTOOTH,
+	DIST_FEW_RUNS,
+	DIST_ADVERSARIAL,
+	DIST_COUNT
+} Distribution;
+
+static const char *DIST_NAMES[DIST_COUNT] = {
+	"random",
+	"sorted",
+	"reverse",
+	"sawtooth",
+	"few-runs",
+	"adversarial",
+};
+
+typedef enum Backend {
+	BACKEND_DEQUE,
+	BACKEND_LIST,
+	BACKEND_VECTOR,
+	BACKEND_VECTOR_THREADS,
+	BACKEND_VECTOR_RECORDS,
+	BACKEND_COUNT
+} Backend;
+
+static const char *BACKEND_NAMES[BACKEND_COUNT] = {
+	__CONTAINER_TYPE_1_STR,
+	"std::list",
+	__CONTAINER_TYPE_3_STR,
+	__CONTAINER_TYPE_3_STR " (threads)",
+	"std::vector (128B records)",
+};
+
+// indirect の効果を見るための大きな要素 (キー + 120バイトのペイロード)
+typedef struct BenchPayload {
+	PmergeMe::VALUE_TYPE words[15];
+} BenchPayload;
+
+typedef MergeInsertion<PmergeMe::VALUE_TYPE, BenchPayload> RecordSorter;
+typedef RecordSorter::value_type BenchRecord;
+
+// plain は比較回数が最小の merge-insertion、それ以外は通常の結果と比べる
+typedef enum Mode {
+	MODE_PLAIN,
+	MODE_ADAPTIVE,
+	MODE_NETWORK,
+	MODE_INDIRECT,
+	MODE_TOP,
+	MODE_COUNT
+} Mode;
+
+static const char *MODE_NAMES[MODE_COUNT] = {
+	"plain",
+	"adaptive",
+	"network",
+	"indirect",
+	"top-k",
+};
+
+typedef struct BenchOption {
+	std::vector<std::size_t> sizes;
+	bool isDistEnabled[DIST_COUNT];
+	std::size_t warmupCount;
+	std::size_t repeatCount;
+	std::size_t threadCount;
+	// adversarial で比較回数が増える入れ替えを探す回数
+	std::size_t adversarialRounds;
+	unsigned long seed;
+	// 通常に加えて測るモード (adaptive: 整列済みの区間を使う, network: ブロックを sorting network で並べる,
+	// indirect: (キー, 位置) の組を並べてから要素を移す; 128B records も測る,
+	// top-k: 小さい方から topCount 個だけを並べる)
+	bool isModeEnabled[MODE_COUNT];
+	std::size_t topCount;
+	// 値に WIDE_OFFSET を足して、常に 64 ビットの値として並べる (値の幅に合わせた型で持つ場合と比べる)
+	bool isWide;
+	bool isJson;
+} BenchOption;
+
+static const PmergeMe::VALUE_TYPE WIDE_OFFSET = 1ULL << 32;
+
+// 中央値と95パーセンタイル (ns)
+typedef struct Summary {
+	double median;
+	double p95;
+} Summary;
+
+typedef struct Result {
+	Backend backend;
+	Mode mode;
+	Distribution distribution;
+	std::size_t size;
+	PmergeMe::Width width;
+	std::size_t comparisons;
+	Summary wall;
+	Summary cpu;
+} Result;
+
+// 再現性のため、標準の rand() ではなく自前の xorshift を使う
+static unsigned long _nextRandom(
+	unsigned long &state
+)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static void _shuffle(
+	std::vector<PmergeMe::VALUE_TYPE> &values,
+	unsigned long &state
+)
+{
+	for (std::size_t i = values.size(); 1 < i; i--) {
+		std::swap(values[i - 1], values[_nextRandom(state) % i]);
+	}
+}
+
+// 比較回数を数える比較関数 (COUNT ビルドでなくても数えられるように)
+class CountingLess
+{
+ private:
+	std::size_t *_count;
+
+ public:
+	explicit CountingLess(std::size_t *count = NULL) : _count(count) {}
+
+	bool operator()(PmergeMe::VALUE_TYPE left, PmergeMe::VALUE_TYPE right) const
+	{
+		++*this->_count;
+		return left < right;
+	}
+};
+
+static std::size_t _countComparisons(
+	const std::vector<PmergeMe::VALUE_TYPE> &values,
+	Mode mode = MODE_PLAIN,
+	std::size_t topCount = 0
+)
+{
+	std::size_t count = 0;
+	MergeInsertion<PmergeMe::VALUE_TYPE, MergeInsertionNoPayload, CountingLess> sorter((CountingLess(&count)));
+	sorter.setAdaptive(mode == MODE_ADAPTIVE);
+	sorter.setNetwork(mode == MODE_NETWORK);
+	sorter.setIndirect(mode == MODE_INDIRECT);
+	std::vector<PmergeMe::VALUE_TYPE> copy(values);
+	if (mode == MODE_TOP)
+		sorter.partialSort(copy, topCount);
+	else
+		sorter.sort(copy);
+	return count;
+}
+
+// 1..n の並び (値はすべて異なる)
+static std::vector<PmergeMe::VALUE_TYPE> generateInput(
+	Distribution distribution,
+	std::size_t n,
+	const BenchOption &option,
+	unsigned long &state
+)
+{
+	std::vector<PmergeMe::VALUE_TYPE> values(n);
+	for (std::size_t i = 0; i < n; i++) {
+		values[i] = i + 1;
+	}
+
+	switch (distribution) {
+		case DIST_RANDOM:
+			_shuffle(values, state);
+			break;
+		case DIST_SORTED:
+			break;
+		case DIST_REVERSE:
+			std::reverse(values.begin(), values.end());
+			break;
+		case DIST_SAWTOOTH: {
+			// 長さ約 sqrt(n) の昇順の山を繰り返す
+			std::size_t toothSize = 1;
+			while (toothSize * toothSize < n)
+				++toothSize;
+			std::size_t toothCount = (n + toothSize - 1) / toothSize;
+			std::vector<PmergeMe::VALUE_TYPE> sawtooth;
+			sawtooth.reserve(n);
+			for (std::size_t tooth = 0; tooth < toothCount; tooth++) {
+				for (std::size_t i = tooth; i < n; i += toothCount) {
+					sawtooth.push_back(values[i]);
+				}
+			}
+			values.swap(sawtooth);
+			break;
+		}
+		case DIST_FEW_RUNS: {
+			// 昇順の区間を8つに分け、区間の順序だけを入れ替える
+			const std::size_t runCount = 8;
+			std::vector<std::size_t> order(runCount);
+			for (std::size_t i = 0; i < runCount; i++) {
+				order[i] = i;
+			}
+			for (std::size_t i = runCount; 1 < i; i--) {
+				std::swap(order[i - 1], order[_nextRandom(state) % i]);
+			}
+			std::vector<PmergeMe::VALUE_TYPE> runs;
+			runs.reserve(n);
+			for (std::size_t i = 0; i < runCount; i++) {
+				runs.insert(runs.end(), values.begin() + n * order[i] / runCount, values.begin() + n * (order[i] + 1) / runCount);
+			}
+			values.swap(runs);
+			break;
+		}
+		case DIST_ADVERSARIAL: {
+			// 比較回数が減らない入れ替えだけを採用する山登りで、比較回数の多い入力を探す
+			_shuffle(values, state);
+			if (n < 2)
+				break;
+			std::size_t bestCount = _countComparisons(values);
+			for (std::size_t round = 0; round < option.adversarialRounds; round++) {
+				std::size_t i = _nextRandom(state) % n;
+				std::size_t j = _nextRandom(state) % n;
+				std::swap(values[i], values[j]);
+				std::size_t count = _countComparisons(values);
+				if (count < bestCount)
+					std::swap(values[i], values[j]);
+				else
+					bestCount = count;
+			}
+			break;
+		}
+		case DIST_COUNT:
+			break;
+	}
+	return values;
+}
+
+static struct timespec _now(
+	clockid_t clockId
+)
+{
+	struct timespec time;
+	if (clock_gettime(clockId, &time) != 0) {
+		const char *msg = std::strerror(errno);
+		throw std::runtime_error(msg);
+	}
+	return time;
+}
+
+static double _elapsedNs(
+	const struct timespec &start,
+	const struct timespec &end
+)
+{
+	return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+static Summary _summarize(
+	std::vector<double> samples
+)
+{
+	Summary summary;
+	std::sort(samples.begin(), samples.end());
+	std::size_t count = samples.size();
+	summary.median = count % 2 == 1 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+	// nearest-rank 法
+	std::size_t rank = (count * 95 + 99) / 100;
+	summary.p95 = samples[rank == 0 ? 0 : rank - 1];
+	return summary;
+}
+
+// 先頭 count 個が昇順で、残りがそれ以上か
+template <typename T>
+static bool _isSorted(
+	const T &container,
+	std::size_t count = static_cast<std::size_t>(-1)
+)
+{
+	typename T::const_iterator it = container.begin();
+	if (it == container.end())
+		return true;
+	typename T::const_iterator next = it;
+	for (++next; next != container.end() && 1 < count; ++it, ++next, --count) {
+		if (*next < *it)
+			return false;
+	}
+	for (; next != container.end(); ++next) {
+		if (*next < *it)
+			return false;
+	}
+	return true;
+}
+
+// キーの順に並び、ペイロードがキーに付いたまま移っているか
+static bool _isSortedRecords(
+	const std::vector<BenchRecord> &records
+)
+{
+	for (std::size_t i = 0; i < records.size(); i++) {
+		if (0 < i && records[i].first < records[i - 1].first)
+			return false;
+		if (records[i].second.words[0] != records[i].first || records[i].second.words[14] != ~records[i].first)
+			return false;
+	}
+	return true;
+}
+
+static std::vector<BenchRecord> _makeRecords(
+	const std::vector<PmergeMe::VALUE_TYPE> &values
+)
+{
+	std::vector<BenchRecord> records(values.size());
+	for (std::size_t i = 0; i < values.size(); i++) {
+		records[i].first = values[i];
+		std::fill(records[i].second.words, records[i].second.words + 15, values[i]);
+		records[i].second.words[14] = ~values[i];
+	}
+	return records;
+}
+
+// 128B records を並べる (PmergeMe を通さず、MergeInsertion を直接使う)
+static bool _runRecordsOnce(
+	Mode mode,
+	const std::vector<BenchRecord> &input,
+	double &wallNs,
+	double &cpuNs
+)
+{
+	std::vector<BenchRecord> records(input);
+	RecordSorter sorter;
+	sorter.setAdaptive(mode == MODE_ADAPTIVE);
+	sorter.setNetwork(mode == MODE_NETWORK);
+	sorter.setIndirect(mode == MODE_INDIRECT);
+	struct timespec wallStart = _now(CLOCK_MONOTONIC);
+	struct timespec cpuStart = _now(CLOCK_PROCESS_CPUTIME_ID);
+	sorter.sort(records);
+	struct timespec cpuEnd = _now(CLOCK_PROCESS_CPUTIME_ID);
+	struct timespec wallEnd = _now(CLOCK_MONOTONIC);
+	wallNs = _elapsedNs(wallStart, wallEnd);
+	cpuNs = _elapsedNs(cpuStart, cpuEnd);
+	return _isSortedRecords(records);
+}
+
+// 1回分のソートを測る (入力の準備は測らない)
+static bool _runOnce(
+	Backend backend,
+	Mode mode,
+	const PmergeMe &input,
+	const std::vector<BenchRecord> &records,
+	const BenchOption &option,
+	double &wallNs,
+	double &cpuNs
+)
+{
+	if (backend == BACKEND_VECTOR_RECORDS)
+		return _runRecordsOnce(mode, records, wallNs, cpuNs);
+	PmergeMe v(input);
+	if (backend == BACKEND_VECTOR_THREADS)
+		v.setThreadCount(option.threadCount);
+	v.setAdaptive(mode == MODE_ADAPTIVE);
+	v.setNetwork(mode == MODE_NETWORK);
+	v.setIndirect(mode == MODE_INDIRECT);
+	v.setTopCount(mode == MODE_TOP ? option.topCount : 0);
+	struct timespec wallStart = _now(CLOCK_MONOTONIC);
+	struct timespec cpuStart = _now(CLOCK_PROCESS_CPUTIME_ID);
+	switch (backend) {
+		case BACKEND_DEQUE:
+			v.sort1();
+			break;
+		case BACKEND_LIST:
+			v.sort2();
+			break;
+		case BACKEND_VECTOR:
+		case BACKEND_VECTOR_THREADS:
+			v.sort3();
+			break;
+		case BACKEND_VECTOR_RECORDS:
+		case BACKEND_COUNT:
+			break;
+	}
+	struct timespec cpuEnd = _now(CLOCK_PROCESS_CPUTIME_ID);
+	struct timespec wallEnd = _now(CLOCK_MONOTONIC);
+	wallNs = _elapsedNs(wallStart, wallEnd);
+	cpuNs = _elapsedNs(cpuStart, cpuEnd);
+
+	std::size_t sortedCount = mode == MODE_TOP ? option.topCount : static_cast<std::size_t>(-1);
+	switch (backend) {
+		case BACKEND_DEQUE:
+			return _isSorted(v.getContainer1(), sortedCount);
+		case BACKEND_LIST:
+			return _isSorted(v.getContainer2());
+		default:
+			return _isSorted(v.getContainer3(), sortedCount);
+	}
+}
+
+// warmup のあと repeat 回測り、中央値と95パーセンタイルをまとめる
+static Result _measure(
+	Backend backend,
+	Mode mode,
+	Distribution distribution,
+	const std::vector<PmergeMe::VALUE_TYPE> &values,
+	const PmergeMe &input,
+	const std::vector<BenchRecord> &records,
+	const BenchOption &option,
+	bool &isFailed
+)
+{
+	double wallNs, cpuNs;
+	for (std::size_t i = 0; i < option.warmupCount; i++) {
+		_runOnce(backend, mode, input, records, option, wallNs, cpuNs);
+	}
+	std::vector<double> wallSamples;
+	std::vector<double> cpuSamples;
+	for (std::size_t i = 0; i < option.repeatCount; i++) {
+		if (!_runOnce(backend, mode, input, records, option, wallNs, cpuNs)) {
+			std::cerr
+				<< "Error: "
+				<< BACKEND_NAMES[backend] << " (" << MODE_NAMES[mode] << ") did not sort "
+				<< DIST_NAMES[distribution] << " (n = " << values.size() << ")"
+				<< std::endl;
+			isFailed = true;
+		}
+		wallSamples.push_back(wallNs);
+		cpuSamples.push_back(cpuNs);
+	}
+	Result result;
+	result.backend = backend;
+	result.mode = mode;
+	result.distribution = distribution;
+	result.size = values.size();
+	result.width = input.getWidth();
+	result.comparisons = _countComparisons(values, mode, option.topCount);
+	result.wall = _summarize(wallSamples);
+	result.cpu = _summarize(cpuSamples);
+	return result;
+}
+
+// adaptive, network の結果と比べる、同じ条件の通常の結果
+static const Result *_findPlainResult(
+	const std::vector<Result> &results,
+	const Result &target
+)
+{
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const Result &result = results[i];
+		if (result.mode == MODE_PLAIN && result.backend == target.backend && result.distribution == target.distribution && result.size == target.size)
+			return &result;
+	}
+	return NULL;
+}
+
+static bool _parseList(
+	const char *value,
+	std::vector<std::string> &items
+)
+{
+	items.clear();
+	std::istringstream iss(value);
+	std::string item;
+	while (std::getline(iss, item, ',')) {
+		if (item.empty())
+			return false;
+		items.push_back(item);
+	}
+	return !items.empty();
+}
+
+static bool _parseNumber(
+	const std::string &value,
+	unsigned long &number
+)
+{
+	return parseUnsigned(value.data(), value.data() + value.length(), number) == NUMBER_PARSE_OK;
+}
+
+static bool parseOption(
+	const char *arg,
+	BenchOption &option
+)
+{
+	if (std::strcmp(arg, "--json") == 0) {
+		option.isJson = true;
+		return true;
+	}
+	if (std::strcmp(arg, "--adaptive") == 0) {
+		option.isModeEnabled[MODE_ADAPTIVE] = true;
+		return true;
+	}
+	if (std::strcmp(arg, "--network") == 0) {
+		option.isModeEnabled[MODE_NETWORK] = true;
+		return true;
+	}
+	if (std::strcmp(arg, "--indirect") == 0) {
+		option.isModeEnabled[MODE_INDIRECT] = true;
+		return true;
+	}
+	if (std::strcmp(arg, "--wide") == 0) {
+		option.isWide = true;
+		return true;
+	}
+	const char *eq = std::strchr(arg, '=');
+	if (std::strncmp(arg, "--", 2) != 0 || eq == NULL)
+		return false;
+	std::string key(arg + 2, eq);
+	const char *value = eq + 1;
+
+	std::vector<std::string> items;
+	if (key == "sizes") {
+		// 例: --sizes=1000,10000
+		if (!_parseList(value, items))
+			return false;
+		option.sizes.clear();
+		for (std::size_t i = 0; i < items.size(); i++) {
+			unsigned long number;
+			if (!_parseNumber(items[i], number))
+				return false;
+			option.sizes.push_back(number);
+		}
+		return true;
+	}
+	if (key == "dists") {
+		// 例: --dists=random,sorted
+		if (!_parseList(value, items))
+			return false;
+		std::fill(option.isDistEnabled, option.isDistEnabled + DIST_COUNT, false);
+		for (std::size_t i = 0; i < items.size(); i++) {
+			const char **name = std::find(DIST_NAMES, DIST_NAMES + DIST_COUNT, items[i]);
+			if (name == DIST_NAMES + DIST_COUNT)
+				return false;
+			option.isDistEnabled[name - DIST_NAMES] = true;
+		}
+		return true;
+	}
+
+	unsigned long number;
+	if (!_parseNumber(value, number))
+		return false;
+	if (key == "warmup")
+		option.warmupCount = number;
+	else if (key == "repeat")
+		option.repeatCount = number == 0 ? 1 : number;
+	else if (key == "threads")
+		option.threadCount = number;
+	else if (key == "adversarial-rounds")
+		option.adversarialRounds = number;
+	else if (key == "seed")
+		option.seed = number == 0 ? 1 : number;
+	else if (key == "top" && number != 0) {
+		option.isModeEnabled[MODE_TOP] = true;
+		option.topCount = number;
+	}
+	else
+		return false;
+	return true;
+}
+
+static void printTable(
+	const std::vector<Result> &results
+)
+{
+	std::cout
+		<< std::left << std::setw(40) << "backend"
+		<< std::setw(13) << "distribution"
+		<< std::right << std::setw(9) << "n"
+		<< std::setw(8) << "width"
+		<< std::setw(12) << "compares"
+		<< std::setw(12) << "FJ bound"
+		<< std::setw(14) << "wall med(us)"
+		<< std::setw(14) << "wall p95(us)"
+		<< std::setw(14) << "cpu med(us)"
+		<< std::setw(14) << "cpu p95(us)"
+		<< std::setw(11) << "saved cmp"
+		<< std::setw(9) << "speedup"
+		<< std::endl;
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const Result &result = results[i];
+		std::string name = BACKEND_NAMES[result.backend];
+		if (result.mode != MODE_PLAIN)
+			name += std::string(" (") + MODE_NAMES[result.mode] + ")";
+		std::cout
+			<< std::left << std::setw(40) << name
+			<< std::setw(13) << DIST_NAMES[result.distribution]
+			<< std::right << std::setw(9) << result.size
+			<< std::setw(8) << PmergeMe::getWidthName(result.width)
+			<< std::setw(12) << result.comparisons
+			<< std::setw(12) << PmergeMe::getFordJohnsonWorstCase(result.size)
+			<< std::fixed << std::setprecision(1)
+			<< std::setw(14) << result.wall.median / 1000
+			<< std::setw(14) << result.wall.p95 / 1000
+			<< std::setw(14) << result.cpu.median / 1000
+			<< std::setw(14) << result.cpu.p95 / 1000;
+		// adaptive, network は通常の結果に対する比較回数の削減率と、経過時間の中央値の比を出す
+		// (network は比較回数が増えるので、削減率は負になる)
+		const Result *plain = result.mode != MODE_PLAIN ? _findPlainResult(results, result) : NULL;
+		if (plain != NULL && plain->comparisons != 0 && result.wall.median != 0) {
+			double saved = (1 - static_cast<double>(result.comparisons) / plain->comparisons) * 100;
+			std::cout
+				<< std::setw(10) << saved << "%"
+				<< std::setprecision(2)
+				<< std::setw(8) << plain->wall.median / result.wall.median << "x";
+		}
+		std::cout << std::endl;
+	}
+}
+
+// ビルド間で diff しやすいよう、キーの順序は固定で1結果1行にする
+static void printJson(
+	const BenchOption &option,
+	const std::vector<Result> &results
+)
+{
+	std::cout
+		<< "{" << std::endl
+		<< "  \"seed\": " << option.seed << "," << std::endl
+		<< "  \"warmup\": " << option.warmupCount << "," << std::endl
+		<< "  \"repeat\": " << option.repeatCount << "," << std::endl
+		<< "  \"threads\": " << option.threadCount << "," << std::endl
+		<< "  \"network_kernel\": \"" << getSortingNetworkKernelName() << "\"," << std::endl
+		<< "  \"top_count\": " << option.topCount << "," << std::endl
+		<< "  \"results\": [" << std::endl
+		<< std::fixed << std::setprecision(0);
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const Result &result = results[i];
+		std::cout
+			<< "    {\"backend\": \"" << BACKEND_NAMES[result.backend] << "\""
+			<< ", \"mode\": \"" << MODE_NAMES[result.mode] << "\""
+			<< ", \"distribution\": \"" << DIST_NAMES[result.distribution] << "\""
+			<< ", \"n\": " << result.size
+			<< ", \"width\": \"" << PmergeMe::getWidthName(result.width) << "\""
+			<< ", \"comparisons\": " << result.comparisons
+			<< ", \"ford_johnson_bound\": " << PmergeMe::getFordJohnsonWorstCase(result.size)
+			<< ", \"wall_ns\": {\"median\": " << result.wall.median << ", \"p95\": " << result.wall.p95 << "}"
+			<< ", \"cpu_ns\": {\"median\": " << result.cpu.median << ", \"p95\": " << result.cpu.p95 << "}"
+			<< "}"
+			<< (i + 1 < results.size() ? "," : "")
+			<< std::endl;
+	}
+	std::cout
+		<< "  ]" << std::endl
+		<< "}" << std::endl;
+}
+
+int main(
+	int argc,
+	const char **argv
+)
+{
+	BenchOption option;
+	option.sizes.push_back(1000);
+	option.sizes.push_back(10000);
+	std::fill(option.isDistEnabled, option.isDistEnabled + DIST_COUNT, true);
+	option.warmupCount = 2;
+	option.repeatCount = 9;
+	option.threadCount = 1;
+	option.adversarialRounds = 64;
+	option.seed = 42;
+	std::fill(option.isModeEnabled, option.isModeEnabled + MODE_COUNT, false);
+	option.isModeEnabled[MODE_PLAIN] = true;
+	option.topCount = 0;
+	option.isWide = false;
+	option.isJson = false;
+	for (int i = 1; i < argc; i++) {
+		if (!parseOption(argv[i], option)) {
+			std::cerr
+				<< "Usage: "
+				<< argv[0]
+				<< " [--sizes=N,...] [--dists=random,sorted,reverse,sawtooth,few-runs,adversarial]"
+				<< " [--warmup=N] [--repeat=N] [--threads=N] [--adversarial-rounds=N] [--seed=N] [--adaptive] [--network] [--indirect] [--top=K] [--wide] [--json]"
+				<< std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<Result> results;
+	bool isFailed = false;
+	try {
+		for (std::size_t s = 0; s < option.sizes.size(); s++) {
+			for (int dist = 0; dist < DIST_COUNT; dist++) {
+				if (!option.isDistEnabled[dist])
+					continue;
+				unsigned long state = option.seed;
+				std::vector<PmergeMe::VALUE_TYPE> values = generateInput(static_cast<Distribution>(dist), option.sizes[s], option, state);
+				if (option.isWide) {
+					for (std::size_t i = 0; i < values.size(); i++) {
+						values[i] += WIDE_OFFSET;
+					}
+				}
+				PmergeMe input(values);
+				std::vector<BenchRecord> records;
+				if (option.isModeEnabled[MODE_INDIRECT])
+					records = _makeRecords(values);
+				for (int mode = 0; mode < MODE_COUNT; mode++) {
+					if (!option.isModeEnabled[mode])
+						continue;
+					for (int backend = 0; backend < BACKEND_COUNT; backend++) {
+						if (backend == BACKEND_VECTOR_THREADS && option.threadCount < 2)
+							continue;
+						// std::list は network, indirect, top-k でも通常と同じ並べ方になる
+						if (backend == BACKEND_LIST && mode != MODE_PLAIN && mode != MODE_ADAPTIVE)
+							continue;
+						if (backend == BACKEND_VECTOR_RECORDS && (!option.isModeEnabled[MODE_INDIRECT] || mode == MODE_TOP))
+							continue;
+						results.push_back(_measure(static_cast<Backend>(backend), static_cast<Mode>(mode), static_cast<Distribution>(dist), values, input, records, option, isFailed));
+					}
+				}
+			}
+		}
+	} catch (const std::exception &e) {
+		std::cerr
+			<< "Error: "
+			<< e.what()
+			<< std::endl;
+		return 1;
+	}
+
+	if (option.isJson)
+		printJson(option, results);
+	else
+		printTable(results);
+	return isFailed ? 1 : 0;
+}
@@ -1,26 +1,48 @@
+#include <unistd.h>
+
 #include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <sstream>
 #include <string>
 
+#include "../common/NumberParser.hpp"
 #include "./PmergeMe.hpp"
+#include "./PmergeMeConcurrentSort.hpp"
+#include "./PmergeMeExternalSort.hpp"
+#include "./PmergeMeReader.hpp"
 
 #define SEC_TO_US(time) ((time.tv_sec) * (1000 * 1000) + (time.tv_nsec / 1000))
+#define OPTION_THREADS "--threads"
+#define OPTION_INPUT "--input="
+#define OPTION_BINARY "--binary"
+#define OPTION_ADAPTIVE "--adaptive"
+#define OPTION_NETWORK "--network"
+#define OPTION_INDIRECT "--indirect"
+#define OPTION_EXTERNAL "--external="
+#define OPTION_OUTPUT "--output="
+#define OPTION_TOP "--top="
+#define OPTION_CONCURRENT "--concurrent"
+// コンテナ名を出す幅 (最も長い名前に揃える)
+#define CONTAINER_NAME_WIDTH (sizeof(__CONTAINER_TYPE_3_STR) - 1)
 
+// count を指定した場合は先頭の count 個だけを出す
 template <typename T>
 static void print_container(
 	const std::string &header,
-	const T &container
+	const T &container,
+	size_t count = static_cast<size_t>(-1)
 )
 {
 	std::cout
 		<< header;
 	for (
 		typename T::const_iterator it = container.begin();
-		it != container.end();
-		++it
+		it != container.end() && count != 0;
+		++it, --count
 	) {
 		std::cout
 			<< " "
@@ -40,7 +62,7 @@ static void print_result(
 		<< "Time to process a range of "
 		<< std::setw(4) << size
 		<< " elements with "
-		<< containerName
+		<< std::left << std::setw(CONTAINER_NAME_WIDTH) << containerName << std::right
 		<< " : "
 		<< SEC_TO_US(time)
 		<< "."
@@ -49,6 +71,28 @@ static void print_result(
 		<< std::endl;
 }
 
+#ifdef COUNT
+static void print_stats(
+	const char *containerName,
+	PmergeMe::CONTAINER_TYPE_1::size_type size,
+	const PmergeMe::Stats &stats
+)
+{
+	std::cout
+		<< "Comparisons with "
+		<< std::left << std::setw(CONTAINER_NAME_WIDTH) << containerName << std::right
+		<< " : "
+		<< stats.comparisons
+		<< " (Ford-Johnson worst case: "
+		<< PmergeMe::getFordJohnsonWorstCase(size)
+		<< "), moves: "
+		<< stats.moves
+		<< ", allocations: "
+		<< stats.allocations
+		<< std::endl;
+}
+#endif	// COUNT
+
 static struct timespec _sub_timespec(
 	const struct timespec &start,
 	const struct timespec &end
@@ -65,21 +109,70 @@ static struct timespec _sub_timespec(
 	return result;
 }
 
+// --concurrent の場合に、スレッドごとの経過時間とコンテキストスイッチの回数を出す
+static void print_concurrent_result(
+	const PmergeMeConcurrentSort &concurrent
+)
+{
+	static const char *names[] = {
+		__CONTAINER_TYPE_1_STR,
+		__CONTAINER_TYPE_2_STR,
+		__CONTAINER_TYPE_3_STR,
+	};
+	const std::vector<PmergeMeConcurrentSort::Run> &runs = concurrent.getRuns();
+	for (size_t i = 0; i < runs.size(); i++) {
+		const PmergeMeConcurrentSort::Run &run = runs[i];
+		std::cout
+			<< "  "
+			<< std::left << std::setw(CONTAINER_NAME_WIDTH) << names[i] << std::right
+			<< " on CPU ";
+		if (run.cpu == -1)
+			std::cout << "-";
+		else
+			std::cout << run.cpu;
+		std::cout
+			<< " : "
+			<< SEC_TO_US(run.wallTime)
+			<< "."
+			<< std::setw(3) << std::setfill('0') << (run.wallTime.tv_nsec % 1000) << std::setfill(' ')
+			<< " us (wall), context switches: "
+			<< run.voluntarySwitches
+			<< " voluntary, "
+			<< run.involuntarySwitches
+			<< " involuntary"
+			<< std::endl;
+	}
+	const struct timespec &wallTime = concurrent.getWallTime();
+	std::cout
+		<< "Time to run all containers concurrently : "
+		<< SEC_TO_US(wallTime)
+		<< "."
+		<< std::setw(3) << std::setfill('0') << (wallTime.tv_nsec % 1000) << std::setfill(' ')
+		<< " us (wall)"
+		<< std::endl;
+}
+
+// 複数スレッドで動くソートは CLOCK_MONOTONIC (経過時間) で測る
 static struct timespec _execSort(
 	PmergeMe &v,
-	void (PmergeMe::*sortMethod)()
+	void (PmergeMe::*sortMethod)(),
+	clockid_t clockId = CLOCK_THREAD_CPUTIME_ID
 )
 {
 	struct timespec start, end;
 
-	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start) != 0) {
+#ifdef COUNT
+	PmergeMe::resetStats();
+#endif	// COUNT
+
+	if (clock_gettime(clockId, &start) != 0) {
 		const char *msg = std::strerror(errno);
 		throw std::runtime_error(msg);
 	}
 
 	(v.*sortMethod)();
 
-	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end) != 0) {
+	if (clock_gettime(clockId, &end) != 0) {
 		const char *msg = std::strerror(errno);
 		throw std::runtime_error(msg);
 	}
@@ -87,40 +180,365 @@ static struct timespec _execSort(
 	return _sub_timespec(start, end);
 }
 
+static void print_usage(
+	const char *programName
+)
+{
+	std::cerr
+		<< "Usage: "
+		<< programName
+		<< " [" OPTION_THREADS "[=<threads>]] [" OPTION_ADAPTIVE "] [" OPTION_NETWORK "] [" OPTION_INDIRECT "] [" OPTION_TOP "<count>] [" OPTION_CONCURRENT "] <positive integer>..."
+		<< std::endl
+		<< "       "
+		<< programName
+		<< " [" OPTION_THREADS "[=<threads>]] [" OPTION_ADAPTIVE "] [" OPTION_NETWORK "] [" OPTION_INDIRECT "] [" OPTION_TOP "<count>] [" OPTION_CONCURRENT "] [" OPTION_BINARY "] " OPTION_INPUT "<file|->"
+		<< std::endl
+		<< "       "
+		<< programName
+		<< " [" OPTION_THREADS "[=<threads>]] [" OPTION_ADAPTIVE "] [" OPTION_NETWORK "] [" OPTION_INDIRECT "] [" OPTION_BINARY "] " OPTION_INPUT "<file|-> "
+		<< OPTION_EXTERNAL "<memory limit MiB> [" OPTION_OUTPUT "<file|->]"
+		<< std::endl;
+}
+
+static double _to_double(
+	const struct timespec &time
+)
+{
+	return time.tv_sec + time.tv_nsec / (1000.0 * 1000 * 1000);
+}
+
+// --threads[=<threads>] を解釈する (値を省略した場合はオンラインの CPU 数)
+static bool parseThreadCount(
+	const char *option,
+	size_t &threadCount
+)
+{
+	size_t optionLen = std::strlen(OPTION_THREADS);
+	if (std::strncmp(option, OPTION_THREADS, optionLen) != 0)
+		return false;
+	if (option[optionLen] == '\0') {
+		long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+		threadCount = cpuCount < 1 ? 1 : static_cast<size_t>(cpuCount);
+		return true;
+	}
+	const char *value = option + optionLen + 1;
+	size_t count;
+	if (option[optionLen] != '=' || parseUnsigned(value, value + std::strlen(value), count) != NUMBER_PARSE_OK || count == 0)
+		return false;
+	threadCount = count;
+	return true;
+}
+
+// --top=<count> を解釈する
+static bool parseTopCount(
+	const char *option,
+	size_t &topCount
+)
+{
+	size_t optionLen = std::strlen(OPTION_TOP);
+	if (std::strncmp(option, OPTION_TOP, optionLen) != 0)
+		return false;
+	const char *value = option + optionLen;
+	size_t count;
+	if (parseUnsigned(value, value + std::strlen(value), count) != NUMBER_PARSE_OK || count == 0)
+		return false;
+	topCount = count;
+	return true;
+}
+
+// --external=<MiB> を解釈する
+static bool parseMemoryLimit(
+	const char *option,
+	size_t &memoryLimit
+)
+{
+	size_t optionLen = std::strlen(OPTION_EXTERNAL);
+	if (std::strncmp(option, OPTION_EXTERNAL, optionLen) != 0)
+		return false;
+	const char *value = option + optionLen;
+	size_t mebibytes;
+	if (parseUnsigned(value, value + std::strlen(value), mebibytes) != NUMBER_PARSE_OK || mebibytes == 0 || (static_cast<size_t>(-1) >> 20) < mebibytes)
+		return false;
+	memoryLimit = mebibytes << 20;
+	return true;
+}
+
+// 並べた値を標準出力へ書く場合は、結果を標準エラー出力へ出す
+static void print_external_result(
+	std::ostream &os,
+	const PmergeMeExternalSort &sorter
+)
+{
+	const std::vector<PmergeMeExternalSort::Phase> &phases = sorter.getPhases();
+	os
+		<< "External sort of "
+		<< sorter.getValueCount()
+		<< " elements (memory limit: "
+		<< (sorter.getMemoryLimit() >> 20)
+		<< " MiB)"
+		<< std::endl;
+	for (size_t i = 0; i < phases.size(); i++) {
+		const PmergeMeExternalSort::Phase &phase = phases[i];
+		os
+			<< "  "
+			<< std::left << std::setw(15) << phase.name << std::right
+			<< ": read "
+			<< phase.readBytes
+			<< " bytes, wrote "
+			<< phase.writtenBytes
+			<< " bytes, "
+			<< phase.runCount
+			<< (phase.runCount == 1 ? " run, " : " runs, ")
+			<< std::fixed << std::setprecision(3) << phase.seconds * 1000
+			<< " ms"
+			<< std::endl;
+	}
+}
+
 int main(
 	int argc,
 	const char **argv
 )
 {
-	if (argc < 2) {
+	size_t threadCount = 0;
+	std::string inputPath;
+	bool isBinary = false;
+	bool isAdaptive = false;
+	bool isNetwork = false;
+	bool isIndirect = false;
+	size_t memoryLimit = 0;
+	size_t topCount = 0;
+	bool isConcurrent = false;
+	std::string outputPath = "-";
+	int optionCount = 0;
+	while (1 + optionCount < argc && std::strncmp(argv[1 + optionCount], "--", 2) == 0) {
+		const char *option = argv[1 + optionCount];
+		size_t inputOptionLen = std::strlen(OPTION_INPUT);
+		if (std::strncmp(option, OPTION_INPUT, inputOptionLen) == 0 && option[inputOptionLen] != '\0') {
+			inputPath = option + inputOptionLen;
+		} else if (std::strcmp(option, OPTION_BINARY) == 0) {
+			isBinary = true;
+		} else if (std::strcmp(option, OPTION_ADAPTIVE) == 0) {
+			isAdaptive = true;
+		} else if (std::strcmp(option, OPTION_NETWORK) == 0) {
+			isNetwork = true;
+		} else if (std::strcmp(option, OPTION_INDIRECT) == 0) {
+			isIndirect = true;
+		} else if (std::strcmp(option, OPTION_CONCURRENT) == 0) {
+			isConcurrent = true;
+		} else if (std::strncmp(option, OPTION_OUTPUT, std::strlen(OPTION_OUTPUT)) == 0 && option[std::strlen(OPTION_OUTPUT)] != '\0') {
+			outputPath = option + std::strlen(OPTION_OUTPUT);
+		} else if (std::strncmp(option, OPTION_TOP, std::strlen(OPTION_TOP)) == 0) {
+			if (!parseTopCount(option, topCount)) {
+				print_usage(argv[0]);
+				return 1;
+			}
+		} else if (std::strncmp(option, OPTION_EXTERNAL, std::strlen(OPTION_EXTERNAL)) == 0) {
+			if (!parseMemoryLimit(option, memoryLimit)) {
+				print_usage(argv[0]);
+				return 1;
+			}
+		} else if (!parseThreadCount(option, threadCount)) {
+			print_usage(argv[0]);
+			return 1;
+		}
+		++optionCount;
+	}
+	// 値はコマンドライン引数か --input= のどちらか一方で渡す
+	bool isValidArgs = inputPath.empty()
+		? (!isBinary && 2 <= argc - optionCount)
+		: argc - optionCount == 1;
+	// 外部ソートは --input= で渡された値だけを扱い、すべてを並べる
+	if (memoryLimit != 0 && (inputPath.empty() || topCount != 0))
+		isValidArgs = false;
+	if (!isValidArgs) {
+		print_usage(argv[0]);
+		return 1;
+	}
+#ifdef COUNT
+	// 比較回数などの計測値は全スレッドで共通なので、同時に並べると混ざる
+	if (isConcurrent) {
 		std::cerr
-			<< "Usage: "
-			<< argv[0]
-			<< " <positive integer>..."
+			<< "Error: "
+			<< OPTION_CONCURRENT
+			<< " cannot be used with COUNT"
 			<< std::endl;
 		return 1;
 	}
+#endif	// COUNT
+
+	if (memoryLimit != 0) {
+		try {
+			PmergeMeReader reader(isBinary ? PmergeMeReader::FORMAT_BINARY : PmergeMeReader::FORMAT_TEXT);
+			PmergeMeExternalSort sorter(memoryLimit);
+			sorter.setThreadCount(threadCount);
+			sorter.setAdaptive(isAdaptive);
+			sorter.setNetwork(isNetwork);
+			sorter.setIndirect(isIndirect);
+			sorter.sort(reader, inputPath, outputPath);
+			print_external_result(outputPath == "-" ? std::cerr : std::cout, sorter);
+		} catch (const std::exception &e) {
+			std::cerr
+				<< "Error: "
+				<< e.what()
+				<< std::endl;
+			return 1;
+		}
+		return 0;
+	}
 
 	try {
-		PmergeMe v(argc, argv);
-		struct timespec sort1Time, sort2Time;
+		struct timespec loadStart, loadEnd;
+		clock_gettime(CLOCK_MONOTONIC, &loadStart);
+		PmergeMeReader reader(isBinary ? PmergeMeReader::FORMAT_BINARY : PmergeMeReader::FORMAT_TEXT);
+		// 先頭の引数はプログラム名として読み飛ばされるので、オプションの分だけずらして渡す
+		PmergeMe v = inputPath.empty()
+			? PmergeMe(argc - optionCount, argv + optionCount)
+			: PmergeMe(reader, inputPath);
+		clock_gettime(CLOCK_MONOTONIC, &loadEnd);
+		v.setAdaptive(isAdaptive);
+		v.setNetwork(isNetwork);
+		v.setIndirect(isIndirect);
+		v.setTopCount(topCount);
+		struct timespec sort1Time, sort2Time, sort3Time;
+		PmergeMe parallel;
+		if (threadCount != 0) {
+			parallel = v;
+			parallel.setThreadCount(threadCount);
+		}
+		PmergeMe full;
+		if (topCount != 0) {
+			full = v;
+			full.setTopCount(0);
+		}
 
 		print_container("Before: ", v.getContainer1());
-		sort1Time = _execSort(v, &PmergeMe::sort1);
-		sort2Time = _execSort(v, &PmergeMe::sort2);
+		// 各バックエンドの結果 (--concurrent の場合はスレッドごとのコピー)
+		const PmergeMe *result1 = &v;
+		const PmergeMe *result2 = &v;
+		const PmergeMe *result3 = &v;
+		PmergeMeConcurrentSort concurrent(v);
+		if (isConcurrent) {
+			concurrent.add(&PmergeMe::copyContainer1, &PmergeMe::sort1);
+			concurrent.add(&PmergeMe::copyContainer2, &PmergeMe::sort2);
+			concurrent.add(&PmergeMe::copyContainer3, &PmergeMe::sort3);
+			concurrent.run();
+			const std::vector<PmergeMeConcurrentSort::Run> &runs = concurrent.getRuns();
+			result1 = &runs[0].result;
+			result2 = &runs[1].result;
+			result3 = &runs[2].result;
+			sort1Time = runs[0].cpuTime;
+			sort2Time = runs[1].cpuTime;
+			sort3Time = runs[2].cpuTime;
+		} else {
+			sort1Time = _execSort(v, &PmergeMe::sort1);
+		}
+#ifdef COUNT
+		PmergeMe::Stats stats1 = PmergeMe::getStats();
+#endif	// COUNT
+		if (!isConcurrent)
+			sort2Time = _execSort(v, &PmergeMe::sort2);
+#ifdef COUNT
+		PmergeMe::Stats stats2 = PmergeMe::getStats();
+#endif	// COUNT
+		if (!isConcurrent)
+			sort3Time = _execSort(v, &PmergeMe::sort3);
+#ifdef COUNT
+		PmergeMe::Stats stats3 = PmergeMe::getStats();
+#endif	// COUNT
+		struct timespec parallelSort3Time;
+		if (threadCount != 0)
+			parallelSort3Time = _execSort(parallel, &PmergeMe::sort3, CLOCK_MONOTONIC);
+#ifdef COUNT
+		PmergeMe::Stats parallelStats3 = PmergeMe::getStats();
+#endif	// COUNT
+		// --top= の場合は、比べるためにすべてを並べる sort1 も測る
+		struct timespec fullSort1Time;
+		if (topCount != 0)
+			fullSort1Time = _execSort(full, &PmergeMe::sort1);
+#ifdef COUNT
+		PmergeMe::Stats fullStats1 = PmergeMe::getStats();
+#endif	// COUNT
 #if defined(DEBUG) || defined(VALIDATE)
 		std::cout
 			<< std::endl
 			<< "# RESULT ===" << std::endl;
 #endif	// DEBUG || VALIDATE
 
-		print_container("After:  ", v.getContainer1());
+		size_t printCount = topCount != 0 ? topCount : v.getSize();
+		print_container("After:  ", result1->getContainer1(), printCount);
 #if defined(DEBUG) || defined(VALIDATE)
-		print_container("After2: ", v.getContainer2());
+		print_container("After2: ", result2->getContainer2(), printCount);
+		print_container("After3: ", result3->getContainer3(), printCount);
+		if (threadCount != 0 && parallel.getContainer3() != result3->getContainer3())
+			std::cerr << "sort3 (parallel) result differs from sort3" << std::endl;
+#else
+		// 並べた結果を出すのは sort1 だけ
+		(void)result2;
+		(void)result3;
 #endif	// DEBUG || VALIDATE
 
-		print_result(__CONTAINER_TYPE_1_STR, v.getContainer1().size(), sort1Time);
-		print_result(__CONTAINER_TYPE_2_STR, v.getContainer1().size(), sort2Time);
+		if (!inputPath.empty()) {
+			struct timespec loadTime = _sub_timespec(loadStart, loadEnd);
+			std::cout
+				<< "Time to load "
+				<< v.getSize()
+				<< " elements from "
+				<< inputPath
+				<< " : "
+				<< SEC_TO_US(loadTime)
+				<< "."
+				<< std::setw(3) << std::setfill('0') << (loadTime.tv_nsec % 1000) << std::setfill(' ')
+				<< " us (wall)"
+				<< std::endl;
+		}
+		print_result(__CONTAINER_TYPE_1_STR, v.getSize(), sort1Time);
+		print_result(__CONTAINER_TYPE_2_STR, v.getSize(), sort2Time);
+		print_result(__CONTAINER_TYPE_3_STR, v.getSize(), sort3Time);
+		if (isConcurrent)
+			print_concurrent_result(concurrent);
+		if (topCount != 0) {
+			print_result(__CONTAINER_TYPE_1_STR " (full sort)", v.getSize(), fullSort1Time);
+			double topSeconds = _to_double(sort1Time);
+			std::cout
+				<< "Speedup of the smallest "
+				<< std::min(topCount, v.getSize())
+				<< " with "
+				<< __CONTAINER_TYPE_1_STR
+				<< " over the full sort : ";
+			if (topSeconds == 0)
+				std::cout << "-";
+			else
+				std::cout << std::fixed << std::setprecision(2) << _to_double(fullSort1Time) / topSeconds << "x";
+			std::cout << std::endl;
+		}
+		std::ostringstream parallelName;
+		if (threadCount != 0) {
+			parallelName << __CONTAINER_TYPE_3_STR " (" << threadCount << " threads, wall)";
+			print_result(parallelName.str().c_str(), v.getSize(), parallelSort3Time);
+			// 1スレッドの場合は CPU 時間と経過時間がほぼ一致するものとして比べる
+			double parallelSeconds = _to_double(parallelSort3Time);
+			std::cout
+				<< "Speedup of "
+				<< parallelName.str()
+				<< " over "
+				<< __CONTAINER_TYPE_3_STR
+				<< " : ";
+			if (parallelSeconds == 0)
+				std::cout << "-";
+			else
+				std::cout << std::fixed << std::setprecision(2) << _to_double(sort3Time) / parallelSeconds << "x";
+			std::cout << std::endl;
+		}
+#ifdef COUNT
+		print_stats(__CONTAINER_TYPE_1_STR, v.getSize(), stats1);
+		print_stats(__CONTAINER_TYPE_2_STR, v.getSize(), stats2);
+		print_stats(__CONTAINER_TYPE_3_STR, v.getSize(), stats3);
+		if (threadCount != 0)
+			print_stats(parallelName.str().c_str(), v.getSize(), parallelStats3);
+		if (topCount != 0)
+			print_stats(__CONTAINER_TYPE_1_STR " (full sort)", v.getSize(), fullStats1);
+#endif	// COUNT
 
 	} catch (const std::exception &e) {
 		std::cerr
@@ -0,0 +1,63 @@
+#!/bin/sh
+# 比較回数が基準値 (comparisons.txt) と Ford-Johnson の最悪値を上回っていないか確認する
+# あわせて、ソート1回あたりのメモリ確保回数が入力の大きさによらず MAX_ALLOCATIONS 以下か確認する
+# usage: check_comparisons.sh <COUNT 付きでビルドした PmergeMe> [--update]
+
+BIN=$1
+DIR=$(dirname "$0")
+BASELINE="$DIR/comparisons.txt"
+MAX_ALLOCATIONS=8
+
+if [ ! -x "$BIN" ]; then
+	echo "usage: $0 <PmergeMe> [--update]" >&2
+	exit 2
+fi
+
+CURRENT=$(mktemp)
+trap 'rm -f "$CURRENT"' EXIT
+
+for input in "$DIR"/*.in; do
+	name=$(basename "$input")
+	# shellcheck disable=SC2046
+	"$BIN" $(cat "$input") | awk -v name="$name" '
+		/^Comparisons with / {
+			bound = $9
+			gsub(/[^0-9]/, "", bound)
+			print name, $3, $5, bound, $NF
+		}
+	' >> "$CURRENT" || exit 1
+done
+
+if [ "$2" = "--update" ]; then
+	awk '{ print $1, $2, $3 }' "$CURRENT" > "$BASELINE"
+	echo "updated $BASELINE"
+	exit 0
+fi
+
+awk -v maxAllocations="$MAX_ALLOCATIONS" '
+	NR == FNR {
+		baseline[$1 " " $2] = $3
+		next
+	}
+	{
+		key = $1 " " $2
+		if ($4 + 0 < $3 + 0) {
+			print "NG: " key ": " $3 " comparisons (Ford-Johnson worst case: " $4 ")"
+			failed = 1
+		} else if (maxAllocations + 0 < $5 + 0) {
+			print "NG: " key ": " $5 " allocations (max: " maxAllocations ")"
+			failed = 1
+		} else if (!(key in baseline)) {
+			print "NG: " key ": no baseline"
+			failed = 1
+		} else if (baseline[key] + 0 < $3 + 0) {
+			print "NG: " key ": " $3 " comparisons (baseline: " baseline[key] ")"
+			failed = 1
+		} else {
+			print "OK: " key ": " $3 " comparisons, " $5 " allocations"
+		}
+	}
+	END {
+		exit failed
+	}
+' "$BASELINE" "$CURRENT"